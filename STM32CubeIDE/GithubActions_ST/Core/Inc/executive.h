@@ -0,0 +1,99 @@
+/*
+ * executive.h
+ *
+ * Preemptive fixed-priority executive with the part of the OSEK API that the
+ * generated code (esdl_mutex.h, platform_defs.h) and the firmware use.
+ *
+ * The tasks are a static table of functions, highest priority first; a
+ * TaskType is the index of a task in it. Tasks are basic tasks in the sense of
+ * OSEK: activated by ActivateTask(), typically from the timer interrupt (see
+ * scheduler.h), they run to completion on the one stack of the main loop and
+ * end by returning. A task activated while it is ready or running is not
+ * activated again (E_OS_LIMIT). A task of a higher priority than the running
+ * code preempts it as soon as the activation returns; the main loop itself is
+ * the background of priority 0, below all tasks.
+ *
+ * On the target, PendSV, the exception of the lowest priority, dispatches the
+ * tasks after the interrupts have returned. The data of the executive is
+ * guarded with BASEPRI, which masks only the interrupts of a priority at or
+ * below EXECUTIVE_IRQ_PRIORITY (TIM6, PendSV): only these may call the
+ * executive, the others (priority 0) are never delayed by it. In the host SIL
+ * build the dispatch runs directly when the OS interrupts are resumed.
+ *
+ * A resource is identified by its ceiling, the TaskType of the task of the
+ * highest priority that gets it. While it is held, the code runs at the
+ * priority of that task, so no other task that gets the resource can preempt
+ * it. Resources are released in the reverse order of getting them and before
+ * the task returns.
+ *
+ * The execution time of every task without the time it was preempted, its
+ * longest delay from activation to start and the number of its preemptions
+ * are recorded in runtimeStats.scheduler (see runtime_stats.h).
+ */
+
+#ifndef INC_EXECUTIVE_H_
+#define INC_EXECUTIVE_H_
+
+#include <stdint.h>
+
+#define EXECUTIVE_MAX_TASKS			5		// size of runtimeStats.scheduler.task
+#define EXECUTIVE_MAX_RESOURCES		4		// resources held at the same time
+#define EXECUTIVE_IRQ_PRIORITY		1		// NVIC priority of the interrupts that call the executive
+
+typedef uint8_t TaskType;
+typedef uint8_t ResourceType;
+typedef uint8_t StatusType;
+typedef uint32_t TickType;
+
+typedef void (*Executive_Entry_t)(void);
+
+#define E_OK						0
+#define E_OS_ACCESS					1
+#define E_OS_ID						3
+#define E_OS_LIMIT					4
+#define E_OS_NOFUNC					5
+
+#define RES_SCHEDULER				((ResourceType) 0)	// ceiling of the first task: no task preempts
+
+// GetStopwatch() is the DWT cycle counter at the core clock of 64 MHz
+#define OSMAXALLOWEDVALUE			UINT32_MAX
+#define OSTICKDURATION				15.625F				// ns per tick
+
+/**
+ * Starts the executive with no task ready, from the background before the
+ * first activation.
+ *
+ * \param [in] tasks  table of at most EXECUTIVE_MAX_TASKS entry functions,
+ *                    highest priority first; must stay valid
+ */
+void Executive_Initialize(const Executive_Entry_t *tasks, uint8_t count);
+
+StatusType ActivateTask(TaskType task);
+
+/**
+ * A task ends when its function returns, this is only for code written for
+ * OSEK, where it is the last call of a task.
+ */
+StatusType TerminateTask(void);
+
+StatusType GetResource(ResourceType resource);
+StatusType ReleaseResource(ResourceType resource);
+
+/**
+ * All interrupts (PRIMASK): Disable/EnableAllInterrupts() do not nest,
+ * Suspend/ResumeAllInterrupts() do. The interrupts that call the executive
+ * (BASEPRI): Suspend/ResumeOSInterrupts(), they nest.
+ */
+void DisableAllInterrupts(void);
+void EnableAllInterrupts(void);
+void SuspendAllInterrupts(void);
+void ResumeAllInterrupts(void);
+void SuspendOSInterrupts(void);
+void ResumeOSInterrupts(void);
+
+/**
+ * Free running, wraps at OSMAXALLOWEDVALUE; RuntimeStats_Initialize() starts it.
+ */
+TickType GetStopwatch(void);
+
+#endif /* INC_EXECUTIVE_H_ */
@@ -18,6 +18,7 @@ extern I2C_HandleTypeDef hi2c1;
 // !!! I2C Configuration !!!
 #define HT16K33_I2C_PORT        hi2c1
 #define HT16K33_I2C_ADDR        0x70
+#define HT16K33_I2C_TIMEOUT_MS  2		// per write, a stuck write must not stall the sensor
 
 // displayable Characters
 #define SEG7_0                0
@@ -42,10 +43,17 @@ extern I2C_HandleTypeDef hi2c1;
 #define SEG7_L                19
 #define SEG7_NONE             99
 
+// The display functions below only update the cache; seg7_update() sends the
+// whole cache as one display RAM write with address auto increment, through
+// the queue of i2c_async.h without waiting, at most at the refresh rate.
+
 void seg7_init(void);		// initializes 7-segment-display
 void seg7_reset(void);		// resets 7-segment-display
 void seg7_clearCache(void);	// force clearing of the cache
-void seg7_refresh(void); 	// force writing of cache to display
+void seg7_refresh(void); 	// force writing of cache to display, waits for the write
+void seg7_update(void);		// writes the cache to the display if it changed and the refresh interval has passed
+
+void seg7_setRefreshRate(uint8_t hz);		// 0 .. 255	  updates per second at most, 0 = every seg7_update()
 
 void seg7_displayOn(void);	// enable display
 void seg7_displayOff(void);	// disable display, fastest way to darken display
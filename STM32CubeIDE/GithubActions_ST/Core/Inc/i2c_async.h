@@ -0,0 +1,104 @@
+/*
+ * i2c_async.h
+ *
+ * Queued, interrupt driven I2C transactions with a priority per client.
+ *
+ * A transaction is either a plain write (register index and data in one
+ * buffer, like the HT16K33 commands) or a register read (index write followed
+ * by a repeated start read). I2cAsync_Submit() appends it to the queue of its
+ * client and returns at once; the transactions run one after the other in the
+ * I2C interrupts, and the callback of each is called from the interrupt once
+ * it has completed or failed. The caller owns the transaction and its buffer
+ * until then and must not submit it again before.
+ *
+ * Whenever the bus becomes free, the next transaction is taken from the queue
+ * of the client with the highest priority, so a sensor read waits at most for
+ * the display write that is on the bus, never for the ones queued behind it.
+ * Each transaction has a timeout that starts when it goes on the bus;
+ * I2cAsync_Service() fails a transaction that exceeds it and reinitializes
+ * the I2C peripheral, so a stuck transfer cannot block the others. Queue
+ * depth, latency (submit to completion), errors and timeouts of each client
+ * are recorded in runtimeStats.i2c, the time on the bus in runtimeStats.i2cBus
+ * (see runtime_stats.h).
+ *
+ * A read can be followed by a write in the same transaction (postData, for
+ * example an interrupt clear): the write goes on the bus right from the
+ * receive interrupt, so no transaction of another client gets in between. If
+ * the read has a received hook, it is called from the interrupt as soon as
+ * the data is in and may cancel the write by setting postSize to 0.
+ *
+ * I2cAsync_Transfer() submits and waits for the completion, for code that
+ * cannot continue without the result (initialization, blocking drivers); its
+ * timeout is clamped to UINT16_MAX ms. It must not be called from an interrupt
+ * or a callback.
+ *
+ * DMA is not used: on the STM32F334 the I2C1 TX request shares DMA1 channel 6
+ * with TIM3 CH1, which streams the LED ring.
+ */
+
+#ifndef INC_I2C_ASYNC_H_
+#define INC_I2C_ASYNC_H_
+
+#include <stdint.h>
+#include "stm32f3xx_hal.h"
+
+#define I2C_ASYNC_DEFAULT_TIMEOUT_MS	10		// if a transaction has no timeout of its own
+
+typedef enum {
+	I2C_ASYNC_CLIENT_SENSOR = 0,	// VL53L0X, highest priority
+	I2C_ASYNC_CLIENT_DISPLAY,		// HT16K33
+	I2C_ASYNC_NUM_CLIENTS
+} I2cAsync_Client_t;
+
+typedef enum {
+	I2C_ASYNC_IDLE = 0,			// never submitted
+	I2C_ASYNC_QUEUED,
+	I2C_ASYNC_BUSY,				// on the bus
+	I2C_ASYNC_DONE,
+	I2C_ASYNC_ERROR,			// no acknowledge or bus error
+	I2C_ASYNC_TIMEOUT
+} I2cAsync_Status_t;
+
+typedef enum {
+	I2C_ASYNC_WRITE = 0,
+	I2C_ASYNC_READ
+} I2cAsync_Direction_t;
+
+typedef struct I2cAsync_Transaction I2cAsync_Transaction_t;
+typedef void (*I2cAsync_Callback_t)(I2cAsync_Transaction_t *transaction);
+
+struct I2cAsync_Transaction {
+	I2C_HandleTypeDef *hi2c;
+	uint16_t devAddress;		// 8 bit address as for HAL_I2C_Master_Transmit()
+	uint8_t client;				// I2cAsync_Client_t
+	uint8_t direction;			// I2cAsync_Direction_t
+	uint8_t reg;				// register index of a read
+	uint8_t *data;
+	uint16_t size;
+	uint8_t *postData;			// write after a read (register index and data), optional
+	uint16_t postSize;			// 0: none
+	uint16_t timeout_ms;		// on the bus, 0: I2C_ASYNC_DEFAULT_TIMEOUT_MS
+	volatile uint8_t status;	// I2cAsync_Status_t
+	I2cAsync_Callback_t received;	// optional, data of a read is in, before postData
+	I2cAsync_Callback_t callback;	// optional
+	void *context;				// for the callbacks
+	// private
+	uint8_t phase;				// 1: index of a read written, 2: data read, postData on the bus
+	uint32_t submitted;			// RuntimeStats_Now()
+	uint32_t started;			// RuntimeStats_Now() when it went on the bus
+	uint32_t started_ms;		// HAL_GetTick()
+	I2cAsync_Transaction_t *next;
+};
+
+HAL_StatusTypeDef I2cAsync_Submit(I2cAsync_Transaction_t *transaction);
+HAL_StatusTypeDef I2cAsync_Transfer(I2cAsync_Transaction_t *transaction, uint32_t timeout_ms);
+
+/**
+ * Fails the transaction on the bus if it has exceeded its timeout. Called
+ * from the main loop and while I2cAsync_Transfer() waits.
+ */
+void I2cAsync_Service(void);
+
+uint8_t I2cAsync_IsIdle(void);
+
+#endif /* INC_I2C_ASYNC_H_ */
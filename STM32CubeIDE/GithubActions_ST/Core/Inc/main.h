@@ -63,6 +63,9 @@ void Error_Handler(void);
 #define B1_GPIO_Port GPIOC
 #define RCC_OSC32_OUT_Pin GPIO_PIN_15
 #define RCC_OSC32_OUT_GPIO_Port GPIOC
+#define TOF_INT_Pin GPIO_PIN_4
+#define TOF_INT_GPIO_Port GPIOA
+#define TOF_INT_EXTI_IRQn EXTI4_IRQn
 #define LD2_Pin GPIO_PIN_5
 #define LD2_GPIO_Port GPIOA
 #define BTN1_Pin GPIO_PIN_7
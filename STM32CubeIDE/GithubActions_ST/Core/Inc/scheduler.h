@@ -0,0 +1,60 @@
+/*
+ * scheduler.h
+ *
+ * Table-driven periodic activation of the tasks of the executive.
+ *
+ * The tasks are a static table of functions with a period and a phase offset
+ * in milliseconds; they become the tasks of the executive (executive.h), the
+ * order of the table is their priority and the index their TaskType. The 1 ms
+ * timer interrupt (Scheduler_Tick()) activates every task whose release has
+ * come, and the executive runs it at once if its priority is above the one of
+ * the running task, so a task waits for tasks of a higher priority only.
+ * Scheduler_Run() is the background of the main loop: it runs the idle hook.
+ *
+ * A task is released at the ticks offset + k * period (k > 0 for an offset of
+ * 0), so tasks of the same rate with different offsets do not run in the same
+ * tick. If a task is released again before it has completed, the release is
+ * dropped and counted as an overrun: a task never runs twice in a row to catch
+ * up. Runs, overruns, the longest delay from release to start, the
+ * preemptions and the execution time of each task are recorded in
+ * runtimeStats.scheduler (see runtime_stats.h).
+ */
+
+#ifndef INC_SCHEDULER_H_
+#define INC_SCHEDULER_H_
+
+#include <stdint.h>
+#include "executive.h"
+
+#define SCHEDULER_MAX_TASKS		EXECUTIVE_MAX_TASKS
+
+typedef struct {
+	void (*run)(void);
+	uint16_t period_ms;
+	uint16_t offset_ms;			// first release, less than the period
+} Scheduler_Task_t;
+
+/**
+ * Starts the schedule at tick 0.
+ *
+ * \param [in] tasks  table of at most SCHEDULER_MAX_TASKS tasks, highest
+ *                    priority first; must stay valid
+ * \param [in] idle   called by Scheduler_Run(), may be NULL; it runs with
+ *                    interrupts disabled and may sleep with __WFI(), which
+ *                    returns at the next interrupt
+ * \return E_OK, or E_OS_LIMIT for more than SCHEDULER_MAX_TASKS tasks, which
+ *         are not scheduled at all then
+ */
+StatusType Scheduler_Initialize(const Scheduler_Task_t *tasks, uint8_t count, void (*idle)(void));
+
+/**
+ * Advances the schedule by one millisecond, from the timer interrupt.
+ */
+void Scheduler_Tick(void);
+
+/**
+ * Runs the idle hook, from the main loop.
+ */
+void Scheduler_Run(void);
+
+#endif /* INC_SCHEDULER_H_ */
@@ -51,13 +51,15 @@ void HardFault_Handler(void);
 void MemManage_Handler(void);
 void BusFault_Handler(void);
 void UsageFault_Handler(void);
-void SVC_Handler(void);
 void DebugMon_Handler(void);
-void PendSV_Handler(void);
 void SysTick_Handler(void);
+void EXTI4_IRQHandler(void);
+void DMA1_Channel1_IRQHandler(void);
 void DMA1_Channel6_IRQHandler(void);
 void CAN_TX_IRQHandler(void);
 void CAN_RX0_IRQHandler(void);
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
 void TIM6_DAC1_IRQHandler(void);
 /* USER CODE BEGIN EFP */
 
@@ -0,0 +1,59 @@
+/*
+ * vl53l0x_cal_store.h
+ *
+ * Reference calibration of the VL53L0X kept in flash across power cycles.
+ *
+ * The reference calibration (VHV and phase) and the reference SPAD management
+ * take tens of milliseconds of polling at every power-up, although their
+ * results only depend on the part and hardly on the temperature. SetupSingleShot()
+ * performs them once, stores the results with VL53L0X_CalStore_Save() and
+ * applies the stored record on the following boots. The record carries the
+ * unique ID of the part and a CRC, so a blank or corrupted page or a replaced
+ * sensor leads to a full calibration again.
+ *
+ * The record has a flash page of its own (VL53L0X_CAL_FLASH in
+ * STM32F334R8TX_FLASH.ld) that is not part of the image, so programming the
+ * firmware keeps it. A mass erase forces the calibration at the next boot.
+ */
+
+#ifndef INC_VL53L0X_CAL_STORE_H_
+#define INC_VL53L0X_CAL_STORE_H_
+
+#include <stdint.h>
+#include "stm32f3xx_hal.h"
+
+#define VL53L0X_CAL_STORE_MAGIC		0x4C414354U		// "TCAL"
+#define VL53L0X_CAL_STORE_VERSION	1
+
+typedef struct {
+	uint32_t magic;					// VL53L0X_CAL_STORE_MAGIC
+	uint16_t version;				// VL53L0X_CAL_STORE_VERSION
+	uint16_t size;					// sizeof(VL53L0X_CalRecord_t)
+	uint32_t partUidUpper;			// part the calibration belongs to
+	uint32_t partUidLower;
+	uint8_t vhvSettings;			// VL53L0X_PerformRefCalibration()
+	uint8_t phaseCal;
+	uint8_t isApertureSpads;		// VL53L0X_PerformRefSpadManagement()
+	uint8_t xTalkCompensationEnable;
+	uint32_t refSpadCount;
+	int32_t offsetMicroMeter;		// VL53L0X_GetOffsetCalibrationDataMicroMeter()
+	uint32_t xTalkCompensationRateMegaCps;	// FixPoint1616_t
+	uint32_t crc;					// CRC-32 of the preceding bytes
+} VL53L0X_CalRecord_t;
+
+_Static_assert(sizeof(VL53L0X_CalRecord_t) == 36, "flash record layout");
+
+/**
+ * Copies the stored record if it is complete and its CRC matches.
+ *
+ * \return 1 if record is valid
+ */
+uint8_t VL53L0X_CalStore_Load(VL53L0X_CalRecord_t *record);
+
+/**
+ * Erases the page and programs record with magic, version, size and CRC
+ * filled in. Blocks for the page erase (about 40 ms), only for the boot.
+ */
+HAL_StatusTypeDef VL53L0X_CalStore_Save(VL53L0X_CalRecord_t *record);
+
+#endif /* INC_VL53L0X_CAL_STORE_H_ */
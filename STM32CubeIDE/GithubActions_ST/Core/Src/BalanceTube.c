@@ -3,17 +3,36 @@
 #include "vl53l0x_api.h"
 #include "vl53l0x_tof.h"
 #include "ht16k33.h"
+#include "i2c_async.h"
+#include "executive.h"
+#include "scheduler.h"
 #include "BalanceTube.h"
+#include "input_trace.h"
+#include "runtime_stats.h"
+#include "balancetube_cal.h"
+#include "running_filter.h"
+#include "ball_estimator.h"
+#include "neopixel.h"
 #include "model_Signals_stm32f334r8.h"
 
 #define PROXIMITY_I2C_ADDRESS         ((uint16_t)0x0052)
 #define VL53L0X_ID                    ((uint16_t)0xEEAA)
+#define VL53L0X_GPIO1_TIMEOUT_MS      100	// polls the sensor if no data ready interrupt came
+#define HAND_ADC_SAMPLES              16	// conversions per 5 ms step, TIM15 triggers at 3.2 kHz
+
+// runs one stage of runBalanceTube() and adds its execution time to runtimeStats
+#define MEASURED_STAGE(stage, call)	do { \
+		uint32_t stageStart = RuntimeStats_Now(); \
+		call; \
+		RuntimeStats_Record(stage, stageStart); \
+	} while (0)
 
 extern ADC_HandleTypeDef hadc1;
 extern I2C_HandleTypeDef hi2c1;
 extern TIM_HandleTypeDef htim2;
 extern TIM_HandleTypeDef htim3;
 extern TIM_HandleTypeDef htim6;
+extern TIM_HandleTypeDef htim15;
 
 extern void Task_5ms();
 
@@ -28,86 +47,226 @@ static void ReadHandPosition();
 static void ControlServo();
 static void ControlDisplay();
 static void ControlLedRing();
+static void RefillLedRing(TIM_HandleTypeDef *htim, uint8_t half);
+static void RunModel(uint32_t missedPeriods);
+static void ServiceSensors();
+static void Step();
+static void RefreshLedRing();
+static void RefreshDisplay();
+static void Monitor();
+static void Idle();
+
+static void ServiceBallDistanceSensor();
+static void BallRangeRead(VL53L0X_Error status, const VL53L0X_Range_t *range);
 
 static void VL53L0X_PROXIMITY_Init(void);
-static uint16_t VL53L0X_PROXIMITY_GetDistance(void);
 
-double map(double x, double in_min, double in_max, double out_min,
-		double out_max);
+float map(float x, float in_min, float in_max, float out_min,
+		float out_max);
 
-volatile uint8_t balanceTube_doStep = 0;
+float balanceTube_dTScale = 1.0F;	// periods covered by the dT of Task_5ms, see esdl_usercfg.h
+volatile InputTrace_Record_t balanceTube_inputRecord = { 0 };
+volatile BalanceTube_RangeSample_t balanceTube_ballRange = { 0 };
 VL53L0X_Dev_t Dev = { .I2cHandle = &hi2c1, .I2cDevAddr = PROXIMITY_I2C_ADDRESS };
 
+static volatile uint8_t ballRangeReady = 0;		// set by the GPIO1 interrupt of the VL53L0X
+static volatile uint32_t ballRangeReady_ms = 0;
+static volatile uint8_t ballRangeReading = 0;	// VL53L0X_StartRangeRead() in progress
+static volatile uint16_t handAdcSamples[HAND_ADC_SAMPLES];	// circular DMA buffer of ADC1
+
+// highest priority first; the offsets keep the slower tasks out of the ticks of the step
+static const Scheduler_Task_t tasks[] = {
+	{ ServiceSensors, 1, 0 },
+	{ Step, 5, 0 },				// on the 5 ms grid of RuntimeStats_BeginStep()
+	{ RefreshLedRing, 20, 2 },
+	{ RefreshDisplay, 20, 4 },
+	{ Monitor, 100, 3 }
+};
+#define RES_MODEL_SIGNALS	((ResourceType) 1)	// ceiling of Step, which writes model_Signals
+_Static_assert(sizeof(tasks) / sizeof(tasks[0]) <= SCHEDULER_MAX_TASKS, "size of runtimeStats.scheduler");
+
 
 void initializeBalanceTube() {
+	RuntimeStats_Initialize();
 	HAL_TIM_Base_Start_IT(&htim6);
 
 	initializeHandDistanceSensor();
+	uint32_t ballSensorStart = RuntimeStats_Now();
 	initializeBallDistanceSensor();
+	runtimeStats.boot.ballSensorInit = RuntimeStats_Now() - ballSensorStart;
+	runtimeStats.boot.ballSensorCalibration = Dev.CalibrationSource;
+	runtimeStats.boot.ballSensorProfile = Dev.RangingProfile;
 	initializeServoMotor();
 	initializeDisplay();
 
+	Scheduler_Initialize(tasks, sizeof(tasks) / sizeof(tasks[0]), Idle);
 }
 
 void runBalanceTube() {
-	if (balanceTube_doStep == 1) {
+	Scheduler_Run();
+}
 
-		ReadHandPosition();
-		ReadBallPosition();
-		ReadButtons();
+// 1 ms: completes the I2C transactions and fetches a new range of the ball sensor
+void ServiceSensors() {
+	I2cAsync_Service();
+	ServiceBallDistanceSensor();
+}
 
-		Task_5ms();
+// 5 ms: sensor inputs, the model and the servo
+void Step() {
+	uint32_t stepStart = RuntimeStats_Now();
+	uint32_t missedPeriods = RuntimeStats_BeginStep(stepStart);
+	balanceTube_inputRecord.time_ms = HAL_GetTick();
+
+	MEASURED_STAGE(RUNTIME_STATS_READ_HAND_POSITION, ReadHandPosition());
+	MEASURED_STAGE(RUNTIME_STATS_READ_BALL_POSITION, ReadBallPosition());
+	MEASURED_STAGE(RUNTIME_STATS_READ_BUTTONS, ReadButtons());
 
-		ControlServo();
-		ControlDisplay();
-		ControlLedRing();
+	MEASURED_STAGE(RUNTIME_STATS_TASK_5MS, RunModel(missedPeriods));
+
+	MEASURED_STAGE(RUNTIME_STATS_CONTROL_SERVO, ControlServo());
+
+	RuntimeStats_EndStep(stepStart);
+}
+
+// 20 ms: the LED ring follows the model at 50 Hz, the display at most at balanceTube.displayRefreshRate
+void RefreshLedRing() {
+	MEASURED_STAGE(RUNTIME_STATS_CONTROL_LED_RING, ControlLedRing());
+}
+
+void RefreshDisplay() {
+	MEASURED_STAGE(RUNTIME_STATS_CONTROL_DISPLAY, ControlDisplay());
+}
 
-		balanceTube_doStep = 0;
+// 100 ms
+void Monitor() {
+	RuntimeStats_UpdateLoad();
+}
+
+// all work is started by interrupts, so the core sleeps until the next one
+void Idle() {
+	__WFI();
+}
+
+// runs Task_5ms() and compensates the periods missed before according to the step policy
+void RunModel(uint32_t missedPeriods) {
+	uint32_t compensated = missedPeriods;
+	if (compensated > BALANCETUBE_CAL(maxMissedPeriods)) {
+		compensated = BALANCETUBE_CAL(maxMissedPeriods);
+	}
+
+	switch (BALANCETUBE_CAL(stepPolicy)) {
+	case BALANCETUBE_STEP_CATCH_UP:
+		for (uint32_t i = 0; i < compensated; i++) {
+			Task_5ms();
+		}
+		runtimeStats.period.catchUpSteps += compensated;
+		Task_5ms();
+		break;
+	case BALANCETUBE_STEP_STRETCH_DT:
+		balanceTube_dTScale = (float) (compensated + 1);
+		Task_5ms();
+		balanceTube_dTScale = 1.0F;
+		break;
+	default:
+		Task_5ms();
+		break;
 	}
 }
 
 void ReadButtons() {
 	model_Signals_autoModeButton = !HAL_GPIO_ReadPin(BTN1_GPIO_Port, BTN1_Pin);
 	model_Signals_startGameButton = !HAL_GPIO_ReadPin(BTN2_GPIO_Port, BTN2_Pin);
+	balanceTube_inputRecord.buttons = (model_Signals_autoModeButton ? INPUT_TRACE_BTN1 : 0)
+			| (model_Signals_startGameButton ? INPUT_TRACE_BTN2 : 0);
 }
 
 void ControlDisplay() {
-	seg7_displayIntWithPoint((int) (model_Signals_score * 10.0), 2);
+	seg7_setRefreshRate(BALANCETUBE_CAL(displayRefreshRate));
+	seg7_displayIntWithPoint((int) (model_Signals_score * 10.0F), 2);
+	seg7_update();
 }
 
 void initializeDisplay() {
 	seg7_displayOn();
 	seg7_displayIntWithPoint(0000, 2);
+	seg7_refresh();
 }
 
 void initializeBallDistanceSensor() {
 	VL53L0X_PROXIMITY_Init();
 	VL53L0X_SetDeviceMode(&Dev, VL53L0X_DEVICEMODE_CONTINUOUS_RANGING);
+	// GPIO1 goes low when a new range is available, until the interrupt is cleared
+	VL53L0X_SetGpioConfig(&Dev, 0, VL53L0X_DEVICEMODE_CONTINUOUS_RANGING,
+			VL53L0X_GPIOFUNCTIONALITY_NEW_MEASURE_READY, VL53L0X_INTERRUPTPOLARITY_LOW);
+	VL53L0X_ClearInterruptMask(&Dev, 0);
+	ballRangeReady_ms = HAL_GetTick();
 	VL53L0X_StartMeasurement(&Dev);
 }
 
+// queues the read of a new range when the sensor has one, BallRangeRead() posts it to the step
+void ServiceBallDistanceSensor() {
+	if (ballRangeReading) {
+		return;
+	}
+	// without an interrupt for a while (missed edge or GPIO1 not connected) the
+	// read checks the interrupt status itself
+	if (!ballRangeReady && ((HAL_GetTick() - ballRangeReady_ms) <= VL53L0X_GPIO1_TIMEOUT_MS)) {
+		return;
+	}
+	if (!ballRangeReady) {
+		ballRangeReady_ms = HAL_GetTick();
+	}
+	ballRangeReady = 0;
+
+	ballRangeReading = 1;
+	if (VL53L0X_StartRangeRead(&Dev, BallRangeRead) != VL53L0X_ERROR_NONE) {
+		ballRangeReading = 0;
+	}
+}
+
+// completion of VL53L0X_StartRangeRead(), called from the I2C interrupt
+void BallRangeRead(VL53L0X_Error status, const VL53L0X_Range_t *range) {
+	// a failed range (no signal: about 8 m) is not a ball position, the previous one is held instead
+	if ((status == VL53L0X_ERROR_NONE) && range->Ready && (range->RangeStatus == RANGE_STATUS_VALID)) {
+		balanceTube_ballRange.distance_mm = range->RangeMilliMeter;
+		balanceTube_ballRange.time_ms = ballRangeReady_ms;
+		balanceTube_ballRange.count++;
+	}
+	ballRangeReading = 0;
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+	if (GPIO_Pin == TOF_INT_Pin) {
+		ballRangeReady_ms = HAL_GetTick();
+		ballRangeReady = 1;
+	}
+}
+
 void initializeHandDistanceSensor() {
 	/* USER CODE BEGIN 2 */
 	HAL_ADCEx_Calibration_Start(&hadc1, ADC_SINGLE_ENDED);
-	HAL_ADC_Start(&hadc1);
+	// every TIM15 update starts a conversion, the DMA writes it into the buffer round robin
+	HAL_ADC_Start_DMA(&hadc1, (uint32_t *) handAdcSamples, HAND_ADC_SAMPLES);
+	HAL_TIM_Base_Start(&htim15);
 }
 
 void initializeServoMotor() {
 	HAL_TIM_PWM_Start(&htim2, TIM_CHANNEL_2);
 }
 
-double map(double x, double in_min, double in_max, double out_min,
-		double out_max) {
+float map(float x, float in_min, float in_max, float out_min,
+		float out_max) {
 	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 void ControlServo() {
-	const double min_us = 1600.0;
-	const double max_us = 1900.0;
+	const float min_us = 1600.0F;
+	const float max_us = 1900.0F;
 
-	static double time_us = 1750.0;
-	time_us = map(model_Signals_servoPosition, 0.0, 1.0, min_us, max_us);
+	static float time_us = 1750.0F;
+	time_us = map(model_Signals_servoPosition, 0.0F, 1.0F, min_us, max_us);
 	if (time_us >= max_us) {
 		time_us = max_us;
 	}
@@ -115,51 +274,45 @@ void ControlServo() {
 		time_us = min_us;
 	}
 
-	__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_2, (uint16_t ) (time_us * 3.2));
+	__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_2, (uint16_t ) (time_us * 3.2F));
 }
 /////////////////////////////////////////////////////////////////////////////////
 
-typedef union {
-	struct {
-		uint8_t b;
-		uint8_t r;
-		uint8_t g;
-	} color;
-	uint32_t data;
-} PixelRGB_t;
-
-// ARR = 76
-#define NEOPIXEL_ZERO	25 // (76 + 1) * 0.32
-#define NEOPIXEL_ONE	49 // (76 + 1) * 0.64
 #define NUM_PIXELS		12
-#define DMA_BUFF_SIZE (NUM_PIXELS * 24) + 1
 
-PixelRGB_t pixel[NUM_PIXELS] = {0};
-uint32_t dmaBuffer[DMA_BUFF_SIZE] = {0};
-uint32_t *pBuff;
-int j;
-int k = 0;
+static uint32_t ledRingFrame[NUM_PIXELS];		// GRB of the model output, streamed from here
+static uint8_t ledRingFrameSent;
+static NeoPixel_Stream_t ledRingStream;			// ping-pong buffer of the circular TIM3 DMA
+static volatile uint8_t ledRingSending;		// frame in progress, until RefillLedRing() stops the DMA
 
 void ControlLedRing() {
+	uint8_t changed = !ledRingFrameSent;
+
+	// the frame must not change under a running transfer, so a new frame waits for the next run
+	if (ledRingSending) {
+		return;
+	}
+	// the model output is packed gamma-corrected straight into the frame the DMA streams, all of one step
+	GetResource(RES_MODEL_SIGNALS);
 	for (int i = 0; i < NUM_PIXELS; i++) {
-		pixel[i].color.r = model_Signals_ledRing[i].red;
-		pixel[i].color.g = model_Signals_ledRing[i].green;
-		pixel[i].color.b = model_Signals_ledRing[i].blue;
+		uint32_t grb = NeoPixel_GammaGrb(model_Signals_ledRing[i].red, model_Signals_ledRing[i].green,
+				model_Signals_ledRing[i].blue);
+		changed |= (grb != ledRingFrame[i]);
+		ledRingFrame[i] = grb;
+	}
+	ReleaseResource(RES_MODEL_SIGNALS);
+	// the ring keeps its colors, so an unchanged frame is not sent again
+	if (!changed) {
+		return;
 	}
 
-	pBuff = dmaBuffer;
-	for (int i = 0; i < NUM_PIXELS; i++) {
-		for (j = 23; j >= 0; j--) {
-			if ((pixel[i].data >> j) & 0x01) {
-				*pBuff = NEOPIXEL_ONE;
-			} else {
-				*pBuff = NEOPIXEL_ZERO;
-			}
-			pBuff++;
-		}
+	NeoPixel_StreamStart(&ledRingStream, ledRingFrame, NUM_PIXELS);
+	ledRingFrameSent = 1;
+	ledRingSending = 1;
+	if (HAL_TIM_PWM_Start_DMA(&htim3, TIM_CHANNEL_1, ledRingStream.buffer, NEOPIXEL_STREAM_DMA_LENGTH) != HAL_OK) {
+		ledRingSending = 0;
+		ledRingFrameSent = 0;
 	}
-	dmaBuffer[DMA_BUFF_SIZE - 1] = 0; // last element must be 0!
-	HAL_TIM_PWM_Start_DMA(&htim3, TIM_CHANNEL_1, dmaBuffer, DMA_BUFF_SIZE);
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -179,7 +332,7 @@ static void VL53L0X_PROXIMITY_Init(void) {
 			if (vl53l0x_id == VL53L0X_ID) {
 				if (VL53L0X_ERROR_NONE == VL53L0X_DataInit(&Dev)) {
 					Dev.Present = 1;
-					SetupSingleShot(&Dev);
+					SetupSingleShot(&Dev, (VL53L0X_RangingProfile_t) BALANCETUBE_CAL(ballRangingProfile));
 				} else {
 					printf("VL53L0X Time of Flight Failed to send its ID!\n");
 				}
@@ -192,65 +345,94 @@ static void VL53L0X_PROXIMITY_Init(void) {
 	}
 }
 
-static uint16_t VL53L0X_PROXIMITY_GetDistance(void) {
-	VL53L0X_RangingMeasurementData_t RangingMeasurementData;
-	VL53L0X_GetRangingMeasurementData(&Dev, &RangingMeasurementData);
-	return RangingMeasurementData.RangeMilliMeter;
-}
-
-#define BUF_SIZE 32
 #define PARAMS 0 // TODO
 void ReadBallPosition() {
 #if PARAMS == 0
-	const double ball_pos_end = 60.0;
-	const double ball_pos_mid = 300.0;
-	const double ball_pos_start = 470.0;
+	const float ball_pos_end = 60.0F;
+	const float ball_pos_mid = 300.0F;
+	const float ball_pos_start = 470.0F;
 #elif PARAMS == 1
-	const double ball_pos_end = 42.0;
-	const double ball_pos_mid = 282.0;
-	const double ball_pos_start = 471.0;
+	const float ball_pos_end = 42.0F;
+	const float ball_pos_mid = 282.0F;
+	const float ball_pos_start = 471.0F;
 #endif
 
-	static double buf[BUF_SIZE] = { 0.0 };
-	static uint8_t i = 0;
-
-	uint16_t distance_ball = VL53L0X_PROXIMITY_GetDistance();
-	buf[i] = (double) distance_ball;
-	i++;
-	if (i >= BUF_SIZE) {
-		i = 0;
+	static RunningFilter_t filter;
+	static BallEstimator_t estimator;
+	static uint32_t takenCount;		// count of the range taken last
+
+	// the I2C interrupt may deliver the next range meanwhile, take the sample at once
+	SuspendAllInterrupts();
+	uint16_t distance_ball = balanceTube_ballRange.distance_mm;
+	uint32_t sample_ms = balanceTube_ballRange.time_ms;
+	uint32_t count = balanceTube_ballRange.count;
+	ResumeAllInterrupts();
+	uint8_t fresh = (count != takenCount);
+	takenCount = count;
+	RuntimeStats_RecordBallRange(count, sample_ms);
+	balanceTube_inputRecord.ballDistanceMm = distance_ball;
+	balanceTube_inputRecord.flags = fresh ? INPUT_TRACE_BALL_FRESH : 0;
+
+	// the estimator sees every range once, with the time it was taken
+	if (fresh) {
+		BallEstimator_Update(&estimator, distance_ball, sample_ms, BALANCETUBE_CAL(ballEstimatorAlpha),
+				BALANCETUBE_CAL(ballEstimatorBeta));
 	}
-	double sum = 0.0;
-	for (uint8_t j = 0; j < BUF_SIZE; j++) {
-		sum += buf[j];
+
+	float dist;
+	if (BALANCETUBE_CAL(ballFilter) == BALANCETUBE_BALL_FILTER_ALPHA_BETA) {
+		dist = (float) BallEstimator_Predict(&estimator, HAL_GetTick())
+				* (1.0F / (float) (1U << BALL_ESTIMATOR_FRAC_BITS));
+	} else {
+		// between two ranges of the sensor the previous one is held
+		RunningFilter_SetLength(&filter, BALANCETUBE_CAL(ballFilterLength));
+		uint32_t mean = RunningFilter_Update(&filter, distance_ball);
+		dist = (float) mean * (1.0F / (float) (1U << RUNNING_FILTER_FRAC_BITS));
 	}
-	double dist = (sum / ((double) BUF_SIZE));
 	if (dist >= ball_pos_mid) {
 		model_Signals_ballPosition = map(dist, ball_pos_start, ball_pos_mid,
-				0.0, 0.5);
+				0.0F, 0.5F);
 	} else {
-		model_Signals_ballPosition = map(dist, ball_pos_mid, ball_pos_end, 0.5,
-				1.0);
+		model_Signals_ballPosition = map(dist, ball_pos_mid, ball_pos_end, 0.5F,
+				1.0F);
 	}
-	if (model_Signals_ballPosition >= 1.0) {
-		model_Signals_ballPosition = 1.0;
+	if (model_Signals_ballPosition >= 1.0F) {
+		model_Signals_ballPosition = 1.0F;
 	}
-	if (model_Signals_ballPosition <= 0.0) {
-		model_Signals_ballPosition = 0.0;
+	if (model_Signals_ballPosition <= 0.0F) {
+		model_Signals_ballPosition = 0.0F;
 	}
 }
 
 
 
+// mean of the conversions of the last step, the buffer always holds the latest ones
 void ReadHandPosition() {
-	HAL_ADC_PollForConversion(&hadc1, 10);
-	model_Signals_adcHandPosition = (double) HAL_ADC_GetValue(&hadc1);
+	uint32_t sum = 0;
+	for (int i = 0; i < HAND_ADC_SAMPLES; i++) {
+		sum += handAdcSamples[i];
+	}
+	uint16_t adc = (uint16_t) ((sum + HAND_ADC_SAMPLES / 2) / HAND_ADC_SAMPLES);
+	balanceTube_inputRecord.adcHandPosition = adc;
+	model_Signals_adcHandPosition = (float32) adc;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 
+// half transfer (half 0) and transfer complete (half 1) of the circular TIM3 DMA
+void RefillLedRing(TIM_HandleTypeDef *htim, uint8_t half) {
+	if (NeoPixel_StreamRefill(&ledRingStream, half)) {
+		HAL_TIM_PWM_Stop_DMA(htim, TIM_CHANNEL_1);
+		ledRingSending = 0;
+	}
+}
+
+void HAL_TIM_PWM_PulseFinishedHalfCpltCallback(TIM_HandleTypeDef *htim) {
+	RefillLedRing(htim, 0);
+}
+
 void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim) {
-	HAL_TIM_PWM_Stop_DMA(htim, TIM_CHANNEL_1);
+	RefillLedRing(htim, 1);
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -8,6 +8,18 @@
 #ifndef SRC_BALANCETUBE_H_
 #define SRC_BALANCETUBE_H_
 
+#include <stdint.h>
+
+// newest range of the ball distance sensor, posted to the 5 ms step
+typedef struct {
+	uint16_t distance_mm;
+	uint16_t reserved;
+	uint32_t time_ms;			// HAL_GetTick() of the data ready interrupt
+	uint32_t count;				// number of valid ranges read, a step takes the range as new when it changed
+} BalanceTube_RangeSample_t;
+
+extern volatile BalanceTube_RangeSample_t balanceTube_ballRange;
+
 void initializeBalanceTube();
 void runBalanceTube();
 
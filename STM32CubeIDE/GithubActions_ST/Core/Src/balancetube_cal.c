@@ -0,0 +1,19 @@
+/*
+ * balancetube_cal.c
+ *
+ * Reference page values of the characteristics of the hand-written code.
+ */
+
+#include "balancetube_cal.h"
+
+__attribute__((section(".balancetube_calibration_rom")))
+const volatile BalanceTube_Cal_t balanceTube_cal = {
+	.stepPolicy = BALANCETUBE_STEP_SKIP,
+	.maxMissedPeriods = 3,
+	.ballFilterLength = 32,
+	.ballFilter = BALANCETUBE_BALL_FILTER_ALPHA_BETA,
+	.ballEstimatorAlpha = 39322,	// 0.6
+	.ballEstimatorBeta = 13107,		// 0.2
+	.ballRangingProfile = 0,		// VL53L0X_PROFILE_DEFAULT
+	.displayRefreshRate = 20,
+};
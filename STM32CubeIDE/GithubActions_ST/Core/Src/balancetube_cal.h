@@ -0,0 +1,55 @@
+/*
+ * balancetube_cal.h
+ *
+ * Characteristics of the hand-written code of the Balance Tube.
+ *
+ * They are linked into the calibration page of the ASCET characteristics at a
+ * fixed offset (.balancetube_calibration_rom in STM32F334R8TX_FLASH.ld), so
+ * that balancetube_cal.a2l can describe them without address patching and
+ * XCP switches between reference and working page like for the model. Always
+ * read them with BALANCETUBE_CAL() to get the value of the active page. Keep
+ * the layout in sync with balancetube_cal.a2l.
+ */
+
+#ifndef SRC_BALANCETUBE_CAL_H_
+#define SRC_BALANCETUBE_CAL_H_
+
+#include <stdint.h>
+#ifdef BALANCETUBE_HOST_SIL
+#include "sil_mem.h"
+#define BALANCETUBE_CAL_PAGE_OFFSET()	SilMem_GetActiveEcuPageOffset()
+#else
+#include "xcp_mem.h"
+#define BALANCETUBE_CAL_PAGE_OFFSET()	XcpMem_GetActiveEcuPageOffset()
+#endif
+
+// handling of 5 ms periods that passed without a step (see runBalanceTube())
+typedef enum {
+	BALANCETUBE_STEP_SKIP = 0,		// run the model once, the missed periods are lost
+	BALANCETUBE_STEP_CATCH_UP = 1,	// run the model once more for every missed period
+	BALANCETUBE_STEP_STRETCH_DT = 2	// run the model once with dT covering the missed periods
+} BalanceTube_StepPolicy_t;
+
+// estimate of the ball distance by ReadBallPosition()
+typedef enum {
+	BALANCETUBE_BALL_FILTER_BOXCAR = 0,		// running mean of the last ballFilterLength steps
+	BALANCETUBE_BALL_FILTER_ALPHA_BETA = 1	// alpha-beta estimator of the fresh samples, see ball_estimator.h
+} BalanceTube_BallFilter_t;
+
+typedef struct {
+	uint8_t stepPolicy;				// BalanceTube_StepPolicy_t
+	uint8_t maxMissedPeriods;		// periods compensated at most by catch up or stretch
+	uint8_t ballFilterLength;		// samples averaged by ReadBallPosition(), 1..RUNNING_FILTER_MAX_LENGTH
+	uint8_t ballFilter;				// BalanceTube_BallFilter_t
+	uint16_t ballEstimatorAlpha;	// distance gain of the alpha-beta estimator in 1/65536
+	uint16_t ballEstimatorBeta;		// velocity gain of the alpha-beta estimator in 1/65536
+	uint8_t ballRangingProfile;		// VL53L0X_RangingProfile_t, applied when the sensor is set up at boot
+	uint8_t displayRefreshRate;		// Hz, updates of the score display at most, 0: every run of the display task (20 ms)
+} BalanceTube_Cal_t;
+
+extern const volatile BalanceTube_Cal_t balanceTube_cal;
+
+#define BALANCETUBE_CAL(member) \
+	(((const volatile BalanceTube_Cal_t *) ((uintptr_t) &balanceTube_cal + BALANCETUBE_CAL_PAGE_OFFSET()))->member)
+
+#endif /* SRC_BALANCETUBE_CAL_H_ */
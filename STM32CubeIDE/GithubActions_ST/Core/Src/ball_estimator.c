@@ -0,0 +1,55 @@
+/*
+ * ball_estimator.c
+ *
+ * Fixed-point alpha-beta estimator, see ball_estimator.h.
+ */
+
+#include "ball_estimator.h"
+
+void BallEstimator_Reset(BallEstimator_t *estimator) {
+	estimator->distance = 0;
+	estimator->velocity = 0;
+	estimator->time_ms = 0;
+	estimator->valid = 0;
+}
+
+void BallEstimator_Update(BallEstimator_t *estimator, uint16_t distance_mm, uint32_t time_ms, uint16_t alpha,
+		uint16_t beta) {
+	int32_t measured = (int32_t) distance_mm << BALL_ESTIMATOR_FRAC_BITS;
+	uint32_t dt_ms = time_ms - estimator->time_ms;
+
+	// an older sample would otherwise wrap to a long gap and restart the estimate
+	if (estimator->valid && ((dt_ms == 0) || ((int32_t) dt_ms < 0))) {
+		return;
+	}
+	if (!estimator->valid || (dt_ms > BALL_ESTIMATOR_MAX_GAP_MS)) {
+		estimator->distance = measured;
+		estimator->velocity = 0;
+		estimator->time_ms = time_ms;
+		estimator->valid = 1;
+		return;
+	}
+
+	// |velocity| <= 2^20 (16 m/s) and dt_ms <= 200 keep the products within 32 bit
+	int32_t predicted = estimator->distance + estimator->velocity * (int32_t) dt_ms;
+	int32_t residual = measured - predicted;
+	estimator->distance = predicted + (int32_t) (((int64_t) alpha * residual) >> 16);
+	int32_t velocity = estimator->velocity + (int32_t) (((int64_t) beta * residual) >> 16) / (int32_t) dt_ms;
+	if (velocity > BALL_ESTIMATOR_MAX_VELOCITY) {
+		velocity = BALL_ESTIMATOR_MAX_VELOCITY;
+	} else if (velocity < -BALL_ESTIMATOR_MAX_VELOCITY) {
+		velocity = -BALL_ESTIMATOR_MAX_VELOCITY;
+	}
+	estimator->velocity = velocity;
+	estimator->time_ms = time_ms;
+}
+
+int32_t BallEstimator_Predict(const BallEstimator_t *estimator, uint32_t now_ms) {
+	uint32_t age_ms = now_ms - estimator->time_ms;
+	if ((int32_t) age_ms < 0) {
+		age_ms = 0;
+	} else if (age_ms > BALL_ESTIMATOR_MAX_PREDICTION_MS) {
+		age_ms = BALL_ESTIMATOR_MAX_PREDICTION_MS;
+	}
+	return estimator->distance + estimator->velocity * (int32_t) age_ms;
+}
@@ -0,0 +1,52 @@
+/*
+ * ball_estimator.h
+ *
+ * Alpha-beta estimator of the ball distance and velocity in fixed point.
+ *
+ * It is fed only with fresh ranges of the VL53L0X together with the time they
+ * were taken, so a range held between two measurements is not counted again
+ * and the irregular sample period (timing budget, polling) is accounted for.
+ * Each sample corrects the prediction of the previous state by alpha times the
+ * residual for the distance and beta times the residual per sample period for
+ * the velocity. Between samples, BallEstimator_Predict() extrapolates the
+ * distance to the current step, so the controller does not see the group
+ * delay of an average.
+ *
+ * Distances are kept in Q16.16 mm, velocities in Q16.16 mm per ms, gains in
+ * 1/65536.
+ */
+
+#ifndef SRC_BALL_ESTIMATOR_H_
+#define SRC_BALL_ESTIMATOR_H_
+
+#include <stdint.h>
+
+#define BALL_ESTIMATOR_FRAC_BITS		16
+#define BALL_ESTIMATOR_MAX_GAP_MS		200		// longer without a sample: restart at the next one
+#define BALL_ESTIMATOR_MAX_PREDICTION_MS	50		// extrapolation horizon of BallEstimator_Predict()
+#define BALL_ESTIMATOR_MAX_VELOCITY		(1 << 20)	// Q16.16 mm/ms (16 m/s), keeps velocity * dt within 32 bit
+
+typedef struct {
+	int32_t distance;			// Q16.16 mm at time_ms
+	int32_t velocity;			// Q16.16 mm/ms, positive: the ball moves away from the sensor
+	uint32_t time_ms;			// time of the last sample
+	uint8_t valid;				// 0 before the first sample
+} BallEstimator_t;
+
+void BallEstimator_Reset(BallEstimator_t *estimator);
+
+/**
+ * Adds a fresh sample taken at time_ms. A sample that is not newer than the
+ * previous one is ignored. The velocity is limited to
+ * +-BALL_ESTIMATOR_MAX_VELOCITY, whatever the gains.
+ */
+void BallEstimator_Update(BallEstimator_t *estimator, uint16_t distance_mm, uint32_t time_ms, uint16_t alpha,
+		uint16_t beta);
+
+/**
+ * \return distance at now_ms in Q16.16 mm, extrapolated for at most
+ *         BALL_ESTIMATOR_MAX_PREDICTION_MS
+ */
+int32_t BallEstimator_Predict(const BallEstimator_t *estimator, uint32_t now_ms);
+
+#endif /* SRC_BALL_ESTIMATOR_H_ */
@@ -0,0 +1,303 @@
+/*
+ * executive.c
+ *
+ * Preemptive fixed-priority executive, see executive.h.
+ *
+ * Task i of the table has the priority count - i, the background 0. ready and
+ * started hold one bit per priority: a task is ready from its activation to
+ * its start and started while it runs or is preempted. current is the
+ * priority of the running code, raised to the ceiling of the resources it
+ * holds; dispatch() runs the ready tasks above it, the highest first, and
+ * nests when a task activates a task of a higher priority.
+ *
+ * On the target, dispatch() runs in thread mode: PendSV returns into it
+ * through an exception frame made up on top of the frame of the preempted
+ * code, and when it is done, an SVC removes its own frame and returns through
+ * the one of the preempted code. So the tasks run with the interrupts of
+ * every priority enabled, and an interrupt that activates a task of a higher
+ * priority pends PendSV again, which preempts the running task the same way.
+ */
+
+#include "executive.h"
+#include "runtime_stats.h"
+
+#define PRIORITY(task)		((uint8_t) (taskCount - (task)))
+
+typedef struct {
+	ResourceType resource;
+	uint8_t priority;			// current before the resource was got
+} Held_t;
+
+static const Executive_Entry_t *table;
+static uint8_t taskCount;
+static volatile uint32_t ready;
+static volatile uint32_t started;
+static volatile uint8_t current;
+static uint32_t activated[EXECUTIVE_MAX_TASKS];		// GetStopwatch() at the activation
+static Held_t held[EXECUTIVE_MAX_RESOURCES];
+static uint8_t heldCount;
+static uint8_t osNesting;
+static uint8_t allNesting;
+static uint32_t allPrimask;		// before the outermost SuspendAllInterrupts()
+
+static void dispatch(void);
+
+#ifndef BALANCETUBE_HOST_SIL
+
+// BASEPRI that masks the interrupts of EXECUTIVE_IRQ_PRIORITY and below
+#define OS_BASEPRI			(EXECUTIVE_IRQ_PRIORITY << (8U - __NVIC_PRIO_BITS))
+_Static_assert(OS_BASEPRI == 0x10, "BASEPRI in PendSV_Handler()");
+
+static uint32_t osBasepri;		// before the outermost SuspendOSInterrupts()
+
+static inline void lockOS(void) {
+	__set_BASEPRI(OS_BASEPRI);
+}
+
+static inline void unlockOS(void) {
+	__set_BASEPRI(0);
+}
+
+static inline void requestDispatch(void) {
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+void SuspendOSInterrupts(void) {
+	uint32_t basepri = __get_BASEPRI();
+	__set_BASEPRI_MAX(OS_BASEPRI);
+	if (osNesting++ == 0) {
+		osBasepri = basepri;
+	}
+}
+
+void ResumeOSInterrupts(void) {
+	if ((osNesting > 0) && (--osNesting == 0)) {
+		__set_BASEPRI(osBasepri);
+	}
+}
+
+// entered with BASEPRI masking the OS interrupts, as PendSV_Handler() left it
+__attribute__((used)) static void dispatchThread(void) {
+	dispatch();
+}
+
+// after dispatchThread(), still in thread mode: the SVC takes the way back
+__attribute__((naked, used)) static void dispatchReturn(void) {
+	__asm volatile (
+		"	mrs		r0, control\n"
+		"	bic		r0, r0, #4\n"			// FPCA: the SVC must stack the short frame its handler removes
+		"	msr		control, r0\n"
+		"	isb\n"
+		"	svc		#0\n"
+		"	b		.\n");
+}
+
+/**
+ * PendSV runs when no other exception is active, the code it preempts is in
+ * thread mode with BASEPRI 0.
+ */
+__attribute__((naked)) void PendSV_Handler(void) {
+	__asm volatile (
+		"	mov		r0, #0x10\n"			// OS_BASEPRI
+		"	msr		basepri, r0\n"
+		"	ldr		r1, =0xE000ED04\n"		// ICSR
+		"	mov		r2, #(1 << 27)\n"		// PENDSVCLR, an activation since the entry is dispatched as well
+		"	str		r2, [r1]\n"
+		"	push	{r0, lr}\n"				// EXC_RETURN of the preempted code, r0 keeps the stack 8 byte aligned
+		"	sub		sp, sp, #(8 * 4)\n"		// r0-r3, r12, lr, pc, xpsr of dispatchThread()
+		"	ldr		r0, =dispatchReturn\n"
+		"	str		r0, [sp, #(5 * 4)]\n"
+		"	ldr		r0, =dispatchThread\n"
+		"	bic		r0, r0, #1\n"
+		"	str		r0, [sp, #(6 * 4)]\n"
+		"	mov		r0, #(1 << 24)\n"		// Thumb state
+		"	str		r0, [sp, #(7 * 4)]\n"
+		"	mvn		r0, #6\n"				// 0xFFFFFFF9: thread mode, main stack, no FP state
+		"	dsb\n"
+		"	bx		r0\n");
+}
+
+/**
+ * The only SVC is the one of dispatchReturn(), it has the priority 0 so that
+ * BASEPRI does not mask it.
+ */
+__attribute__((naked)) void SVC_Handler(void) {
+	__asm volatile (
+		"	add		sp, sp, #(8 * 4)\n"		// frame of the SVC
+		"	mov		r0, #0\n"
+		"	msr		basepri, r0\n"
+		"	pop		{r0, pc}\n");			// return to the preempted code
+}
+
+#else
+
+// the SIL has no interrupts: a dispatch runs when the OS interrupts are resumed
+static uint8_t dispatchRequested;
+
+static inline void lockOS(void) {
+}
+
+static inline void unlockOS(void) {
+}
+
+static inline void requestDispatch(void) {
+	dispatchRequested = 1;
+}
+
+void SuspendOSInterrupts(void) {
+	osNesting++;
+}
+
+void ResumeOSInterrupts(void) {
+	if ((osNesting > 0) && (--osNesting == 0) && dispatchRequested) {
+		dispatchRequested = 0;
+		dispatch();
+	}
+}
+
+#endif
+
+void Executive_Initialize(const Executive_Entry_t *tasks, uint8_t count) {
+	SuspendOSInterrupts();
+	table = tasks;
+	taskCount = (count < EXECUTIVE_MAX_TASKS) ? count : EXECUTIVE_MAX_TASKS;
+	ready = 0;
+	started = 0;
+	current = 0;
+	heldCount = 0;
+	ResumeOSInterrupts();
+}
+
+StatusType ActivateTask(TaskType task) {
+	StatusType status = E_OS_ID;
+	SuspendOSInterrupts();
+	if (task < taskCount) {
+		uint32_t bit = 1UL << PRIORITY(task);
+		if ((ready | started) & bit) {
+			status = E_OS_LIMIT;
+		} else {
+			ready |= bit;
+			activated[task] = GetStopwatch();
+			if (PRIORITY(task) > current) {
+				requestDispatch();
+			}
+			status = E_OK;
+		}
+	}
+	ResumeOSInterrupts();
+	return status;
+}
+
+StatusType TerminateTask(void) {
+	return E_OK;
+}
+
+StatusType GetResource(ResourceType resource) {
+	StatusType status = E_OS_ID;
+	SuspendOSInterrupts();
+	if (resource < taskCount) {
+		if (heldCount >= EXECUTIVE_MAX_RESOURCES) {
+			status = E_OS_ACCESS;
+		} else {
+			held[heldCount].resource = resource;
+			held[heldCount].priority = current;
+			heldCount++;
+			if (PRIORITY(resource) > current) {
+				current = PRIORITY(resource);
+			}
+			status = E_OK;
+		}
+	}
+	ResumeOSInterrupts();
+	return status;
+}
+
+StatusType ReleaseResource(ResourceType resource) {
+	StatusType status = E_OS_NOFUNC;
+	SuspendOSInterrupts();
+	if ((heldCount > 0) && (held[heldCount - 1].resource == resource)) {
+		heldCount--;
+		current = held[heldCount].priority;
+		// tasks activated meanwhile between the priority of the holder and the ceiling
+		if (ready >> (current + 1)) {
+			requestDispatch();
+		}
+		status = E_OK;
+	}
+	ResumeOSInterrupts();
+	return status;
+}
+
+void DisableAllInterrupts(void) {
+	__disable_irq();
+}
+
+void EnableAllInterrupts(void) {
+	__enable_irq();
+}
+
+void SuspendAllInterrupts(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (allNesting++ == 0) {
+		allPrimask = primask;
+	}
+}
+
+void ResumeAllInterrupts(void) {
+	if ((allNesting > 0) && (--allNesting == 0)) {
+		__set_PRIMASK(allPrimask);
+	}
+}
+
+TickType GetStopwatch(void) {
+	return RuntimeStats_Now();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// called and returns with the OS interrupts masked
+void dispatch(void) {
+	uint8_t preempted = current;
+
+	if ((ready >> (preempted + 1)) && (started != 0)) {
+		uint8_t running = (uint8_t) (31 - __builtin_clz(started));
+		runtimeStats.scheduler.task[taskCount - running].preemptions++;
+	}
+
+	for (;;) {
+		uint32_t above = ready >> (preempted + 1);
+		if (above == 0) {
+			break;
+		}
+		uint8_t priority = (uint8_t) (31 - __builtin_clz(above) + preempted + 1);
+		uint32_t bit = 1UL << priority;
+		TaskType task = (TaskType) (taskCount - priority);
+		RuntimeStats_Task_t *stats = &runtimeStats.scheduler.task[task];
+
+		ready &= ~bit;
+		started |= bit;
+		current = priority;
+		uint32_t start = GetStopwatch();
+		uint32_t busy = runtimeStats.scheduler.busy;
+		if (start - activated[task] > stats->lateMax) {
+			stats->lateMax = start - activated[task];
+		}
+
+		unlockOS();
+		table[task]();
+		lockOS();
+
+		// the tasks that preempted this one have added their time to busy
+		uint32_t cycles = (GetStopwatch() - start) - (runtimeStats.scheduler.busy - busy);
+		started &= ~bit;
+		stats->runs++;
+		stats->last = cycles;
+		if (cycles > stats->max) {
+			stats->max = cycles;
+		}
+		runtimeStats.scheduler.busy += cycles;
+	}
+
+	current = preempted;
+}
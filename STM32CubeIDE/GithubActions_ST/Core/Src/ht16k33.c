@@ -6,6 +6,7 @@
  */
 
 #include "ht16k33.h"
+#include "i2c_async.h"
 
 // Commands
 #define HT16K33_ON              0x21  // 0=off 1=on
@@ -61,35 +62,67 @@ volatile uint8_t _displayCache[5];   	//cache for performance
 volatile uint8_t _digits = 4;			//number of digits to display (0-4)
 volatile uint8_t _bright = 15;			//current brightness (0-15)
 
+// frame of the display RAM: address 0, then two bytes per position (the digit in the first)
+#define HT16K33_FRAME_SIZE		(1 + 2 * 5)
+
+static uint8_t _frame[HT16K33_FRAME_SIZE];			// owned by the I2C transaction while it runs
+static I2cAsync_Transaction_t _frameTransaction;
+static volatile uint8_t _frameDirty = 0;			// cache differs from the display
+static uint8_t _refreshRate = 0;					// Hz, 0: every seg7_update()
+static uint32_t _refreshInterval_ms = 0;
+static uint32_t _refreshed_ms = 0;
+
 //##### BEGIN: I2C-WRITE-FUNCTIONS (PRIVATE) #####
-// sends complete cached data per i2c
-void _refresh() {
-	uint8_t pData[2];
+// blocking write, the transactions of the distance sensor go first
+void _transmit(uint8_t *pData, uint16_t size) {
+	static I2cAsync_Transaction_t transaction;
+
+	transaction.hi2c = &HT16K33_I2C_PORT;
+	transaction.devAddress = HT16K33_I2C_ADDR << 1;
+	transaction.client = I2C_ASYNC_CLIENT_DISPLAY;
+	transaction.direction = I2C_ASYNC_WRITE;
+	transaction.data = pData;
+	transaction.size = size;
+	I2cAsync_Transfer(&transaction, HT16K33_I2C_TIMEOUT_MS);
+}
 
-	for (uint8_t pos = 0; pos < 4; pos++) {
-		pData[0] = pos * 2;
-		pData[1] = _displayCache[pos];
+// composes the cached positions into one display RAM write from address 0
+void _composeFrame(uint8_t *frame) {
+	frame[0] = 0x00;
+	for (uint8_t pos = 0; pos < 5; pos++) {
+		frame[1 + pos * 2] = (_displayCache[pos] == SEG7_NONE) ? 0x00 : _displayCache[pos];
+		frame[2 + pos * 2] = 0x00;
+	}
+}
 
-		HAL_I2C_Master_Transmit(&HT16K33_I2C_PORT, HT16K33_I2C_ADDR << 1, pData,2, HAL_MAX_DELAY);
+// a failed frame leaves the display behind the cache, so it is sent again
+void _frameSent(I2cAsync_Transaction_t *transaction) {
+	if (transaction->status != I2C_ASYNC_DONE) {
+		_frameDirty = 1;
 	}
 }
 
+// sends complete cached data per i2c
+void _refresh() {
+	uint8_t frame[HT16K33_FRAME_SIZE];
+
+	_composeFrame(frame);
+	_frameDirty = 0;
+	_transmit(frame, sizeof(frame));
+}
+
 // sends given command per i2c
 void _writeCmd(uint8_t cmd) {
-	HAL_I2C_Master_Transmit(&HT16K33_I2C_PORT, HT16K33_I2C_ADDR << 1, &cmd, 1, HAL_MAX_DELAY);
+	_transmit(&cmd, 1);
 }
 
-// sends value (mask) for specific position per i2c, if different from cached value
+// updates value (mask) for specific position in the cache, sent by seg7_update()
 void _writePos(uint8_t pos, uint8_t mask) {
 	if (_displayCache[pos] == mask)
 		return;
 
-	uint8_t pData[2];
-	pData[0] = pos * 2;
-	pData[1] = mask;
-
-	HAL_I2C_Master_Transmit(&HT16K33_I2C_PORT, HT16K33_I2C_ADDR << 1, pData, 2, HAL_MAX_DELAY);
 	_displayCache[pos] = mask;	// update value in cache
+	_frameDirty = 1;
 }
 
 // update mask to display point at given location, before sending it per i2c
@@ -129,6 +162,41 @@ void seg7_refresh() {
 	_refresh();
 }
 
+void seg7_setRefreshRate(uint8_t hz) {
+	if (hz == _refreshRate)
+		return;
+
+	_refreshRate = hz;
+	_refreshInterval_ms = (hz > 0) ? (1000 + hz / 2) / hz : 0;
+}
+
+void seg7_update() {
+	uint32_t now_ms = HAL_GetTick();
+
+	if (!_frameDirty)
+		return;
+	// the frame belongs to the transaction until it has completed
+	if ((_frameTransaction.status == I2C_ASYNC_QUEUED) || (_frameTransaction.status == I2C_ASYNC_BUSY))
+		return;
+	if ((now_ms - _refreshed_ms) < _refreshInterval_ms)
+		return;
+
+	_composeFrame(_frame);
+	_frameTransaction.hi2c = &HT16K33_I2C_PORT;
+	_frameTransaction.devAddress = HT16K33_I2C_ADDR << 1;
+	_frameTransaction.client = I2C_ASYNC_CLIENT_DISPLAY;
+	_frameTransaction.direction = I2C_ASYNC_WRITE;
+	_frameTransaction.data = _frame;
+	_frameTransaction.size = sizeof(_frame);
+	_frameTransaction.timeout_ms = HT16K33_I2C_TIMEOUT_MS;
+	_frameTransaction.callback = _frameSent;
+	_frameDirty = 0;
+	_refreshed_ms = now_ms;
+	if (I2cAsync_Submit(&_frameTransaction) != HAL_OK) {
+		_frameDirty = 1;
+	}
+}
+
 void seg7_displayOn() {
 	_writeCmd(HT16K33_ON);
 	_writeCmd(HT16K33_DISPLAYON);
@@ -0,0 +1,237 @@
+/*
+ * i2c_async.c
+ *
+ * Queued, interrupt driven I2C transactions, see i2c_async.h.
+ *
+ * Every client has a singly linked list of its submitted transactions; the
+ * one on the bus is the head of its list and is referenced by active. A
+ * register read runs as two sequential transfers, the index write without
+ * stop (I2C_FIRST_FRAME) and the read after a repeated start
+ * (I2C_LAST_FRAME). The optional write after a read is a third transfer,
+ * started from the receive interrupt while the transaction is still active.
+ */
+
+#include "i2c_async.h"
+#include "executive.h"
+#include "runtime_stats.h"
+
+typedef struct {
+	I2cAsync_Transaction_t *head;
+	I2cAsync_Transaction_t *tail;
+	uint64_t latencySum;
+} Queue_t;
+
+static Queue_t queues[I2C_ASYNC_NUM_CLIENTS];
+static I2cAsync_Transaction_t *volatile active = NULL;	// on the bus
+
+static void startNext(void);
+static HAL_StatusTypeDef startTransfer(I2cAsync_Transaction_t *transaction);
+static void complete(I2cAsync_Transaction_t *transaction, I2cAsync_Status_t status);
+
+HAL_StatusTypeDef I2cAsync_Submit(I2cAsync_Transaction_t *transaction) {
+	if ((transaction->status == I2C_ASYNC_QUEUED) || (transaction->status == I2C_ASYNC_BUSY)
+			|| (transaction->client >= I2C_ASYNC_NUM_CLIENTS)) {
+		return HAL_BUSY;
+	}
+	Queue_t *queue = &queues[transaction->client];
+	RuntimeStats_Bus_t *stats = &runtimeStats.i2c[transaction->client];
+
+	transaction->next = NULL;
+	transaction->phase = 0;
+	transaction->submitted = RuntimeStats_Now();
+	transaction->status = I2C_ASYNC_QUEUED;
+
+	SuspendAllInterrupts();
+	if (queue->head == NULL) {
+		queue->head = transaction;
+	} else {
+		queue->tail->next = transaction;
+	}
+	queue->tail = transaction;
+	stats->depth++;
+	if (stats->depth > stats->maxDepth) {
+		stats->maxDepth = stats->depth;
+	}
+	ResumeAllInterrupts();
+
+	startNext();
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef I2cAsync_Transfer(I2cAsync_Transaction_t *transaction, uint32_t timeout_ms) {
+	transaction->callback = NULL;
+	// longer timeouts are clamped, not wrapped (a multiple of 65536 would be the default)
+	transaction->timeout_ms = (timeout_ms < UINT16_MAX) ? (uint16_t) timeout_ms : UINT16_MAX;
+	if (I2cAsync_Submit(transaction) != HAL_OK) {
+		return HAL_BUSY;
+	}
+	// bounded, as every transaction ahead has a timeout as well
+	while ((transaction->status == I2C_ASYNC_QUEUED) || (transaction->status == I2C_ASYNC_BUSY)) {
+		I2cAsync_Service();
+	}
+	switch (transaction->status) {
+	case I2C_ASYNC_DONE:
+		return HAL_OK;
+	case I2C_ASYNC_TIMEOUT:
+		return HAL_TIMEOUT;
+	default:
+		return HAL_ERROR;
+	}
+}
+
+void I2cAsync_Service(void) {
+	SuspendAllInterrupts();
+	I2cAsync_Transaction_t *transaction = active;
+	if (transaction != NULL) {
+		uint32_t timeout_ms = (transaction->timeout_ms != 0) ? transaction->timeout_ms : I2C_ASYNC_DEFAULT_TIMEOUT_MS;
+		if ((HAL_GetTick() - transaction->started_ms) > timeout_ms) {
+			// a reset of the peripheral is the only reliable abort of a stuck transfer
+			HAL_I2C_DeInit(transaction->hi2c);
+			HAL_I2C_Init(transaction->hi2c);
+			runtimeStats.i2c[transaction->client].timeouts++;
+		} else {
+			transaction = NULL;
+		}
+	}
+	ResumeAllInterrupts();
+
+	if (transaction != NULL) {
+		complete(transaction, I2C_ASYNC_TIMEOUT);
+	}
+}
+
+uint8_t I2cAsync_IsIdle(void) {
+	for (int client = 0; client < I2C_ASYNC_NUM_CLIENTS; client++) {
+		if (queues[client].head != NULL) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// puts the head of the highest priority queue on the bus if it is free
+void startNext(void) {
+	for (;;) {
+		I2cAsync_Transaction_t *transaction = NULL;
+		SuspendAllInterrupts();
+		if (active == NULL) {
+			for (int client = 0; (client < I2C_ASYNC_NUM_CLIENTS) && (transaction == NULL); client++) {
+				transaction = queues[client].head;
+			}
+			if (transaction != NULL) {
+				transaction->status = I2C_ASYNC_BUSY;
+				transaction->started = RuntimeStats_Now();
+				transaction->started_ms = HAL_GetTick();
+				active = transaction;
+			}
+		}
+		ResumeAllInterrupts();
+		if (transaction == NULL) {
+			return;
+		}
+
+		// the transfer may complete before this returns, leave the transaction alone then
+		if (startTransfer(transaction) == HAL_OK) {
+			return;
+		}
+		complete(transaction, I2C_ASYNC_ERROR);
+	}
+}
+
+HAL_StatusTypeDef startTransfer(I2cAsync_Transaction_t *transaction) {
+	if (transaction->direction == I2C_ASYNC_WRITE) {
+		return HAL_I2C_Master_Transmit_IT(transaction->hi2c, transaction->devAddress, transaction->data,
+				transaction->size);
+	}
+	return HAL_I2C_Master_Seq_Transmit_IT(transaction->hi2c, transaction->devAddress, &transaction->reg, 1,
+			I2C_FIRST_FRAME);
+}
+
+// takes the transaction on the bus off its queue, starts the next one and notifies the owner
+void complete(I2cAsync_Transaction_t *transaction, I2cAsync_Status_t status) {
+	Queue_t *queue = &queues[transaction->client];
+	RuntimeStats_Bus_t *stats = &runtimeStats.i2c[transaction->client];
+	RuntimeStats_BusTime_t *busTime = &runtimeStats.i2cBus[transaction->client];
+	uint32_t now = RuntimeStats_Now();
+	uint32_t latency = now - transaction->submitted;
+
+	SuspendAllInterrupts();
+	if (transaction != active) {
+		ResumeAllInterrupts();		// completed already (timeout and interrupt at once)
+		return;
+	}
+	active = NULL;
+	queue->head = transaction->next;
+	if (queue->head == NULL) {
+		queue->tail = NULL;
+	}
+	transaction->status = status;
+
+	stats->depth--;
+	stats->transactions++;
+	if (status != I2C_ASYNC_DONE) {
+		stats->errors++;
+	}
+	stats->latencyLast = latency;
+	if (latency > stats->latencyMax) {
+		stats->latencyMax = latency;
+	}
+	queue->latencySum += latency;
+	stats->latencyMean = (uint32_t) (queue->latencySum / stats->transactions);
+	busTime->last = now - transaction->started;
+	if (busTime->last > busTime->max) {
+		busTime->max = busTime->last;
+	}
+	ResumeAllInterrupts();
+
+	startNext();
+	if (transaction->callback != NULL) {
+		transaction->callback(transaction);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+	I2cAsync_Transaction_t *transaction = active;
+	if ((transaction == NULL) || (transaction->hi2c != hi2c)) {
+		return;
+	}
+	if ((transaction->direction == I2C_ASYNC_READ) && (transaction->phase == 0)) {
+		transaction->phase = 1;
+		if (HAL_I2C_Master_Seq_Receive_IT(hi2c, transaction->devAddress, transaction->data, transaction->size,
+				I2C_LAST_FRAME) != HAL_OK) {
+			complete(transaction, I2C_ASYNC_ERROR);
+		}
+		return;
+	}
+	complete(transaction, I2C_ASYNC_DONE);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+	I2cAsync_Transaction_t *transaction = active;
+	if ((transaction == NULL) || (transaction->hi2c != hi2c)) {
+		return;
+	}
+	if (transaction->received != NULL) {
+		transaction->received(transaction);
+	}
+	if ((transaction->postData != NULL) && (transaction->postSize != 0)) {
+		transaction->phase = 2;
+		if (HAL_I2C_Master_Transmit_IT(hi2c, transaction->devAddress, transaction->postData,
+				transaction->postSize) != HAL_OK) {
+			complete(transaction, I2C_ASYNC_ERROR);
+		}
+		return;
+	}
+	complete(transaction, I2C_ASYNC_DONE);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+	I2cAsync_Transaction_t *transaction = active;
+	if ((transaction != NULL) && (transaction->hi2c == hi2c)) {
+		complete(transaction, I2C_ASYNC_ERROR);
+	}
+}
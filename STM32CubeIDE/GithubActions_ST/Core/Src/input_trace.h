@@ -0,0 +1,50 @@
+/*
+ * input_trace.h
+ *
+ * Record of the sensor inputs consumed by one step of runBalanceTube().
+ *
+ * BalanceTube.c fills balanceTube_inputRecord at the points where the inputs
+ * are read (ReadHandPosition, ReadBallPosition, ReadButtons), so a recorder
+ * (XCP DAQ in the 5 ms raster, a debugger, or the host SIL) can capture
+ * exactly what the controller saw. A trace file is a header followed by the
+ * records in step order, both little endian; the number of records follows
+ * from the file size, so a recording that was cut off is still valid.
+ */
+
+#ifndef SRC_INPUT_TRACE_H_
+#define SRC_INPUT_TRACE_H_
+
+#include <stdint.h>
+
+#define INPUT_TRACE_MAGIC		"BTINPUT"	// 8 bytes including the terminating zero
+#define INPUT_TRACE_VERSION		1
+
+#define INPUT_TRACE_BTN1		0x01		// autoModeButton pushed
+#define INPUT_TRACE_BTN2		0x02		// startGameButton pushed
+
+#define INPUT_TRACE_BALL_FRESH	0x01		// ballDistanceMm is a new range of the sensor
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint16_t headerSize;
+	uint16_t recordSize;
+	uint32_t period_ms;			// step period of the recording
+	uint32_t reserved[3];
+} InputTrace_Header_t;
+
+typedef struct {
+	uint32_t time_ms;			// HAL_GetTick() at the start of the step
+	uint16_t adcHandPosition;	// mean of the ADC samples in ReadHandPosition()
+	uint16_t ballDistanceMm;	// balanceTube_ballRange.distance_mm in ReadBallPosition()
+	uint8_t buttons;			// INPUT_TRACE_BTNx of ReadButtons()
+	uint8_t flags;				// INPUT_TRACE_BALL_FRESH, always 0 in older recordings
+	uint8_t reserved[2];
+} InputTrace_Record_t;
+
+_Static_assert(sizeof(InputTrace_Header_t) == 32, "trace header layout");
+_Static_assert(sizeof(InputTrace_Record_t) == 12, "trace record layout");
+
+extern volatile InputTrace_Record_t balanceTube_inputRecord;
+
+#endif /* SRC_INPUT_TRACE_H_ */
@@ -0,0 +1,79 @@
+/*
+ * neopixel.c
+ *
+ * Gamma table, lookup-table encoder and ping-pong streaming of NeoPixel
+ * frames, see neopixel.h.
+ */
+
+#include "neopixel.h"
+
+// compare value of bit b of n
+#define NEOPIXEL_BIT(n, b)		((((n) >> (b)) & 1) ? NEOPIXEL_ONE : NEOPIXEL_ZERO)
+// the bits of nibble n as four bytes, the most significant at the lowest address (little endian)
+#define NEOPIXEL_NIBBLE(n)		((uint32_t) NEOPIXEL_BIT(n, 3) | ((uint32_t) NEOPIXEL_BIT(n, 2) << 8) \
+		| ((uint32_t) NEOPIXEL_BIT(n, 1) << 16) | ((uint32_t) NEOPIXEL_BIT(n, 0) << 24))
+
+static const uint32_t nibbleBits[16] = {
+	NEOPIXEL_NIBBLE(0), NEOPIXEL_NIBBLE(1), NEOPIXEL_NIBBLE(2), NEOPIXEL_NIBBLE(3),
+	NEOPIXEL_NIBBLE(4), NEOPIXEL_NIBBLE(5), NEOPIXEL_NIBBLE(6), NEOPIXEL_NIBBLE(7),
+	NEOPIXEL_NIBBLE(8), NEOPIXEL_NIBBLE(9), NEOPIXEL_NIBBLE(10), NEOPIXEL_NIBBLE(11),
+	NEOPIXEL_NIBBLE(12), NEOPIXEL_NIBBLE(13), NEOPIXEL_NIBBLE(14), NEOPIXEL_NIBBLE(15)
+};
+
+// 255 * (i / 255) ^ NEOPIXEL_GAMMA, rounded (checked by Host/tools/led_ring_bench.c)
+const uint8_t NeoPixel_Gamma[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2,
+	3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6,
+	6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+	12, 13, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19,
+	20, 20, 21, 22, 22, 23, 23, 24, 25, 25, 26, 26, 27, 28, 28, 29,
+	30, 30, 31, 32, 33, 33, 34, 35, 35, 36, 37, 38, 39, 39, 40, 41,
+	42, 43, 43, 44, 45, 46, 47, 48, 49, 49, 50, 51, 52, 53, 54, 55,
+	56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+	73, 74, 75, 76, 77, 78, 79, 81, 82, 83, 84, 85, 87, 88, 89, 90,
+	91, 93, 94, 95, 97, 98, 99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+	113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+	137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+	163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+	192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+	223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+
+// the next pixel into a half, or low periods (compare value 0) after the last one
+static void fillHalf(NeoPixel_Stream_t *stream, uint8_t half) {
+	uint32_t *words = &stream->buffer[half * 6];
+
+	if (stream->next < stream->pixels) {
+		uint32_t color = stream->grb[stream->next++];
+		words[0] = nibbleBits[(color >> 20) & 0x0F];
+		words[1] = nibbleBits[(color >> 16) & 0x0F];
+		words[2] = nibbleBits[(color >> 12) & 0x0F];
+		words[3] = nibbleBits[(color >> 8) & 0x0F];
+		words[4] = nibbleBits[(color >> 4) & 0x0F];
+		words[5] = nibbleBits[color & 0x0F];
+		stream->low[half] = 0;
+	} else {
+		for (int i = 0; i < 6; i++) {
+			words[i] = 0;
+		}
+		stream->low[half] = 1;
+	}
+}
+
+void NeoPixel_StreamStart(NeoPixel_Stream_t *stream, const uint32_t *grb, uint16_t pixels) {
+	stream->grb = grb;
+	stream->pixels = pixels;
+	stream->next = 0;
+	for (uint8_t half = 0; half < NEOPIXEL_STREAM_HALVES; half++) {
+		fillHalf(stream, half);
+	}
+}
+
+uint8_t NeoPixel_StreamRefill(NeoPixel_Stream_t *stream, uint8_t half) {
+	if (stream->low[half]) {
+		return 1;
+	}
+	fillHalf(stream, half);
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * neopixel.h
+ *
+ * Gamma correction and encoder of WS2812 (NeoPixel) frames into the TIM3 CCR1
+ * values streamed by DMA. Every bit of the 24-bit GRB word of a pixel, most significant first,
+ * becomes one PWM period whose high time tells 0 from 1. The compare values
+ * fit into a byte, so the buffer holds one byte per bit and the DMA widens
+ * them to the half-word of the register (see HAL_TIM_PWM_MspInit()). A lookup
+ * table gives the four bytes of a nibble at once, so a pixel takes six word
+ * stores instead of 24 branches.
+ *
+ * The frame is streamed through a ping-pong buffer of two pixels that the DMA
+ * reads in circular mode: when it has read one half (half transfer and
+ * transfer complete interrupt), that half is refilled with the next pixel
+ * while the DMA reads the other one. After the last pixel the halves are
+ * filled with low periods, and the frame is complete when the DMA has read
+ * such a half. The buffer does not depend on the number of pixels; the
+ * interrupt has the 24 bit periods (30 us) of the other half to refill, see
+ * Host/tools/neopixel_stream_bench.c.
+ */
+
+#ifndef SRC_NEOPIXEL_H_
+#define SRC_NEOPIXEL_H_
+
+#include <stdint.h>
+
+// TIM3 ARR = 76, 800 kHz
+#define NEOPIXEL_ZERO		25		// (76 + 1) * 0.32
+#define NEOPIXEL_ONE		49		// (76 + 1) * 0.64
+
+#define NEOPIXEL_STREAM_HALVES		2						// one pixel per half
+#define NEOPIXEL_STREAM_DMA_LENGTH	(NEOPIXEL_STREAM_HALVES * 24)	// bytes of the circular transfer
+
+typedef struct {
+	uint32_t buffer[NEOPIXEL_STREAM_HALVES * 6];	// compare values, source of the circular DMA
+	const uint32_t *grb;			// colors of the frame, must not change until it is complete
+	uint16_t pixels;
+	uint16_t next;					// next pixel to encode
+	uint8_t low[NEOPIXEL_STREAM_HALVES];		// half holds low periods after the frame
+} NeoPixel_Stream_t;
+
+#define NEOPIXEL_GAMMA		2.2
+
+/**
+ * Duty of a channel for a brightness of 0..255: 255 * (brightness / 255) ^
+ * NEOPIXEL_GAMMA, rounded. The LEDs are linear in their duty, the eye is not,
+ * so without it a fade looks stuck at full brightness and drops at the end.
+ */
+extern const uint8_t NeoPixel_Gamma[256];
+
+static inline uint32_t NeoPixel_Grb(uint8_t red, uint8_t green, uint8_t blue) {
+	return ((uint32_t) green << 16) | ((uint32_t) red << 8) | blue;
+}
+
+// packed word of a color given as brightness per channel
+static inline uint32_t NeoPixel_GammaGrb(uint8_t red, uint8_t green, uint8_t blue) {
+	return NeoPixel_Grb(NeoPixel_Gamma[red], NeoPixel_Gamma[green], NeoPixel_Gamma[blue]);
+}
+
+/**
+ * Fills both halves for the start of a frame. Then start the DMA with
+ * stream->buffer and NEOPIXEL_STREAM_DMA_LENGTH in circular mode.
+ *
+ * \param [in] grb  colors as of NeoPixel_Grb()
+ */
+void NeoPixel_StreamStart(NeoPixel_Stream_t *stream, const uint32_t *grb, uint16_t pixels);
+
+/**
+ * Refills the half the DMA has just read: 0 at half transfer, 1 at transfer
+ * complete.
+ *
+ * \return 1 if the frame is complete (the half held low periods), the DMA is
+ *         to be stopped then
+ */
+uint8_t NeoPixel_StreamRefill(NeoPixel_Stream_t *stream, uint8_t half);
+
+#endif /* SRC_NEOPIXEL_H_ */
@@ -0,0 +1,37 @@
+/*
+ * running_filter.c
+ *
+ * Moving average over the last N integer samples, updated in O(1).
+ */
+
+#include "running_filter.h"
+
+void RunningFilter_SetLength(RunningFilter_t *filter, uint8_t length) {
+	if (length < 1) {
+		length = 1;
+	}
+	if (length > RUNNING_FILTER_MAX_LENGTH) {
+		length = RUNNING_FILTER_MAX_LENGTH;
+	}
+	if (length != filter->length) {
+		filter->length = length;
+		filter->count = 0;
+		filter->next = 0;
+		filter->sum = 0;
+	}
+}
+
+uint32_t RunningFilter_Update(RunningFilter_t *filter, uint16_t sample) {
+	if (filter->count < filter->length) {
+		filter->count++;
+	} else {
+		filter->sum -= filter->samples[filter->next];
+	}
+	filter->samples[filter->next] = sample;
+	filter->sum += sample;
+	filter->next++;
+	if (filter->next >= filter->length) {
+		filter->next = 0;
+	}
+	return ((filter->sum << RUNNING_FILTER_FRAC_BITS) + filter->count / 2) / filter->count;
+}
@@ -0,0 +1,39 @@
+/*
+ * running_filter.h
+ *
+ * Moving average over the last N integer samples, updated in O(1): the sum of
+ * the window is kept and corrected by the sample that enters and the one that
+ * drops out, so no sample is summed twice and no floating point is needed.
+ * While the window fills up, the mean is taken over the samples so far.
+ */
+
+#ifndef SRC_RUNNING_FILTER_H_
+#define SRC_RUNNING_FILTER_H_
+
+#include <stdint.h>
+
+#define RUNNING_FILTER_MAX_LENGTH	64
+#define RUNNING_FILTER_FRAC_BITS	8		// the mean is returned in 1/256 of the sample unit
+
+typedef struct {
+	uint16_t samples[RUNNING_FILTER_MAX_LENGTH];
+	uint32_t sum;
+	uint8_t length;				// window length, 0 before the first RunningFilter_SetLength()
+	uint8_t count;				// samples in the window
+	uint8_t next;				// position of the next sample
+} RunningFilter_t;
+
+/**
+ * Sets the window length (limited to 1..RUNNING_FILTER_MAX_LENGTH) and
+ * restarts the filter if it differs from the current one.
+ */
+void RunningFilter_SetLength(RunningFilter_t *filter, uint8_t length);
+
+/**
+ * Adds a sample.
+ *
+ * \return rounded mean of the window in 1/256 of the sample unit
+ */
+uint32_t RunningFilter_Update(RunningFilter_t *filter, uint16_t sample);
+
+#endif /* SRC_RUNNING_FILTER_H_ */
@@ -0,0 +1,158 @@
+/*
+ * runtime_stats.c
+ *
+ * Execution time and step period statistics of the Step task.
+ */
+
+#include <string.h>
+#include "runtime_stats.h"
+
+RuntimeStats_t runtimeStats __attribute__((section(".runtime_stats")));
+
+static uint32_t previousStart;		// cycle counter at the start of the previous step
+static uint32_t nextDeadline_ms;	// tick of the period following the previous step
+static uint8_t firstStep;
+static uint32_t rateWindowCount;	// ball range count at the start of the rate window
+static uint32_t rateWindowStart_ms;
+static uint8_t rateWindowOpen;
+static uint32_t loadWindowStart;	// cycle counter at the previous load update
+static uint32_t loadWindowBusy;		// runtimeStats.scheduler.busy then
+static uint32_t budget[RUNTIME_STATS_NUM_STAGES];	// in CPU cycles
+
+static const uint16_t budget_us[RUNTIME_STATS_NUM_STAGES] = {
+	[RUNTIME_STATS_READ_HAND_POSITION] = RUNTIME_STATS_BUDGET_READ_HAND_POSITION_US,
+	[RUNTIME_STATS_READ_BALL_POSITION] = RUNTIME_STATS_BUDGET_READ_BALL_POSITION_US,
+	[RUNTIME_STATS_READ_BUTTONS] = RUNTIME_STATS_BUDGET_READ_BUTTONS_US,
+	[RUNTIME_STATS_TASK_5MS] = RUNTIME_STATS_BUDGET_TASK_5MS_US,
+	[RUNTIME_STATS_CONTROL_SERVO] = RUNTIME_STATS_BUDGET_CONTROL_SERVO_US,
+	[RUNTIME_STATS_CONTROL_DISPLAY] = RUNTIME_STATS_BUDGET_CONTROL_DISPLAY_US,
+	[RUNTIME_STATS_CONTROL_LED_RING] = RUNTIME_STATS_BUDGET_CONTROL_LED_RING_US,
+	[RUNTIME_STATS_STEP] = RUNTIME_STATS_BUDGET_STEP_US
+};
+
+void RuntimeStats_Initialize(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	memset(&runtimeStats, 0, sizeof(runtimeStats));
+	for (int i = 0; i < RUNTIME_STATS_NUM_STAGES; i++) {
+		runtimeStats.stage[i].min = UINT32_MAX;
+		budget[i] = budget_us[i] * (SystemCoreClock / 1000000);
+	}
+	runtimeStats.period.min = UINT32_MAX;
+	runtimeStats.coreClock_Hz = SystemCoreClock;
+	firstStep = 1;
+	rateWindowOpen = 0;
+	loadWindowStart = RuntimeStats_Now();
+	loadWindowBusy = 0;
+}
+
+void RuntimeStats_Record(RuntimeStats_Stage_t stage, uint32_t start) {
+	RuntimeStats_Counter_t *counter = &runtimeStats.stage[stage];
+	uint32_t cycles = RuntimeStats_Now() - start;	// wraps correctly for up to 67 s at 64 MHz
+
+	counter->last = cycles;
+	if (cycles < counter->min) {
+		counter->min = cycles;
+	}
+	if (cycles > counter->max) {
+		counter->max = cycles;
+	}
+	if (cycles > budget[stage]) {
+		counter->overBudget++;
+	}
+	counter->count++;
+	counter->sum += cycles;
+	counter->mean = (uint32_t) (counter->sum / counter->count);
+}
+
+uint32_t RuntimeStats_BeginStep(uint32_t start) {
+	RuntimeStats_Period_t *period = &runtimeStats.period;
+	uint32_t now_ms = HAL_GetTick();
+	uint32_t missed = 0;
+
+	if (firstStep) {
+		firstStep = 0;
+		runtimeStats.boot.firstStep_ms = now_ms;
+		previousStart = start;
+		nextDeadline_ms = now_ms + RUNTIME_STATS_STEP_PERIOD_MS;
+		return 0;
+	}
+
+	int32_t late_ms = (int32_t) (now_ms - nextDeadline_ms);
+	if (late_ms >= 0) {
+		missed = (uint32_t) late_ms / RUNTIME_STATS_STEP_PERIOD_MS;
+	} else {
+		nextDeadline_ms = now_ms;	// started early, resynchronize to the timer
+	}
+	nextDeadline_ms += (missed + 1) * RUNTIME_STATS_STEP_PERIOD_MS;
+
+	if (missed > 0) {
+		period->lateSteps++;
+		period->missedPeriods += missed;
+		if (missed > period->maxMissedPeriods) {
+			period->maxMissedPeriods = missed;
+		}
+	}
+
+	uint32_t cycles = start - previousStart;
+	uint32_t bin = cycles / (runtimeStats.coreClock_Hz / (1000000 / RUNTIME_STATS_PERIOD_BIN_US));
+	previousStart = start;
+
+	period->last = cycles;
+	if (cycles < period->min) {
+		period->min = cycles;
+	}
+	if (cycles > period->max) {
+		period->max = cycles;
+	}
+	period->histogram[(bin < RUNTIME_STATS_PERIOD_BINS) ? bin : (RUNTIME_STATS_PERIOD_BINS - 1)]++;
+
+	return missed;
+}
+
+void RuntimeStats_EndStep(uint32_t start) {
+	RuntimeStats_Record(RUNTIME_STATS_STEP, start);
+	if (runtimeStats.stage[RUNTIME_STATS_STEP].last > runtimeStats.coreClock_Hz / 1000 * RUNTIME_STATS_STEP_PERIOD_MS) {
+		runtimeStats.period.overruns++;
+	}
+}
+
+void RuntimeStats_RecordBallRange(uint32_t count, uint32_t time_ms) {
+	RuntimeStats_Sensor_t *sensor = &runtimeStats.ballRange;
+
+	if (count == sensor->ranges) {
+		if ((HAL_GetTick() - time_ms) > RUNTIME_STATS_RATE_WINDOW_MS) {
+			sensor->rate_mHz = 0;
+			rateWindowOpen = 0;
+		}
+		return;
+	}
+	sensor->ranges = count;
+
+	if (!rateWindowOpen) {
+		rateWindowOpen = 1;
+		rateWindowCount = count;
+		rateWindowStart_ms = time_ms;
+		return;
+	}
+	uint32_t elapsed_ms = time_ms - rateWindowStart_ms;
+	if (elapsed_ms >= RUNTIME_STATS_RATE_WINDOW_MS) {
+		sensor->rate_mHz = (uint32_t) ((uint64_t) (count - rateWindowCount) * 1000000U / elapsed_ms);
+		rateWindowCount = count;
+		rateWindowStart_ms = time_ms;
+	}
+}
+
+void RuntimeStats_UpdateLoad(void) {
+	uint32_t now = RuntimeStats_Now();
+	uint32_t elapsed = now - loadWindowStart;
+	uint32_t busy = runtimeStats.scheduler.busy - loadWindowBusy;
+
+	if (elapsed > 0) {
+		runtimeStats.scheduler.load_permille = (uint32_t) ((uint64_t) busy * 1000U / elapsed);
+	}
+	loadWindowStart = now;
+	loadWindowBusy = runtimeStats.scheduler.busy;
+}
@@ -0,0 +1,198 @@
+/*
+ * runtime_stats.h
+ *
+ * Execution time statistics of the stages of the Step task and statistics of
+ * its period, measured with the DWT cycle counter of the Cortex-M4,
+ * the duration of the boot, the sample rate of the ball sensor and the
+ * statistics of the tasks of the scheduler.
+ *
+ * The statistics live in a dedicated RAM block (RUNTIME_STATS_RAM in
+ * STM32F334R8TX_FLASH.ld) at a fixed address, so that runtime_stats.a2l can
+ * describe them for INCA without address patching. Keep the layout in sync
+ * with runtime_stats.a2l.
+ */
+
+#ifndef SRC_RUNTIME_STATS_H_
+#define SRC_RUNTIME_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "main.h"
+#include "i2c_async.h"
+#include "scheduler.h"
+
+#define RUNTIME_STATS_STEP_PERIOD_MS	5		// period of the Step row of the task table in BalanceTube.c
+#define RUNTIME_STATS_PERIOD_BINS		24
+#define RUNTIME_STATS_PERIOD_BIN_US		500
+#define RUNTIME_STATS_RATE_WINDOW_MS	1000
+
+/*
+ * Execution time budgets of the stages in microseconds, see overBudget. The
+ * stages of a step share RUNTIME_STATS_BUDGET_STEP_US, a tenth of the step
+ * period.
+ */
+#define RUNTIME_STATS_BUDGET_READ_HAND_POSITION_US		20
+#define RUNTIME_STATS_BUDGET_READ_BALL_POSITION_US		30
+#define RUNTIME_STATS_BUDGET_READ_BUTTONS_US			5
+#define RUNTIME_STATS_BUDGET_TASK_5MS_US				300
+#define RUNTIME_STATS_BUDGET_CONTROL_SERVO_US			5
+#define RUNTIME_STATS_BUDGET_CONTROL_DISPLAY_US			40
+#define RUNTIME_STATS_BUDGET_CONTROL_LED_RING_US		40
+#define RUNTIME_STATS_BUDGET_STEP_US					500
+
+typedef enum {
+	RUNTIME_STATS_READ_HAND_POSITION,
+	RUNTIME_STATS_READ_BALL_POSITION,
+	RUNTIME_STATS_READ_BUTTONS,
+	RUNTIME_STATS_TASK_5MS,
+	RUNTIME_STATS_CONTROL_SERVO,
+	RUNTIME_STATS_CONTROL_DISPLAY,
+	RUNTIME_STATS_CONTROL_LED_RING,
+	RUNTIME_STATS_STEP,				// complete run of the Step task
+	RUNTIME_STATS_NUM_STAGES
+} RuntimeStats_Stage_t;
+
+typedef struct {
+	uint32_t last;					// all values in CPU cycles
+	uint32_t min;
+	uint32_t max;
+	uint32_t mean;
+	uint32_t count;
+	uint32_t overBudget;			// executions that took longer than the budget of the stage
+	uint64_t sum;
+} RuntimeStats_Counter_t;
+
+typedef struct {
+	uint32_t last;					// time between the starts of two steps in CPU cycles
+	uint32_t min;
+	uint32_t max;
+	uint32_t overruns;				// steps that took longer than the step period
+	uint32_t lateSteps;				// steps that started one or more periods late
+	uint32_t missedPeriods;			// periods without a step of their own (dropped releases)
+	uint32_t maxMissedPeriods;		// most periods missed in a row
+	uint32_t catchUpSteps;			// additional runs of the model (BALANCETUBE_STEP_CATCH_UP)
+	uint32_t histogram[RUNTIME_STATS_PERIOD_BINS];	// [i]: period in [i, i + 1) * 500 us, last bin open
+} RuntimeStats_Period_t;
+
+typedef struct {
+	uint32_t transactions;			// completed or failed, see i2c_async.h
+	uint32_t errors;				// failed, including timeouts
+	uint32_t timeouts;
+	uint16_t depth;					// queued, including the one on the bus
+	uint16_t maxDepth;
+	uint32_t latencyLast;			// from submit to completion in CPU cycles
+	uint32_t latencyMax;
+	uint32_t latencyMean;
+} RuntimeStats_Bus_t;
+
+typedef struct {
+	uint32_t last;					// time of a transaction on the bus (all transfers) in CPU cycles
+	uint32_t max;
+} RuntimeStats_BusTime_t;
+
+typedef struct {
+	uint32_t firstStep_ms;			// HAL_GetTick() at the start of the first step, time since HAL_Init()
+	uint32_t ballSensorInit;		// initializeBallDistanceSensor() in CPU cycles
+	uint8_t ballSensorCalibration;	// VL53L0X_CalibrationSource_t, see vl53l0x_tof.h
+	uint8_t ballSensorProfile;		// VL53L0X_RangingProfile_t applied
+	uint8_t reserved[2];
+} RuntimeStats_Boot_t;
+
+typedef struct {
+	uint32_t ranges;				// valid ranges taken by the steps, the count of balanceTube_ballRange
+	uint32_t rate_mHz;				// valid ranges per second over the last window, in 1/1000 Hz
+} RuntimeStats_Sensor_t;
+
+typedef struct {
+	uint32_t runs;
+	uint32_t overruns;				// releases dropped because the task had not completed the previous one
+	uint32_t lateMax;				// longest time from an activation to the start of the task in CPU cycles
+	uint32_t last;					// execution time in CPU cycles, without the time the task was preempted
+	uint32_t max;
+	uint32_t preemptions;			// by tasks of a higher priority
+} RuntimeStats_Task_t;
+
+typedef struct {
+	RuntimeStats_Task_t task[SCHEDULER_MAX_TASKS];	// in the order of the task table
+	uint32_t busy;					// CPU cycles spent in tasks, wraps
+	uint32_t idle;					// passes of the main loop, which sleeps in the idle hook
+	uint32_t load_permille;			// share of busy in the CPU cycles between the last two load updates
+} RuntimeStats_Scheduler_t;
+
+typedef struct {
+	RuntimeStats_Counter_t stage[RUNTIME_STATS_NUM_STAGES];
+	uint32_t coreClock_Hz;
+	RuntimeStats_Period_t period;
+	RuntimeStats_Bus_t i2c[I2C_ASYNC_NUM_CLIENTS];	// per client of the I2C bus
+	RuntimeStats_Boot_t boot;
+	RuntimeStats_BusTime_t i2cBus[I2C_ASYNC_NUM_CLIENTS];
+	RuntimeStats_Sensor_t ballRange;
+	RuntimeStats_Scheduler_t scheduler;
+} RuntimeStats_t;
+
+_Static_assert(sizeof(RuntimeStats_Counter_t) == 32, "layout of runtime_stats.a2l");
+_Static_assert(offsetof(RuntimeStats_t, period) == 0x104, "layout of runtime_stats.a2l");
+_Static_assert(offsetof(RuntimeStats_t, i2c) == 0x184, "layout of runtime_stats.a2l");
+_Static_assert(sizeof(RuntimeStats_Bus_t) == 28, "layout of runtime_stats.a2l");
+_Static_assert(offsetof(RuntimeStats_t, boot) == 0x1BC, "layout of runtime_stats.a2l");
+_Static_assert(offsetof(RuntimeStats_t, i2cBus) == 0x1C8, "layout of runtime_stats.a2l");
+_Static_assert(offsetof(RuntimeStats_t, ballRange) == 0x1D8, "layout of runtime_stats.a2l");
+_Static_assert(offsetof(RuntimeStats_t, scheduler) == 0x1E0, "layout of runtime_stats.a2l");
+_Static_assert(sizeof(RuntimeStats_Task_t) == 24, "layout of runtime_stats.a2l");
+_Static_assert(sizeof(RuntimeStats_t) <= 1024, "size of RUNTIME_STATS_RAM");
+
+extern RuntimeStats_t runtimeStats;
+
+/**
+ * Enables the cycle counter and resets the statistics.
+ */
+void RuntimeStats_Initialize(void);
+
+static inline uint32_t RuntimeStats_Now(void) {
+	return DWT->CYCCNT;
+}
+
+/**
+ * Adds the cycles elapsed since start (a value of RuntimeStats_Now()) to the
+ * statistics of a stage.
+ */
+void RuntimeStats_Record(RuntimeStats_Stage_t stage, uint32_t start);
+
+/**
+ * Updates the period statistics at the start of a step.
+ *
+ * The Step task is released by Scheduler_Tick() every
+ * RUNTIME_STATS_STEP_PERIOD_MS. A release that comes while the previous run
+ * has not completed is dropped and counted as an overrun of the task in
+ * runtimeStats.scheduler; the periods missed that way are detected from
+ * HAL_GetTick() against the 5 ms grid of the first step.
+ *
+ * \param [in] start  RuntimeStats_Now() at the start of the step.
+ * \return number of periods missed since the previous step
+ */
+uint32_t RuntimeStats_BeginStep(uint32_t start);
+
+/**
+ * Records the execution time of the complete step and counts overruns.
+ */
+void RuntimeStats_EndStep(uint32_t start);
+
+/**
+ * Updates the sample rate of the ball sensor, once per step.
+ *
+ * The rate is taken from the ranges counted between the first new range after
+ * RUNTIME_STATS_RATE_WINDOW_MS and the one starting the window, over the time
+ * between them. It drops to 0 when no range arrives for a whole window.
+ *
+ * \param [in] count    ranges read from the sensor so far
+ * \param [in] time_ms  HAL_GetTick() of the newest of them
+ */
+void RuntimeStats_RecordBallRange(uint32_t count, uint32_t time_ms);
+
+/**
+ * Updates runtimeStats.scheduler.load_permille from the cycles spent in tasks
+ * since the previous call, from a task of a fixed period.
+ */
+void RuntimeStats_UpdateLoad(void);
+
+#endif /* SRC_RUNTIME_STATS_H_ */
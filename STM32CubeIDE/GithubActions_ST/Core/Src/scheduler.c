@@ -0,0 +1,61 @@
+/*
+ * scheduler.c
+ *
+ * Table-driven periodic activation, see scheduler.h.
+ *
+ * The releases of a tick are activated with the OS interrupts suspended, so
+ * the executive dispatches them together, the highest priority first.
+ */
+
+#include <stddef.h>
+#include "scheduler.h"
+#include "runtime_stats.h"
+
+static const Scheduler_Task_t *table;
+static uint8_t taskCount;
+static void (*idleHook)(void);
+static uint32_t tick_ms;
+static uint32_t nextRelease_ms[SCHEDULER_MAX_TASKS];
+static Executive_Entry_t entries[SCHEDULER_MAX_TASKS];
+
+StatusType Scheduler_Initialize(const Scheduler_Task_t *tasks, uint8_t count, void (*idle)(void)) {
+	if (count > SCHEDULER_MAX_TASKS) {
+		return E_OS_LIMIT;
+	}
+	SuspendOSInterrupts();
+	table = tasks;
+	taskCount = count;
+	idleHook = idle;
+	tick_ms = 0;
+	for (uint8_t i = 0; i < taskCount; i++) {
+		nextRelease_ms[i] = (tasks[i].offset_ms > 0) ? tasks[i].offset_ms : tasks[i].period_ms;
+		entries[i] = tasks[i].run;
+	}
+	Executive_Initialize(entries, taskCount);
+	ResumeOSInterrupts();
+	return E_OK;
+}
+
+void Scheduler_Tick(void) {
+	SuspendOSInterrupts();
+	tick_ms++;
+	for (uint8_t i = 0; i < taskCount; i++) {
+		if (tick_ms != nextRelease_ms[i]) {
+			continue;
+		}
+		nextRelease_ms[i] += table[i].period_ms;
+		if (ActivateTask(i) != E_OK) {
+			runtimeStats.scheduler.task[i].overruns++;
+		}
+	}
+	ResumeOSInterrupts();
+}
+
+void Scheduler_Run(void) {
+	runtimeStats.scheduler.idle++;
+	if (idleHook != NULL) {
+		SuspendAllInterrupts();
+		idleHook();
+		ResumeAllInterrupts();
+	}
+}
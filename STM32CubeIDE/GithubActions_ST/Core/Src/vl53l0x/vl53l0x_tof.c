@@ -21,8 +21,10 @@
 #include "stm32f3xx_hal.h"
 #include "vl53l0x_def.h"
 #include "vl53l0x_api.h"
+#include "vl53l0x_api_core.h"
 
 #include "vl53l0x_tof.h"
+#include "vl53l0x_cal_store.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -30,26 +32,65 @@
 #define I2C_TIME_OUT_BYTE   1
 
 #define VL53L0X_OsDelay(...) HAL_Delay(2)
-    
+
+#define RESULT_BLOCK_INDEX  VL53L0X_REG_RESULT_INTERRUPT_STATUS   /* followed by the 12 bytes at 0x14 */
+
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
+static I2cAsync_Transaction_t _I2CTransaction;
+
 /* Private function prototypes -----------------------------------------------*/
+static void _PrepareRangeRead(VL53L0X_DEV Dev);
+static void _RangeReceived(I2cAsync_Transaction_t *transaction);
+static void _RangeReadDone(I2cAsync_Transaction_t *transaction);
+static VL53L0X_Error _RestoreRefCalibration(VL53L0X_DEV Dev, const VL53L0X_CalRecord_t *record);
+static VL53L0X_Error _PerformRefCalibration(VL53L0X_DEV Dev, VL53L0X_CalRecord_t *record);
+
 /* Exported functions --------------------------------------------------------*/
-    
+
+/*
+ * The register accesses of the API are synchronous: they queue a transaction
+ * (see i2c_async.h) and wait for it, which is fine for the initialization.
+ * In operation the range is fetched with VL53L0X_StartRangeRead(), which
+ * returns at once.
+ *
+ * The transaction may be the one of a range read before, so the read-only
+ * extras of that (received hook, interrupt clear) are reset.
+ */
 int _I2CWrite(VL53L0X_DEV Dev, uint8_t *pdata, uint32_t count) {
     int status;
     int i2c_time_out = I2C_TIME_OUT_BASE+ count* I2C_TIME_OUT_BYTE;
 
-    status = HAL_I2C_Master_Transmit(Dev->I2cHandle, Dev->I2cDevAddr, pdata, count, i2c_time_out);
+    _I2CTransaction.hi2c = Dev->I2cHandle;
+    _I2CTransaction.devAddress = Dev->I2cDevAddr;
+    _I2CTransaction.client = I2C_ASYNC_CLIENT_SENSOR;
+    _I2CTransaction.direction = I2C_ASYNC_WRITE;
+    _I2CTransaction.received = NULL;
+    _I2CTransaction.postData = NULL;
+    _I2CTransaction.postSize = 0;
+    _I2CTransaction.data = pdata;
+    _I2CTransaction.size = count;
+    status = I2cAsync_Transfer(&_I2CTransaction, i2c_time_out);
     
     return status;
 }
 
-int _I2CRead(VL53L0X_DEV Dev, uint8_t *pdata, uint32_t count) {
+/* index write, repeated start and read of count bytes */
+int _I2CRead(VL53L0X_DEV Dev, uint8_t index, uint8_t *pdata, uint32_t count) {
     int status;
-    int i2c_time_out = I2C_TIME_OUT_BASE+ count* I2C_TIME_OUT_BYTE;
-
-    status = HAL_I2C_Master_Receive(Dev->I2cHandle, Dev->I2cDevAddr|1, pdata, count, i2c_time_out);
+    int i2c_time_out = I2C_TIME_OUT_BASE+ (count + 1)* I2C_TIME_OUT_BYTE;
+
+    _I2CTransaction.hi2c = Dev->I2cHandle;
+    _I2CTransaction.devAddress = Dev->I2cDevAddr;
+    _I2CTransaction.client = I2C_ASYNC_CLIENT_SENSOR;
+    _I2CTransaction.direction = I2C_ASYNC_READ;
+    _I2CTransaction.received = NULL;
+    _I2CTransaction.postData = NULL;
+    _I2CTransaction.postSize = 0;
+    _I2CTransaction.reg = index;
+    _I2CTransaction.data = pdata;
+    _I2CTransaction.size = count;
+    status = I2cAsync_Transfer(&_I2CTransaction, i2c_time_out);
     
     return status;
 }
@@ -58,19 +99,11 @@ VL53L0X_Error VL53L0X_RdByte(VL53L0X_DEV Dev, uint8_t index, uint8_t *data) {
     VL53L0X_Error Status = VL53L0X_ERROR_NONE;
     int32_t status_int;
 
-    status_int = _I2CWrite(Dev, &index, 1);
-    
-    if( status_int ){
-        Status = VL53L0X_ERROR_CONTROL_INTERFACE;
-        goto done;
-    }
-    
-    status_int = _I2CRead(Dev, data, 1);
+    status_int = _I2CRead(Dev, index, data, 1);
     
     if (status_int != 0) {
         Status = VL53L0X_ERROR_CONTROL_INTERFACE;
     }
-done:
     return Status;
 }
 
@@ -103,19 +136,11 @@ VL53L0X_Error VL53L0X_ReadMulti(VL53L0X_DEV Dev, uint8_t index, uint8_t *pdata,
     VL53L0X_Error Status = VL53L0X_ERROR_NONE;
     int32_t status_int;
     
-    status_int = _I2CWrite(Dev, &index, 1);
+    status_int = _I2CRead(Dev, index, pdata, count);
     
     if (status_int != 0) {
         Status = VL53L0X_ERROR_CONTROL_INTERFACE;
-        goto done;
     }
-    
-    status_int = _I2CRead(Dev, pdata, count);
-    
-    if (status_int != 0) {
-        Status = VL53L0X_ERROR_CONTROL_INTERFACE;
-    }
-done:
     return Status;
 }
 
@@ -124,14 +149,7 @@ VL53L0X_Error VL53L0X_RdWord(VL53L0X_DEV Dev, uint8_t index, uint16_t *data) {
     VL53L0X_Error Status = VL53L0X_ERROR_NONE;
     int32_t status_int;
 
-    status_int = _I2CWrite(Dev, &index, 1);
-
-    if( status_int ){
-        Status = VL53L0X_ERROR_CONTROL_INTERFACE;
-        goto done;
-    }
-    
-    status_int = _I2CRead(Dev, _I2CBuffer, 2);
+    status_int = _I2CRead(Dev, index, _I2CBuffer, 2);
     
     if (status_int != 0) {
         Status = VL53L0X_ERROR_CONTROL_INTERFACE;
@@ -147,14 +165,7 @@ VL53L0X_Error VL53L0X_RdDWord(VL53L0X_DEV Dev, uint8_t index, uint32_t *data) {
     VL53L0X_Error Status = VL53L0X_ERROR_NONE;
     int32_t status_int;
 
-    status_int = _I2CWrite(Dev, &index, 1);
-    
-    if (status_int != 0) {
-        Status = VL53L0X_ERROR_CONTROL_INTERFACE;
-        goto done;
-    }
-    
-    status_int = _I2CRead(Dev, _I2CBuffer, 4);
+    status_int = _I2CRead(Dev, index, _I2CBuffer, 4);
     
     if (status_int != 0) {
         Status = VL53L0X_ERROR_CONTROL_INTERFACE;
@@ -241,21 +252,58 @@ VL53L0X_Error VL53L0X_PollingDelay(VL53L0X_DEV Dev) {
     return status;
 }
 
+VL53L0X_Error VL53L0X_GetRange(VL53L0X_DEV Dev, VL53L0X_Range_t *pRange) {
+    I2cAsync_Transaction_t *read = &Dev->RangeRead;
+
+    if ((read->status == I2C_ASYNC_QUEUED) || (read->status == I2C_ASYNC_BUSY)) {
+        return VL53L0X_ERROR_CONTROL_INTERFACE;
+    }
+    _PrepareRangeRead(Dev);
+    if (I2cAsync_Transfer(read, read->timeout_ms) != HAL_OK) {
+        return VL53L0X_ERROR_CONTROL_INTERFACE;
+    }
+    *pRange = Dev->Range;
+    return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_StartRangeRead(VL53L0X_DEV Dev, VL53L0X_RangeCallback_t Callback) {
+    I2cAsync_Transaction_t *read = &Dev->RangeRead;
+
+    if ((read->status == I2C_ASYNC_QUEUED) || (read->status == I2C_ASYNC_BUSY)) {
+        return VL53L0X_ERROR_CONTROL_INTERFACE;
+    }
+    Dev->RangeCallback = Callback;
+    _PrepareRangeRead(Dev);
+    read->callback = _RangeReadDone;
+    if (I2cAsync_Submit(read) != HAL_OK) {
+        return VL53L0X_ERROR_CONTROL_INTERFACE;
+    }
+    return VL53L0X_ERROR_NONE;
+}
+
+/* signal limit, timing budget and VCSEL periods of the VL53L0X_RangingProfile_t */
+typedef struct {
+    FixPoint1616_t signalLimit;
+    uint32_t timingBudget;
+    uint8_t preRangeVcselPeriod;
+    uint8_t finalRangeVcselPeriod;
+} _RangingSettings_t;
+
+static const _RangingSettings_t _RangingSettings[VL53L0X_NUM_PROFILES] = {
+    [VL53L0X_PROFILE_DEFAULT]       = { (FixPoint1616_t)(0.1*65536),  33000,  18, 14 },
+    [VL53L0X_PROFILE_HIGH_SPEED]    = { (FixPoint1616_t)(0.25*65536), 20000,  14, 10 },
+    [VL53L0X_PROFILE_HIGH_ACCURACY] = { (FixPoint1616_t)(0.25*65536), 200000, 14, 10 },
+};
+
 /**
  *  Setup all detected sensors for single shot mode and setup ranging configuration
  */
-void SetupSingleShot(VL53L0X_DEV Dev)
+void SetupSingleShot(VL53L0X_DEV Dev, VL53L0X_RangingProfile_t Profile)
 {
   int status;
-  uint8_t VhvSettings;
-  uint8_t PhaseCal;
-  uint32_t refSpadCount;
-	uint8_t isApertureSpads;
-	FixPoint1616_t signalLimit = (FixPoint1616_t)(0.25*65536);
-	FixPoint1616_t sigmaLimit = (FixPoint1616_t)(18*65536);
-	uint32_t timingBudget = 33000;
-	uint8_t preRangeVcselPeriod = 14;
-	uint8_t finalRangeVcselPeriod = 10;
+  VL53L0X_Error uidStatus;
+  VL53L0X_CalRecord_t calibration;
+  const _RangingSettings_t *settings;
 
                           
   if( Dev->Present){
@@ -265,14 +313,20 @@ void SetupSingleShot(VL53L0X_DEV Dev)
     }
     
     
-    status = VL53L0X_PerformRefCalibration(Dev, &VhvSettings, &PhaseCal);
-    if( status ){
-      printf("VL53L0X_PerformRefCalibration failed\n");
-    }
-    
-    status = VL53L0X_PerformRefSpadManagement(Dev, &refSpadCount, &isApertureSpads);
-    if( status ){
-      printf("VL53L0X_PerformRefSpadManagement failed\n");
+    /* the stored calibration must belong to this part */
+    uidStatus = VL53L0X_get_info_from_device(Dev, 4);
+    if( uidStatus == VL53L0X_ERROR_NONE && VL53L0X_CalStore_Load(&calibration)
+        && calibration.partUidUpper == VL53L0X_GETDEVICESPECIFICPARAMETER(Dev, PartUIDUpper)
+        && calibration.partUidLower == VL53L0X_GETDEVICESPECIFICPARAMETER(Dev, PartUIDLower)
+        && _RestoreRefCalibration(Dev, &calibration) == VL53L0X_ERROR_NONE ){
+      Dev->CalibrationSource = VL53L0X_CALIBRATION_RESTORED;
+    } else if( _PerformRefCalibration(Dev, &calibration) == VL53L0X_ERROR_NONE ){
+      Dev->CalibrationSource = VL53L0X_CALIBRATION_PERFORMED;
+      if( uidStatus != VL53L0X_ERROR_NONE ){
+        printf("VL53L0X part UID read failed, calibration not stored\n");
+      } else if( VL53L0X_CalStore_Save(&calibration) != HAL_OK ){
+        printf("VL53L0X_CalStore_Save failed\n");
+      }
     }
     
     status = VL53L0X_SetDeviceMode(Dev, VL53L0X_DEVICEMODE_SINGLE_RANGING); // Setup in single ranging mode
@@ -280,7 +334,8 @@ void SetupSingleShot(VL53L0X_DEV Dev)
       printf("VL53L0X_SetDeviceMode failed\n");
     }
     
-    status = VL53L0X_SetLimitCheckEnable(Dev, VL53L0X_CHECKENABLE_SIGMA_FINAL_RANGE, 1); // Enable Sigma limit
+    /* VL53L0X_DataInit() enables the sigma limit, VL53L0X_GetRange() does not compute the sigma estimate */
+    status = VL53L0X_SetLimitCheckEnable(Dev, VL53L0X_CHECKENABLE_SIGMA_FINAL_RANGE, 0);
     if( status ){
       printf("VL53L0X_SetLimitCheckEnable failed\n");
     }
@@ -291,34 +346,29 @@ void SetupSingleShot(VL53L0X_DEV Dev)
     }
     
     /* Ranging configuration */
-    signalLimit = (FixPoint1616_t)(0.1*65536);
-    sigmaLimit = (FixPoint1616_t)(60*65536);
-    timingBudget = 33000;
-    preRangeVcselPeriod = 18;
-    finalRangeVcselPeriod = 14;
-    
-    status = VL53L0X_SetLimitCheckValue(Dev,  VL53L0X_CHECKENABLE_SIGNAL_RATE_FINAL_RANGE, signalLimit);
-    
-    if( status ){
-      printf("VL53L0X_SetLimitCheckValue failed\n");
+    if( (unsigned)Profile >= VL53L0X_NUM_PROFILES ){
+      Profile = VL53L0X_PROFILE_DEFAULT;
     }
+    settings = &_RangingSettings[Profile];
+    Dev->RangingProfile = (uint8_t)Profile;
+    
+    status = VL53L0X_SetLimitCheckValue(Dev,  VL53L0X_CHECKENABLE_SIGNAL_RATE_FINAL_RANGE, settings->signalLimit);
     
-    status = VL53L0X_SetLimitCheckValue(Dev,  VL53L0X_CHECKENABLE_SIGMA_FINAL_RANGE, sigmaLimit);
     if( status ){
       printf("VL53L0X_SetLimitCheckValue failed\n");
     }
     
-    status = VL53L0X_SetMeasurementTimingBudgetMicroSeconds(Dev,  timingBudget);
+    status = VL53L0X_SetMeasurementTimingBudgetMicroSeconds(Dev,  settings->timingBudget);
     if( status ){
       printf("VL53L0X_SetMeasurementTimingBudgetMicroSeconds failed\n");
     }
     
-    status = VL53L0X_SetVcselPulsePeriod(Dev,  VL53L0X_VCSEL_PERIOD_PRE_RANGE, preRangeVcselPeriod);
+    status = VL53L0X_SetVcselPulsePeriod(Dev,  VL53L0X_VCSEL_PERIOD_PRE_RANGE, settings->preRangeVcselPeriod);
     if( status ){
       printf("VL53L0X_SetVcselPulsePeriod failed\n");
     }
     
-    status = VL53L0X_SetVcselPulsePeriod(Dev,  VL53L0X_VCSEL_PERIOD_FINAL_RANGE, finalRangeVcselPeriod);
+    status = VL53L0X_SetVcselPulsePeriod(Dev,  VL53L0X_VCSEL_PERIOD_FINAL_RANGE, settings->finalRangeVcselPeriod);
     if( status ){
       printf("VL53L0X_SetVcselPulsePeriod failed\n");
     }
@@ -327,3 +377,158 @@ void SetupSingleShot(VL53L0X_DEV Dev)
   }
 }
 
+
+/* Private functions ---------------------------------------------------------*/
+/* burst read of the interrupt status and the result block, with the interrupt clear behind it */
+static void _PrepareRangeRead(VL53L0X_DEV Dev) {
+    I2cAsync_Transaction_t *read = &Dev->RangeRead;
+
+    /*
+     * A single write of 1 clears the interrupt; VL53L0X_ClearInterruptMask()
+     * writes 0 afterwards as well, which the sensor does not need.
+     */
+    Dev->InterruptClearBuffer[0] = VL53L0X_REG_SYSTEM_INTERRUPT_CLEAR;
+    Dev->InterruptClearBuffer[1] = 0x01;
+
+    read->hi2c = Dev->I2cHandle;
+    read->devAddress = Dev->I2cDevAddr;
+    read->client = I2C_ASYNC_CLIENT_SENSOR;
+    read->direction = I2C_ASYNC_READ;
+    read->reg = RESULT_BLOCK_INDEX;
+    read->data = Dev->RangeBuffer;
+    read->size = sizeof(Dev->RangeBuffer);
+    read->postData = Dev->InterruptClearBuffer;
+    read->postSize = sizeof(Dev->InterruptClearBuffer);
+    read->timeout_ms = I2C_TIME_OUT_BASE + (read->size + 1 + read->postSize) * I2C_TIME_OUT_BYTE;
+    read->received = _RangeReceived;
+    read->callback = NULL;
+    read->context = Dev;
+}
+
+/*
+ * called from the I2C interrupt when the result block is in, converts the
+ * range like VL53L0X_GetRangingMeasurementData() and skips the interrupt clear
+ * if there was no new range
+ */
+static void _RangeReceived(I2cAsync_Transaction_t *transaction) {
+    VL53L0X_DEV Dev = transaction->context;
+    VL53L0X_Range_t *range = &Dev->Range;
+    uint8_t *result = &Dev->RangeBuffer[1];
+    uint8_t deviceRangeStatus = (result[0] & 0x78) >> 3;
+
+    range->Ready = ((Dev->RangeBuffer[0] & 0x07) == VL53L0X_REG_SYSTEM_INTERRUPT_GPIO_NEW_SAMPLE_READY);
+    range->RangeMilliMeter = 0;
+    range->RangeStatus = RANGE_STATUS_NONE;
+    if (!range->Ready) {
+        transaction->postSize = 0;
+        return;
+    }
+
+    uint16_t LinearityCorrectiveGain = PALDevDataGet(Dev, LinearityCorrectiveGain);
+    uint16_t value = VL53L0X_MAKEUINT16(result[11], result[10]);
+    if (LinearityCorrectiveGain != 1000) {
+        value = (uint16_t)((LinearityCorrectiveGain * value + 500) / 1000);
+    }
+    if (PALDevDataGet(Dev, RangeFractionalEnable)) {
+        value >>= 2;
+    }
+    range->RangeMilliMeter = value;
+
+    /* as VL53L0X_get_pal_range_status() without the limit checks */
+    switch (deviceRangeStatus) {
+    case 1: case 2: case 3:
+        range->RangeStatus = RANGE_STATUS_HW_FAIL;
+        break;
+    case 6: case 9:
+        range->RangeStatus = RANGE_STATUS_PHASE_FAIL;
+        break;
+    case 8: case 10:
+        range->RangeStatus = RANGE_STATUS_MIN_RANGE_FAIL;
+        break;
+    case 4:
+        range->RangeStatus = RANGE_STATUS_SIGNAL_FAIL;
+        break;
+    case 11:
+        range->RangeStatus = RANGE_STATUS_VALID;
+        break;
+    default:
+        range->RangeStatus = RANGE_STATUS_NONE;
+        break;
+    }
+}
+
+/* called from the I2C interrupt when the read and the interrupt clear have completed */
+static void _RangeReadDone(I2cAsync_Transaction_t *transaction) {
+    VL53L0X_DEV Dev = transaction->context;
+
+    if (transaction->status != I2C_ASYNC_DONE) {
+        Dev->Range.Ready = 0;
+        Dev->RangeCallback(VL53L0X_ERROR_CONTROL_INTERFACE, &Dev->Range);
+        return;
+    }
+    Dev->RangeCallback(VL53L0X_ERROR_NONE, &Dev->Range);
+}
+
+/**
+ * Apply a stored reference calibration instead of measuring it
+ */
+static VL53L0X_Error _RestoreRefCalibration(VL53L0X_DEV Dev, const VL53L0X_CalRecord_t *record)
+{
+    VL53L0X_Error status;
+
+    status = VL53L0X_SetReferenceSpads(Dev, record->refSpadCount, record->isApertureSpads);
+    if (status != VL53L0X_ERROR_NONE) {
+        goto done;
+    }
+    status = VL53L0X_SetRefCalibration(Dev, record->vhvSettings, record->phaseCal);
+    if (status != VL53L0X_ERROR_NONE) {
+        goto done;
+    }
+    status = VL53L0X_SetOffsetCalibrationDataMicroMeter(Dev, record->offsetMicroMeter);
+    if (status != VL53L0X_ERROR_NONE) {
+        goto done;
+    }
+    status = VL53L0X_SetXTalkCompensationRateMegaCps(Dev, record->xTalkCompensationRateMegaCps);
+    if (status != VL53L0X_ERROR_NONE) {
+        goto done;
+    }
+    status = VL53L0X_SetXTalkCompensationEnable(Dev, record->xTalkCompensationEnable);
+done:
+    return status;
+}
+
+/**
+ * Measure the reference calibration and collect what is to be stored
+ */
+static VL53L0X_Error _PerformRefCalibration(VL53L0X_DEV Dev, VL53L0X_CalRecord_t *record)
+{
+    VL53L0X_Error status;
+    FixPoint1616_t xTalkRate;
+
+    memset(record, 0, sizeof(*record));
+    record->partUidUpper = VL53L0X_GETDEVICESPECIFICPARAMETER(Dev, PartUIDUpper);
+    record->partUidLower = VL53L0X_GETDEVICESPECIFICPARAMETER(Dev, PartUIDLower);
+
+    status = VL53L0X_PerformRefCalibration(Dev, &record->vhvSettings, &record->phaseCal);
+    if (status != VL53L0X_ERROR_NONE) {
+        printf("VL53L0X_PerformRefCalibration failed\n");
+        goto done;
+    }
+    status = VL53L0X_PerformRefSpadManagement(Dev, &record->refSpadCount, &record->isApertureSpads);
+    if (status != VL53L0X_ERROR_NONE) {
+        printf("VL53L0X_PerformRefSpadManagement failed\n");
+        goto done;
+    }
+    status = VL53L0X_GetOffsetCalibrationDataMicroMeter(Dev, &record->offsetMicroMeter);
+    if (status != VL53L0X_ERROR_NONE) {
+        goto done;
+    }
+    status = VL53L0X_GetXTalkCompensationRateMegaCps(Dev, &xTalkRate);
+    if (status != VL53L0X_ERROR_NONE) {
+        goto done;
+    }
+    record->xTalkCompensationRateMegaCps = xTalkRate;
+    status = VL53L0X_GetXTalkCompensationEnable(Dev, &record->xTalkCompensationEnable);
+done:
+    return status;
+}
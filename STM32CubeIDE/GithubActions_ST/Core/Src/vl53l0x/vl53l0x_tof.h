@@ -25,7 +25,51 @@
 #endif
 
 /* Includes ------------------------------------------------------------------*/
+#include "i2c_async.h"
+
 /* Exported types ------------------------------------------------------------*/
+/**
+ * @brief   Range of VL53L0X_GetRange() and VL53L0X_StartRangeRead()
+ */
+typedef struct {
+    uint16_t RangeMilliMeter;   /*!< valid if Ready */
+    uint8_t  RangeStatus;       /*!< as VL53L0X_RangingMeasurementData_t, see VL53L0X_GetRange() */
+    uint8_t  Ready;             /*!< a new range was available (interrupt status) */
+} VL53L0X_Range_t;
+
+/**
+ * @brief   Completion of VL53L0X_StartRangeRead(), called from the I2C interrupt
+ *
+ * @param Status            VL53L0X_ERROR_CONTROL_INTERFACE if the read failed
+ * @param Range             the range, only valid during the call
+ */
+typedef void (*VL53L0X_RangeCallback_t)(VL53L0X_Error Status, const VL53L0X_Range_t *Range);
+
+/**
+ * @brief   Origin of the reference calibration applied by SetupSingleShot()
+ */
+typedef enum {
+    VL53L0X_CALIBRATION_NONE = 0,       /*!< not set up (sensor absent or failed) */
+    VL53L0X_CALIBRATION_RESTORED,       /*!< record from flash, see vl53l0x_cal_store.h */
+    VL53L0X_CALIBRATION_PERFORMED       /*!< full calibration, record stored */
+} VL53L0X_CalibrationSource_t;
+
+/**
+ * @brief   Ranging configuration applied by SetupSingleShot()
+ *
+ * After the ranging profiles of the ST API: the timing budget sets the
+ * measurement period in continuous mode, the signal rate limit which ranges
+ * are reported valid. The profiles differ only in signal limit, timing budget
+ * and VCSEL periods; the sigma limits of the API profiles are left out, as
+ * VL53L0X_GetRange() does not compute the sigma estimate.
+ */
+typedef enum {
+    VL53L0X_PROFILE_DEFAULT = 0,        /*!< 33 ms, long range limits: signal 0.1 MCPS, VCSEL 18/14 */
+    VL53L0X_PROFILE_HIGH_SPEED,         /*!< 20 ms, signal 0.25 MCPS, VCSEL 14/10 */
+    VL53L0X_PROFILE_HIGH_ACCURACY,      /*!< 200 ms, signal 0.25 MCPS, VCSEL 14/10 */
+    VL53L0X_NUM_PROFILES
+} VL53L0X_RangingProfile_t;
+
 /**
  * @struct  VL53L0X_Dev_t
  * @brief    Generic PAL device type that does link between API and platform abstraction layer
@@ -56,6 +100,16 @@ typedef struct {
     FixPoint1616_t SignalRateRtnMegaCps;
     uint16_t EffectiveSpadRtnCount;
 
+    /*!< range read, see VL53L0X_GetRange() and VL53L0X_StartRangeRead() */
+    I2cAsync_Transaction_t RangeRead;
+    uint8_t RangeBuffer[13];
+    uint8_t InterruptClearBuffer[2];
+    VL53L0X_Range_t Range;
+    VL53L0X_RangeCallback_t RangeCallback;
+
+    uint8_t CalibrationSource;            /*!< VL53L0X_CalibrationSource_t */
+    uint8_t RangingProfile;               /*!< VL53L0X_RangingProfile_t applied */
+
 } VL53L0X_Dev_t;
 
 
@@ -66,6 +120,14 @@ typedef struct {
 typedef VL53L0X_Dev_t* VL53L0X_DEV;
 
 /* Exported constants --------------------------------------------------------*/
+/* RangeStatus of VL53L0X_Range_t, as VL53L0X_get_pal_range_status() */
+#define RANGE_STATUS_VALID          0
+#define RANGE_STATUS_SIGNAL_FAIL    2
+#define RANGE_STATUS_MIN_RANGE_FAIL 3
+#define RANGE_STATUS_PHASE_FAIL     4
+#define RANGE_STATUS_HW_FAIL        5
+#define RANGE_STATUS_NONE           255
+
 /* Exported macros -----------------------------------------------------------*/
 /**
  * @def PALDevDataGet
@@ -221,7 +283,54 @@ VL53L0X_Error VL53L0X_UpdateByte(VL53L0X_DEV Dev, uint8_t index, uint8_t AndData
  */
 VL53L0X_Error VL53L0X_PollingDelay(VL53L0X_DEV Dev); /* usually best implemented as a real function */
 
-void SetupSingleShot(VL53L0X_DEV Dev);
+/**
+ * @brief Static initialization, calibration and ranging configuration
+ *
+ * The reference calibration and SPAD management are restored from flash if a
+ * valid record of this part is stored, otherwise they are performed and
+ * stored (see vl53l0x_cal_store.h). Dev->CalibrationSource tells which.
+ * An unknown @a Profile falls back to VL53L0X_PROFILE_DEFAULT, the one
+ * applied is left in Dev->RangingProfile.
+ *
+ * @param Dev       Device Handle
+ * @param Profile   ranging configuration, see ::VL53L0X_RangingProfile_t
+ */
+void SetupSingleShot(VL53L0X_DEV Dev, VL53L0X_RangingProfile_t Profile);
+
+/**
+ * @brief Read the range, range-only counterpart of VL53L0X_GetRangingMeasurementData()
+ *
+ * For continuous ranging with GPIO1 signaling new measurements. Reads
+ * RESULT_INTERRUPT_STATUS and the result block of
+ * VL53L0X_GetRangingMeasurementData() in one burst and decodes the range on
+ * the MCU. If a new range was available, the interrupt is cleared by a write
+ * of SYSTEM_INTERRUPT_CLEAR in the same transaction, before any other client
+ * gets the bus. Three transfers in all, where the API calls take ten.
+ *
+ * RangeStatus is derived from the device range status alone, one of the
+ * RANGE_STATUS_ values. The sigma estimate and the signal reference clip check
+ * of the API need more register reads and are not applied (SetupSingleShot()
+ * disables the sigma limit), nor is crosstalk compensation.
+ *
+ * @param Dev       Device Handle
+ * @param pRange    the range, RangeMilliMeter and RangeStatus valid if Ready
+ * @return  VL53L0X_ERROR_NONE                Success
+ * @return  VL53L0X_ERROR_CONTROL_INTERFACE   Transfer failed or range read running
+ */
+VL53L0X_Error VL53L0X_GetRange(VL53L0X_DEV Dev, VL53L0X_Range_t *pRange);
+
+/**
+ * @brief Queue the read of VL53L0X_GetRange() and return at once
+ *
+ * @a Callback gets the range from the I2C interrupt when the transaction,
+ * including the interrupt clear, has completed.
+ *
+ * @param Dev       Device Handle
+ * @param Callback  Completion
+ * @return  VL53L0X_ERROR_NONE                Read queued
+ * @return  VL53L0X_ERROR_CONTROL_INTERFACE   Previous read still running
+ */
+VL53L0X_Error VL53L0X_StartRangeRead(VL53L0X_DEV Dev, VL53L0X_RangeCallback_t Callback);
 
 #ifdef __cplusplus
 }
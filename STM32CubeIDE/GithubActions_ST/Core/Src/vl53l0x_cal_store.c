@@ -0,0 +1,60 @@
+/*
+ * vl53l0x_cal_store.c
+ *
+ * Flash record of the VL53L0X reference calibration, see vl53l0x_cal_store.h.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "vl53l0x_cal_store.h"
+
+extern const uint8_t _svl53l0x_calibration_flash[];	// page start, see STM32F334R8TX_FLASH.ld
+
+static uint32_t crc32(const uint8_t *data, size_t length);
+
+uint8_t VL53L0X_CalStore_Load(VL53L0X_CalRecord_t *record) {
+	memcpy(record, _svl53l0x_calibration_flash, sizeof(*record));
+	if ((record->magic != VL53L0X_CAL_STORE_MAGIC) || (record->version != VL53L0X_CAL_STORE_VERSION)
+			|| (record->size != sizeof(*record))) {
+		return 0;		// blank page or an older layout
+	}
+	return record->crc == crc32((const uint8_t *) record, offsetof(VL53L0X_CalRecord_t, crc));
+}
+
+HAL_StatusTypeDef VL53L0X_CalStore_Save(VL53L0X_CalRecord_t *record) {
+	FLASH_EraseInitTypeDef erase = { 0 };
+	uint32_t pageError = 0;
+	uint32_t address = (uint32_t) (uintptr_t) _svl53l0x_calibration_flash;
+	const uint32_t *words = (const uint32_t *) record;
+
+	record->magic = VL53L0X_CAL_STORE_MAGIC;
+	record->version = VL53L0X_CAL_STORE_VERSION;
+	record->size = sizeof(*record);
+	record->crc = crc32((const uint8_t *) record, offsetof(VL53L0X_CalRecord_t, crc));
+
+	erase.TypeErase = FLASH_TYPEERASE_PAGES;
+	erase.PageAddress = address;
+	erase.NbPages = 1;
+
+	HAL_FLASH_Unlock();
+	HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &pageError);
+	for (size_t i = 0; (status == HAL_OK) && (i < sizeof(*record) / sizeof(uint32_t)); i++) {
+		status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + i * sizeof(uint32_t), words[i]);
+	}
+	HAL_FLASH_Lock();
+	return status;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// CRC-32 (IEEE 802.3), bitwise, as the record is only checked once per boot
+uint32_t crc32(const uint8_t *data, size_t length) {
+	uint32_t crc = 0xFFFFFFFFU;
+	for (size_t i = 0; i < length; i++) {
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+		}
+	}
+	return ~crc;
+}
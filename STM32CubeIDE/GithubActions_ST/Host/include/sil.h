@@ -0,0 +1,119 @@
+/**
+ * Host-native software-in-the-loop (SIL) interface of the Balance Tube.
+ *
+ * Runs the hand-written adaptation layer (BalanceTube.c) together with the
+ * generated model (src-gen) against the stand-in HAL of this folder. Time is
+ * purely simulated: every call to Sil_Step() advances the 1 ms timer tick by
+ * five ticks, each of which advances the scheduler exactly like the TIM6
+ * interrupt does on the target and is followed by one run of
+ * runBalanceTube(), so the tasks of the scheduler run in the same ticks as on
+ * the target.
+ */
+
+#ifndef HOST_SIL_H_
+#define HOST_SIL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "input_trace.h"
+
+#define SIL_STEP_MS			5	// period of Task_5ms
+#define SIL_NUM_PIXELS		12	// NeoPixel ring
+#define SIL_DISPLAY_RAM		16	// HT16K33 display RAM bytes
+
+/**
+ * Sensor inputs, sampled by the next step.
+ */
+typedef struct {
+	uint16_t adcHandPosition;	// ADC1_IN1 raw value of the hand distance sensor (0..4095)
+	uint16_t ballDistanceMm;	// VL53L0X range to the ball in mm
+	uint8_t autoModeButton;		// BTN1 pressed
+	uint8_t startGameButton;	// BTN2 pressed
+} Sil_Inputs_t;
+
+typedef struct {
+	uint8_t red;
+	uint8_t green;
+	uint8_t blue;
+} Sil_Pixel_t;
+
+/**
+ * Actuator outputs as seen on the peripherals.
+ */
+typedef struct {
+	uint32_t servoCompare;						// TIM2 CCR2, 3.2 ticks per us of pulse width
+	Sil_Pixel_t ledRing[SIL_NUM_PIXELS];		// last frame decoded from the TIM3 DMA buffer
+	uint32_t ledFrames;							// number of frames sent to the ring
+	uint8_t displayRam[SIL_DISPLAY_RAM];		// HT16K33 display RAM
+	uint8_t displayOn;
+	uint8_t displayBrightness;
+	uint32_t i2cTransfers;						// number of I2C transactions (all devices)
+	uint32_t i2cBytes;							// number of I2C payload bytes (all devices)
+} Sil_Outputs_t;
+
+/**
+ * Model signals (model.Signals) after the last step.
+ */
+typedef struct {
+	float adcHandPosition;
+	float ballPosition;
+	float handPosition;
+	float score;
+	float servoPosition;
+	uint8_t autoModeButton;
+	uint8_t startGameButton;
+} Sil_Signals_t;
+
+/**
+ * Runs the start-up sequence of main(): calibration page setup and
+ * initializeBalanceTube(). Must be called once before the first step.
+ */
+void Sil_Initialize(void);
+
+void Sil_SetInputs(const Sil_Inputs_t *inputs);
+
+/**
+ * Advances the simulated time by SIL_STEP_MS and runs one step of the
+ * controller (sensor read, Task_5ms, actuator update).
+ */
+void Sil_Step(void);
+
+const Sil_Outputs_t *Sil_GetOutputs(void);
+
+void Sil_GetSignals(Sil_Signals_t *signals);
+
+/**
+ * \return simulated time in ms since Sil_Initialize()
+ */
+uint32_t Sil_GetTimeMs(void);
+
+/**
+ * \return servo pulse width in us derived from the TIM2 compare value
+ */
+float Sil_GetServoPulseUs(void);
+
+/**
+ * \param [out] record  Inputs consumed by the last step as recorded by the
+ *                      firmware (balanceTube_inputRecord).
+ */
+void Sil_GetInputRecord(InputTrace_Record_t *record);
+
+/**
+ * Writes a characteristic to the calibration working page, like a calibration
+ * tool would do via XCP. Takes effect with the next step.
+ *
+ * \param [in] cAccessName  C access name from the mapping file, e.g.
+ *                          "esdl_servoController_model_MainClass_CAL_MEM.kp".
+ * \param [in] value        Raw value in the representation of the target.
+ * \return 1 on success, 0 if the name is unknown or the size does not match
+ */
+int Sil_WriteCharacteristic(const char *cAccessName, const void *value, size_t size);
+
+/**
+ * Reads a characteristic from the active calibration page.
+ *
+ * \return 1 on success, 0 if the name is unknown or the size does not match
+ */
+int Sil_ReadCharacteristic(const char *cAccessName, void *value, size_t size);
+
+#endif /* HOST_SIL_H_ */
@@ -0,0 +1,77 @@
+/**
+ * Minimal reader of the ASAP2 description of the Balance Tube for host tools.
+ *
+ * Collects the scalar characteristics (type VALUE) of an A2L file together
+ * with the data type of their record layout, their conversion (linear
+ * RAT_FUNC or identity) and their limits. The ECU addresses of the generated
+ * A2L file are 0 (they are filled in after linking), so the C access names
+ * are taken from the mapping file (BalanceTube_STMicro.mapping.cnames.csv)
+ * instead.
+ */
+
+#ifndef HOST_SIL_A2L_H_
+#define HOST_SIL_A2L_H_
+
+#include <stddef.h>
+
+#define SIL_A2L_NAME_SIZE	128
+
+typedef enum {
+	SIL_A2L_UBYTE,
+	SIL_A2L_SBYTE,
+	SIL_A2L_UWORD,
+	SIL_A2L_SWORD,
+	SIL_A2L_ULONG,
+	SIL_A2L_SLONG,
+	SIL_A2L_FLOAT32_IEEE,
+	SIL_A2L_FLOAT64_IEEE,
+} SilA2l_DataType_t;
+
+typedef struct {
+	char name[SIL_A2L_NAME_SIZE];			// ASAP2 model path
+	char cAccessName[SIL_A2L_NAME_SIZE];	// empty if not in the mapping file
+	SilA2l_DataType_t dataType;
+	double coeffs[6];						// RAT_FUNC a..f: raw = (b * phys + c) / f
+	double lowerLimit;
+	double upperLimit;
+} SilA2l_Characteristic_t;
+
+typedef struct {
+	int count;
+	SilA2l_Characteristic_t *characteristics;
+} SilA2l_t;
+
+/**
+ * Reads the characteristics of an A2L file and their C access names.
+ *
+ * \param [in] mappingPath  Mapping file, may be NULL.
+ * \return 0 on success, -1 if a file cannot be read or a characteristic uses
+ *         an unknown record layout or a non-linear conversion (reported on
+ *         stderr)
+ */
+int SilA2l_Load(SilA2l_t *a2l, const char *a2lPath, const char *mappingPath);
+void SilA2l_Free(SilA2l_t *a2l);
+
+/**
+ * Looks up a characteristic by its full name or by a unique suffix that
+ * starts after a '.' (e.g. "kp" or "servoController.kp").
+ *
+ * \return the characteristic or NULL if not found or ambiguous
+ */
+const SilA2l_Characteristic_t *SilA2l_Find(const SilA2l_t *a2l, const char *name);
+
+/**
+ * \return size of the raw value in bytes
+ */
+size_t SilA2l_GetSize(const SilA2l_Characteristic_t *characteristic);
+
+/**
+ * Converts a physical value to the raw value of the characteristic (rounded
+ * and saturated for integer types).
+ *
+ * \param [out] raw  Buffer of SilA2l_GetSize() bytes.
+ */
+void SilA2l_Encode(const SilA2l_Characteristic_t *characteristic, double phys, void *raw);
+double SilA2l_Decode(const SilA2l_Characteristic_t *characteristic, const void *raw);
+
+#endif /* HOST_SIL_A2L_H_ */
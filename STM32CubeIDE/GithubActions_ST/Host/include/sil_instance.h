@@ -0,0 +1,66 @@
+/**
+ * Multi-instance interface of the host SIL.
+ *
+ * Each Sil_Instance_t is the explicit context of one simulated Balance Tube:
+ * it holds the complete state of the generated model, the adaptation layer
+ * and the peripherals. Instances are bound to one of Sil_GetImageCount()
+ * model images. Instances on different images can be run concurrently from
+ * different threads; instances sharing an image are serialized (their state is
+ * swapped in and out of the image on demand).
+ */
+
+#ifndef HOST_SIL_INSTANCE_H_
+#define HOST_SIL_INSTANCE_H_
+
+#include "sil.h"
+
+typedef struct Sil_Instance Sil_Instance_t;
+
+/**
+ * Called before every step of Sil_InstanceRun().
+ *
+ * \param [in,out] inputs   Inputs of the upcoming step, preset with those of the previous one.
+ * \param [in] outputs      Outputs after the previous step.
+ * \param [in] time_ms      Simulated time of the instance.
+ * \param [in] user         User data passed to Sil_InstanceRun().
+ */
+typedef void (*Sil_StepHook_t)(Sil_Inputs_t *inputs, const Sil_Outputs_t *outputs,
+		uint32_t time_ms, void *user);
+
+int Sil_GetImageCount(void);
+
+/**
+ * Creates an instance on the given image and runs the start-up sequence
+ * (see Sil_Initialize()) in its context.
+ *
+ * \return the new instance or NULL on invalid image or out of memory
+ */
+Sil_Instance_t *Sil_InstanceCreate(int image);
+void Sil_InstanceDestroy(Sil_Instance_t *instance);
+
+int Sil_InstanceGetImage(const Sil_Instance_t *instance);
+
+/**
+ * Runs the given number of steps of an instance. Blocks while another thread
+ * runs an instance on the same image.
+ */
+void Sil_InstanceRun(Sil_Instance_t *instance, uint32_t steps, Sil_StepHook_t hook, void *user);
+
+/**
+ * Calibration access in the context of an instance, see
+ * Sil_WriteCharacteristic() and Sil_ReadCharacteristic(). Every instance has
+ * its own working page, initialized from the reference page on creation.
+ */
+int Sil_InstanceWriteCharacteristic(Sil_Instance_t *instance, const char *cAccessName,
+		const void *value, size_t size);
+int Sil_InstanceReadCharacteristic(Sil_Instance_t *instance, const char *cAccessName,
+		void *value, size_t size);
+
+/**
+ * The following accessors return the values after the last run.
+ */
+const Sil_Outputs_t *Sil_InstanceGetOutputs(const Sil_Instance_t *instance);
+const Sil_Signals_t *Sil_InstanceGetSignals(const Sil_Instance_t *instance);
+uint32_t Sil_InstanceGetTimeMs(const Sil_Instance_t *instance);
+
+#endif /* HOST_SIL_INSTANCE_H_ */
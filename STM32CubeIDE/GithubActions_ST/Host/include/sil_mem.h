@@ -0,0 +1,29 @@
+/**
+ * Host implementation of the calibration page handling (see xcp_mem.h).
+ */
+
+#ifndef HOST_SIL_MEM_H_
+#define HOST_SIL_MEM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+void SilMem_Initialize(void);
+void SilMem_SetEcuReferencePage(void);
+void SilMem_SetEcuWorkingPage(void);
+void SilMem_CopyReferencePageToWorkingPage(void);
+uintptr_t SilMem_GetActiveEcuPageOffset(void);
+void *SilMem_GetEffectiveAddress(const volatile void *addr);
+
+/**
+ * Writes a characteristic on the working page.
+ *
+ * \param [in] refAddr      Address of the characteristic on the reference page (e.g. &esdl_..._CAL_MEM.kp).
+ * \param [in] pSrc         The new value.
+ * \param [in] numBytes     Size of the characteristic.
+ *
+ * \return non-zero if the characteristic lies within the calibration page and was written.
+ */
+int SilMem_WriteCharacteristic(const volatile void *refAddr, const void *pSrc, size_t numBytes);
+
+#endif /* HOST_SIL_MEM_H_ */
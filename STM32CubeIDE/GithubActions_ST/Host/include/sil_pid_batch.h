@@ -0,0 +1,61 @@
+/**
+ * Batch evaluator of the ServoController PID (model_ServoController_Automatic_autoMode)
+ * for many (kp, ki, kd) candidates at once.
+ *
+ * The controller states of all candidates are stored as structure of arrays
+ * and stepped eight candidates at a time with AVX2 if the processor supports
+ * it. Every candidate produces bit-identical results to the generated scalar
+ * code: the operations are the same IEEE single precision operations in the
+ * same order, without contraction into fused multiply-adds.
+ */
+
+#ifndef HOST_SIL_PID_BATCH_H_
+#define HOST_SIL_PID_BATCH_H_
+
+#include <stdint.h>
+
+#define SIL_PID_BATCH_LANES		8
+
+typedef struct {
+	int count;				// number of candidates
+	int capacity;			// count rounded up to SIL_PID_BATCH_LANES
+	float *kp;
+	float *ki;
+	float *kd;
+	float *error;
+	float *integral;
+	float *lastValue;
+	float *servoPosition;
+	int32_t *doIntegrate;	// lane mask: -1 = true, 0 = false
+} SilPidBatch_t;
+
+SilPidBatch_t *SilPidBatch_Create(int count);
+void SilPidBatch_Destroy(SilPidBatch_t *batch);
+
+void SilPidBatch_SetGains(SilPidBatch_t *batch, int index, float kp, float ki, float kd);
+
+/**
+ * Sets the controller states of all candidates to the initial values of
+ * esdl_servoController_model_MainClass_RAM.
+ */
+void SilPidBatch_Reset(SilPidBatch_t *batch);
+
+/**
+ * Executes autoMode() once for every candidate.
+ *
+ * \param [in] ballPosition     Ball position seen by each candidate (count entries).
+ * \param [in] dT               Model time step (ASD_DT_SCALED).
+ */
+void SilPidBatch_Step(SilPidBatch_t *batch, const float *ballPosition, float dT);
+
+/**
+ * Same as SilPidBatch_Step() without SIMD, for reference and benchmarks.
+ */
+void SilPidBatch_StepScalar(SilPidBatch_t *batch, const float *ballPosition, float dT);
+
+/**
+ * \return non-zero if SilPidBatch_Step() uses AVX2
+ */
+int SilPidBatch_HasAvx2(void);
+
+#endif /* HOST_SIL_PID_BATCH_H_ */
@@ -0,0 +1,78 @@
+/**
+ * Physical model of the Balance Tube for host SIL runs.
+ *
+ * Replaces the kinematic ball model of simulation/Stimulator.esdl with:
+ *  - a servo that follows the commanded pulse width with limited slew rate
+ *    and tilts the tube (linear linkage, adjustable mounting offset),
+ *  - a ball rolling in the tilted tube with rolling inertia and viscous
+ *    friction, bouncing off both end stops,
+ *  - a VL53L0X that delivers a new, noisy and quantized range once per
+ *    timing budget and holds it in between.
+ *
+ * The ball dynamics are integrated with a fixed-step RK4 scheme, several
+ * sub-steps per controller step. All random numbers come from a per-plant
+ * generator, so runs with the same seed are reproducible.
+ */
+
+#ifndef HOST_SIL_PLANT_H_
+#define HOST_SIL_PLANT_H_
+
+#include <stdint.h>
+
+typedef struct {
+	// tube and ball
+	double travel_m;				// ball travel between the end stops
+	double rangeFarEnd_mm;			// ToF range with the ball at the far end stop (position 0)
+	double rollingFactor;			// 1 / (1 + J / (m r^2)), 0.6 for a thin-walled ball
+	double damping_1_s;				// viscous friction
+	double restitution;				// velocity ratio after hitting an end stop
+	double gravity_m_s2;
+	// servo and linkage
+	double levelPulse_us;			// pulse width for a level tube
+	double tiltGain_deg_us;			// tube angle per us of pulse width
+	double tiltOffset_deg;			// mounting error of the tube
+	double tiltMax_deg;				// mechanical limit
+	double slewRate_deg_s;			// maximum angular speed of the tube
+	// distance sensor
+	double tofPeriod_s;				// measurement period (timing budget)
+	double tofNoise_mm;				// standard deviation, constant part
+	double tofNoiseRelative;		// standard deviation, part proportional to the range
+	// integration
+	int subSteps;					// RK4 steps per call of SilPlant_Step()
+} SilPlant_Params_t;
+
+typedef struct {
+	SilPlant_Params_t params;
+	double position_m;				// ball position from the far end stop
+	double velocity_m_s;
+	double tilt_deg;				// positive tilt accelerates the ball towards the sensor
+	double time_s;
+	double tofTimer_s;
+	uint16_t tofRange_mm;			// last measured range
+	uint64_t random;
+} SilPlant_t;
+
+void SilPlant_GetDefaultParams(SilPlant_Params_t *params);
+
+/**
+ * Puts the ball at rest at the given normalized position (0 = far end,
+ * 1 = sensor end) with a level tube.
+ */
+void SilPlant_Init(SilPlant_t *plant, const SilPlant_Params_t *params, double position, uint64_t seed);
+
+/**
+ * Advances the plant by dt_s while the servo receives the given pulse width.
+ */
+void SilPlant_Step(SilPlant_t *plant, double servoPulse_us, double dt_s);
+
+/**
+ * \return last range delivered by the distance sensor
+ */
+uint16_t SilPlant_GetRangeMm(const SilPlant_t *plant);
+
+/**
+ * \return true ball position relative to the travel (0 = far end, 1 = sensor end)
+ */
+double SilPlant_GetPosition(const SilPlant_t *plant);
+
+#endif /* HOST_SIL_PLANT_H_ */
@@ -0,0 +1,50 @@
+/**
+ * Fixed-size thread pool for running SIL instances in parallel.
+ */
+
+#ifndef HOST_SIL_POOL_H_
+#define HOST_SIL_POOL_H_
+
+typedef struct Sil_Pool Sil_Pool_t;
+
+/**
+ * Job executed once by every worker of the pool.
+ *
+ * \param [in] worker   Index of the worker (0 .. workers - 1).
+ * \param [in] arg      Argument passed to Sil_PoolRun().
+ */
+typedef void (*Sil_PoolJob_t)(int worker, void *arg);
+
+/**
+ * Task executed by Sil_PoolRunTasks().
+ *
+ * \param [in] worker   Index of the worker that runs the task.
+ * \param [in] task     Index of the task (0 .. tasks - 1).
+ * \param [in] arg      Argument passed to Sil_PoolRunTasks().
+ */
+typedef void (*Sil_PoolTask_t)(int worker, int task, void *arg);
+
+Sil_Pool_t *Sil_PoolCreate(int workers);
+void Sil_PoolDestroy(Sil_Pool_t *pool);
+int Sil_PoolGetWorkerCount(const Sil_Pool_t *pool);
+
+/**
+ * Runs the job on all workers and waits until every worker has finished.
+ */
+void Sil_PoolRun(Sil_Pool_t *pool, Sil_PoolJob_t job, void *arg);
+
+/**
+ * Runs the given number of independent tasks on the workers of the pool and
+ * waits until all of them have finished. The tasks are dealt out in
+ * contiguous ranges, one per worker; a worker that runs out of tasks steals
+ * the upper half of the largest remaining range of another worker, so tasks
+ * of very different duration still keep all workers busy.
+ */
+void Sil_PoolRunTasks(Sil_Pool_t *pool, int tasks, Sil_PoolTask_t task, void *arg);
+
+/**
+ * \return number of online processors
+ */
+int Sil_GetProcessorCount(void);
+
+#endif /* HOST_SIL_POOL_H_ */
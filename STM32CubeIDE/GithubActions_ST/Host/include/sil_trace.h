@@ -0,0 +1,64 @@
+/**
+ * Input trace files of the host SIL (format see Core/Src/input_trace.h).
+ *
+ * Traces are written sequentially and read through a read-only memory
+ * mapping: the records are used in place, so traces of any length replay
+ * without being loaded or parsed, and the kernel streams the pages in ahead
+ * of the reader.
+ */
+
+#ifndef HOST_SIL_TRACE_H_
+#define HOST_SIL_TRACE_H_
+
+#include <stddef.h>
+#include "sil.h"
+#include "input_trace.h"
+
+typedef struct SilTrace_Writer SilTrace_Writer_t;
+
+typedef struct {
+	const InputTrace_Header_t *header;
+	const InputTrace_Record_t *records;
+	size_t count;
+	void *map;
+	size_t mapSize;
+} SilTrace_t;
+
+/**
+ * Creates (or truncates) a trace file and writes the header.
+ *
+ * \return the writer or NULL on error
+ */
+SilTrace_Writer_t *SilTrace_CreateWriter(const char *path, uint32_t period_ms);
+
+/**
+ * \return 1 on success, 0 on write error
+ */
+int SilTrace_Write(SilTrace_Writer_t *writer, const InputTrace_Record_t *record);
+
+/**
+ * Flushes and closes the file.
+ *
+ * \return 1 on success, 0 if a write error occurred at any time
+ */
+int SilTrace_CloseWriter(SilTrace_Writer_t *writer);
+
+/**
+ * Maps a trace file and checks its header.
+ *
+ * \return 0 on success, -1 on error (reported on stderr)
+ */
+int SilTrace_Open(SilTrace_t *trace, const char *path);
+void SilTrace_Close(SilTrace_t *trace);
+
+/**
+ * Converts a record to the SIL inputs of a step.
+ */
+void SilTrace_ToInputs(const InputTrace_Record_t *record, Sil_Inputs_t *inputs);
+
+/**
+ * \return 1 if both records hold the same inputs (the time stamp is ignored)
+ */
+int SilTrace_IsSameInputs(const InputTrace_Record_t *a, const InputTrace_Record_t *b);
+
+#endif /* HOST_SIL_TRACE_H_ */
@@ -0,0 +1,117 @@
+/**
+ * Register-level model of the VL53L0X for running the ST driver on the host.
+ *
+ * The device is addressed with raw I2C transfers, so it sits behind the
+ * platform layer of the driver (_I2CWrite()/_I2CRead() in vl53l0x_tof.c and
+ * the HAL I2C functions below them): a transmit sets the register index from
+ * its first byte and writes the following bytes with auto-increment, a
+ * receive reads from the current index on. It models
+ *  - the register file, with the page selected by register 0xFF as used by
+ *    the driver to reach its private registers,
+ *  - the NVM read strobe (product data, reference SPAD map, part UID),
+ *  - single shot, back-to-back and timed measurements that take the timing
+ *    budget derived from the sequence steps, VCSEL periods and timeouts the
+ *    driver has programmed, with the same overheads as the driver assumes,
+ *  - the interrupt status, the range status and GPIO1, and their clear,
+ *  - the reference signal rate of the enabled reference SPADs, so that the
+ *    reference SPAD management of the driver converges,
+ *  - results from a configurable distance profile with optional noise.
+ *
+ * Time only advances with the bus time of the transfers (at bitRate_Hz) and
+ * with SilVl53l0xDev_Advance(); statistics of the transfers are kept for
+ * comparing the I2C cost of driver calls. The model does not emulate the
+ * internal firmware of the sensor: registers it does not know simply hold
+ * what was written.
+ *
+ * This is not part of the SIL library (sil_vl53l0x.c stands in for the
+ * sensor there, at the level of its results); see tools/vl53l0x_bench.c.
+ */
+
+#ifndef HOST_SIL_VL53L0X_DEV_H_
+#define HOST_SIL_VL53L0X_DEV_H_
+
+#include <stdint.h>
+
+#define SIL_VL53L0X_DEV_PAGES		8
+#define SIL_VL53L0X_DEV_NVM_WORDS	128
+
+/**
+ * Distance of the target at time_us since the device was reset, in mm.
+ */
+typedef double (*SilVl53l0xDev_Profile_t)(uint64_t time_us, void *user);
+
+typedef struct {
+	uint32_t bitRate_Hz;			// SCL frequency for the bus time, 400 kHz by default
+	uint32_t partUidUpper;			// NVM part UID, tells sensors apart for the calibration store
+	uint32_t partUidLower;
+	SilVl53l0xDev_Profile_t profile;	// NULL: constant distance_mm
+	void *user;
+	double distance_mm;
+	double noise_mm;				// uniform noise of +-noise_mm on every range
+	uint64_t seed;
+} SilVl53l0xDev_Config_t;
+
+typedef struct {
+	uint32_t transmits;				// transfers from the master, including the index of a read
+	uint32_t receives;
+	uint32_t bytes;					// data bytes of both directions, without address bytes
+	uint64_t bus_ns;				// bus time at bitRate_Hz, including address, start and stop
+	uint32_t measurements;			// completed measurements, calibration included
+} SilVl53l0xDev_Stats_t;
+
+typedef struct {
+	SilVl53l0xDev_Config_t config;
+	uint8_t regs[SIL_VL53L0X_DEV_PAGES][256];
+	uint8_t page;					// register 0xFF
+	uint8_t index;					// register pointer of the next transfer
+	uint32_t nvm[SIL_VL53L0X_DEV_NVM_WORDS];
+	uint64_t time_ns;
+	uint64_t measurementEnd_ns;		// completion of the measurement in progress
+	uint8_t measuring;
+	uint8_t continuous;				// SYSRANGE_MODE_BACKTOBACK or _TIMED while running
+	uint64_t random;
+	void (*interrupt)(void *user);	// called when GPIO1 becomes active, may be NULL
+	void *interruptUser;
+	SilVl53l0xDev_Stats_t stats;
+} SilVl53l0xDev_t;
+
+void SilVl53l0xDev_GetDefaultConfig(SilVl53l0xDev_Config_t *config);
+
+/**
+ * Powers the device up: power-on register values, NVM contents, time 0,
+ * statistics cleared.
+ */
+void SilVl53l0xDev_Reset(SilVl53l0xDev_t *dev, const SilVl53l0xDev_Config_t *config);
+
+/**
+ * Write transfer: data[0] is the register index, the rest is written from
+ * there on. A single byte only sets the index for a following receive.
+ */
+void SilVl53l0xDev_Transmit(SilVl53l0xDev_t *dev, const uint8_t *data, uint16_t size);
+
+/**
+ * Read transfer from the current register index on.
+ */
+void SilVl53l0xDev_Receive(SilVl53l0xDev_t *dev, uint8_t *data, uint16_t size);
+
+/**
+ * Lets time pass, completing the measurements that end meanwhile.
+ */
+void SilVl53l0xDev_Advance(SilVl53l0xDev_t *dev, uint64_t ns);
+
+/**
+ * \return 1 if GPIO1 signals an interrupt (pin level depends on the polarity)
+ */
+uint8_t SilVl53l0xDev_IsInterruptActive(const SilVl53l0xDev_t *dev);
+
+/**
+ * \return duration of one measurement with the current register settings
+ */
+uint32_t SilVl53l0xDev_GetTimingBudgetUs(const SilVl53l0xDev_t *dev);
+
+/**
+ * \return distance of the profile at the current time
+ */
+double SilVl53l0xDev_GetDistanceMm(const SilVl53l0xDev_t *dev);
+
+#endif /* HOST_SIL_VL53L0X_DEV_H_ */
@@ -0,0 +1,217 @@
+/**
+ * Host stand-in for the STM32F3xx HAL.
+ *
+ * Provides just the handle types, constants and functions the hand-written
+ * Balance Tube code uses, so that BalanceTube.c, ht16k33.c and the generated
+ * model compile unchanged for a host-native software-in-the-loop (SIL) build.
+ * The peripherals behind these functions are modeled in sil_hal.c.
+ */
+
+#ifndef HOST_STM32F3XX_HAL_H_
+#define HOST_STM32F3XX_HAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************
+ * Common definitions
+ ****************************************************************************/
+
+typedef enum {
+	HAL_OK = 0x00U,
+	HAL_ERROR = 0x01U,
+	HAL_BUSY = 0x02U,
+	HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY      0xFFFFFFFFU
+
+#define __IO volatile
+#define __NOP()
+#define __WFI()
+#define __disable_irq()
+#define __enable_irq()
+#define __get_PRIMASK()            0U
+#define __set_PRIMASK(priMask)     ((void) (priMask))
+
+/****************************************************************************
+ * GPIO
+ ****************************************************************************/
+
+typedef struct {
+	__IO uint32_t IDR;
+	__IO uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+	GPIO_PIN_RESET = 0U,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+#define GPIO_PIN_0                 ((uint16_t)0x0001)
+#define GPIO_PIN_1                 ((uint16_t)0x0002)
+#define GPIO_PIN_2                 ((uint16_t)0x0004)
+#define GPIO_PIN_3                 ((uint16_t)0x0008)
+#define GPIO_PIN_4                 ((uint16_t)0x0010)
+#define GPIO_PIN_5                 ((uint16_t)0x0020)
+#define GPIO_PIN_6                 ((uint16_t)0x0040)
+#define GPIO_PIN_7                 ((uint16_t)0x0080)
+#define GPIO_PIN_8                 ((uint16_t)0x0100)
+#define GPIO_PIN_9                 ((uint16_t)0x0200)
+#define GPIO_PIN_10                ((uint16_t)0x0400)
+#define GPIO_PIN_11                ((uint16_t)0x0800)
+#define GPIO_PIN_12                ((uint16_t)0x1000)
+#define GPIO_PIN_13                ((uint16_t)0x2000)
+#define GPIO_PIN_14                ((uint16_t)0x4000)
+#define GPIO_PIN_15                ((uint16_t)0x8000)
+
+extern GPIO_TypeDef SilHal_GpioA;
+extern GPIO_TypeDef SilHal_GpioB;
+extern GPIO_TypeDef SilHal_GpioC;
+
+#define GPIOA (&SilHal_GpioA)
+#define GPIOB (&SilHal_GpioB)
+#define GPIOC (&SilHal_GpioC)
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+/****************************************************************************
+ * ADC
+ ****************************************************************************/
+
+typedef struct {
+	uint32_t Channel;
+} ADC_HandleTypeDef;
+
+#define ADC_SINGLE_ENDED           0x00000000U
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc, uint32_t SingleDiff);
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length);
+
+/****************************************************************************
+ * I2C
+ ****************************************************************************/
+
+typedef struct {
+	uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+#define HAL_I2C_ERROR_AF           0x00000004U
+
+#define I2C_FIRST_FRAME            0x00000000U
+#define I2C_LAST_FRAME             0x02000000U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size, uint32_t XferOptions);
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+/****************************************************************************
+ * TIM
+ ****************************************************************************/
+
+typedef struct {
+	__IO uint32_t CCR1;
+	__IO uint32_t CCR2;
+	__IO uint32_t CCR3;
+	__IO uint32_t CCR4;
+} TIM_TypeDef;
+
+typedef struct {
+	TIM_TypeDef *Instance;
+} TIM_HandleTypeDef;
+
+#define TIM_CHANNEL_1              0x00000000U
+#define TIM_CHANNEL_2              0x00000004U
+#define TIM_CHANNEL_3              0x00000008U
+#define TIM_CHANNEL_4              0x0000000CU
+
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__) \
+	(*(__IO uint32_t *)(&((__HANDLE__)->Instance->CCR1) + ((__CHANNEL__) >> 2U)) = (__COMPARE__))
+
+#define __HAL_TIM_GET_COMPARE(__HANDLE__, __CHANNEL__) \
+	(*(__IO uint32_t *)(&((__HANDLE__)->Instance->CCR1) + ((__CHANNEL__) >> 2U)))
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start_DMA(TIM_HandleTypeDef *htim, uint32_t Channel,
+		const uint32_t *pData, uint16_t Length);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t Channel);
+void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim);
+void HAL_TIM_PWM_PulseFinishedHalfCpltCallback(TIM_HandleTypeDef *htim);
+
+/****************************************************************************
+ * FLASH
+ ****************************************************************************/
+
+#define FLASH_PAGE_SIZE                0x800U
+#define FLASH_TYPEERASE_PAGES          0x00U
+#define FLASH_TYPEPROGRAM_WORD         0x02U
+
+typedef struct {
+	uint32_t TypeErase;
+	uint32_t PageAddress;
+	uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+
+/****************************************************************************
+ * Core debug (DWT cycle counter)
+ ****************************************************************************/
+
+typedef struct {
+	__IO uint32_t CTRL;
+	__IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+	__IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk         (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk     (1UL << 24U)
+
+extern DWT_Type SilHal_Dwt;
+extern CoreDebug_Type SilHal_CoreDebug;
+
+#define DWT (&SilHal_Dwt)
+#define CoreDebug (&SilHal_CoreDebug)
+
+/****************************************************************************
+ * System
+ ****************************************************************************/
+
+extern uint32_t SystemCoreClock;
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_STM32F3XX_HAL_H_ */
@@ -0,0 +1,96 @@
+/**
+ * Host-native software-in-the-loop (SIL) step API of the Balance Tube.
+ */
+
+#include <string.h>
+#include "sil.h"
+#include "sil_characteristics.h"
+#include "sil_hal.h"
+#include "sil_mem.h"
+#include "BalanceTube.h"
+#include "scheduler.h"
+#include "model_Signals_stm32f334r8.h"
+
+static uint32_t counter_ms = 0;
+
+static const Sil_Characteristic_t *findCharacteristic(const char *cAccessName, size_t size) {
+	for (int k = 0; k < Sil_CharacteristicCount; k++) {
+		if (strcmp(Sil_Characteristics[k].cAccessName, cAccessName) == 0) {
+			return (Sil_Characteristics[k].size == size) ? &Sil_Characteristics[k] : NULL;
+		}
+	}
+	return NULL;
+}
+
+void Sil_Initialize(void) {
+	SilHal_Reset();
+	counter_ms = 0;
+
+	SilMem_Initialize();
+	initializeBalanceTube();
+}
+
+void Sil_SetInputs(const Sil_Inputs_t *inputs) {
+	SilHal_SetInputs(inputs);
+}
+
+void Sil_Step(void) {
+	// the main loop runs at least once per tick, as on the target
+	for (int i = 0; i < SIL_STEP_MS; i++) {
+		SilHal_Tick();
+		runBalanceTube();
+	}
+}
+
+const Sil_Outputs_t *Sil_GetOutputs(void) {
+	return SilHal_GetOutputs();
+}
+
+void Sil_GetSignals(Sil_Signals_t *signals) {
+	signals->adcHandPosition = model_Signals_adcHandPosition;
+	signals->ballPosition = model_Signals_ballPosition;
+	signals->handPosition = model_Signals_handPosition;
+	signals->score = model_Signals_score;
+	signals->servoPosition = model_Signals_servoPosition;
+	signals->autoModeButton = model_Signals_autoModeButton;
+	signals->startGameButton = model_Signals_startGameButton;
+}
+
+uint32_t Sil_GetTimeMs(void) {
+	return counter_ms;
+}
+
+float Sil_GetServoPulseUs(void) {
+	return (float) SilHal_GetOutputs()->servoCompare / 3.2F;
+}
+
+void Sil_GetInputRecord(InputTrace_Record_t *record) {
+	*record = balanceTube_inputRecord;
+}
+
+int Sil_WriteCharacteristic(const char *cAccessName, const void *value, size_t size) {
+	const Sil_Characteristic_t *characteristic = findCharacteristic(cAccessName, size);
+	if (characteristic == NULL) {
+		return 0;
+	}
+	return SilMem_WriteCharacteristic(characteristic->address, value, size);
+}
+
+int Sil_ReadCharacteristic(const char *cAccessName, void *value, size_t size) {
+	const Sil_Characteristic_t *characteristic = findCharacteristic(cAccessName, size);
+	if (characteristic == NULL) {
+		return 0;
+	}
+	memcpy(value, SilMem_GetEffectiveAddress(characteristic->address), size);
+	return 1;
+}
+
+/**
+ * TIM6 update interrupt, see xcp/TargetSpecific/xcp_target.c (without DAQ).
+ */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+	if (htim->Instance == htim6.Instance) {
+		counter_ms++;
+		Scheduler_Tick();
+	}
+}
@@ -0,0 +1,376 @@
+/**
+ * Minimal reader of the ASAP2 description of the Balance Tube for host tools.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sil_a2l.h"
+
+typedef struct {
+	char **items;
+	int count;
+	int capacity;
+} Tokens_t;
+
+typedef struct {
+	const char *keyword;
+	SilA2l_DataType_t dataType;
+	size_t size;
+} DataType_t;
+
+static const DataType_t dataTypes[] = {
+	{ "UBYTE", SIL_A2L_UBYTE, 1 },
+	{ "SBYTE", SIL_A2L_SBYTE, 1 },
+	{ "UWORD", SIL_A2L_UWORD, 2 },
+	{ "SWORD", SIL_A2L_SWORD, 2 },
+	{ "ULONG", SIL_A2L_ULONG, 4 },
+	{ "SLONG", SIL_A2L_SLONG, 4 },
+	{ "FLOAT32_IEEE", SIL_A2L_FLOAT32_IEEE, 4 },
+	{ "FLOAT64_IEEE", SIL_A2L_FLOAT64_IEEE, 8 },
+};
+
+#define NUM_DATA_TYPES	((int) (sizeof(dataTypes) / sizeof(dataTypes[0])))
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static char *readFile(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "A2L: cannot open %s\n", path);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char *text = malloc(size + 1);
+	if ((text != NULL) && (fread(text, 1, size, file) != (size_t) size)) {
+		free(text);
+		text = NULL;
+	}
+	fclose(file);
+	if (text != NULL) {
+		text[size] = '\0';
+	}
+	return text;
+}
+
+static void addToken(Tokens_t *tokens, char *token) {
+	if (tokens->count == tokens->capacity) {
+		tokens->capacity = tokens->capacity ? 2 * tokens->capacity : 1024;
+		tokens->items = realloc(tokens->items, tokens->capacity * sizeof(char *));
+	}
+	tokens->items[tokens->count++] = token;
+}
+
+// splits the text in place into whitespace separated tokens, drops comments
+// and the quotes of strings
+static void tokenize(char *text, Tokens_t *tokens) {
+	char *p = text;
+
+	if (memcmp(p, "\xEF\xBB\xBF", 3) == 0) {
+		p += 3;
+	}
+	while (*p != '\0') {
+		if ((p[0] == '/') && (p[1] == '*')) {
+			char *end = strstr(p + 2, "*/");
+			p = (end != NULL) ? end + 2 : p + strlen(p);
+		} else if ((p[0] == '/') && (p[1] == '/')) {
+			p += strcspn(p, "\n");
+		} else if (*p == '"') {
+			char *start = ++p;
+			while ((*p != '\0') && (*p != '"')) {
+				p += ((p[0] == '\\') && (p[1] != '\0')) ? 2 : 1;
+			}
+			if (*p != '\0') {
+				*p++ = '\0';
+			}
+			addToken(tokens, start);
+		} else if ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n')) {
+			p++;
+		} else {
+			char *start = p;
+			p += strcspn(p, " \t\r\n");
+			if (*p != '\0') {
+				*p++ = '\0';
+			}
+			addToken(tokens, start);
+		}
+	}
+}
+
+// index of the token after "/end <keyword>" of the block starting at i
+static int skipBlock(const Tokens_t *tokens, int i, const char *keyword) {
+	for (; i + 1 < tokens->count; i++) {
+		if ((strcmp(tokens->items[i], "/end") == 0) && (strcmp(tokens->items[i + 1], keyword) == 0)) {
+			return i + 2;
+		}
+	}
+	return tokens->count;
+}
+
+static int isBlock(const Tokens_t *tokens, int i, const char *keyword) {
+	return (i + 2 < tokens->count) && (strcmp(tokens->items[i], "/begin") == 0)
+			&& (strcmp(tokens->items[i + 1], keyword) == 0);
+}
+
+static int findBlock(const Tokens_t *tokens, const char *keyword, const char *name) {
+	for (int i = 0; i < tokens->count; i++) {
+		if (isBlock(tokens, i, keyword) && (strcmp(tokens->items[i + 2], name) == 0)) {
+			return i + 3;
+		}
+	}
+	return -1;
+}
+
+static const DataType_t *findDataType(const char *keyword) {
+	for (int k = 0; k < NUM_DATA_TYPES; k++) {
+		if (strcmp(dataTypes[k].keyword, keyword) == 0) {
+			return &dataTypes[k];
+		}
+	}
+	return NULL;
+}
+
+// RECORD_LAYOUT <name> FNC_VALUES <position> <datatype> ...
+static int parseRecordLayout(const Tokens_t *tokens, const char *name, SilA2l_DataType_t *dataType) {
+	int i = findBlock(tokens, "RECORD_LAYOUT", name);
+	if (i < 0) {
+		return -1;
+	}
+	int end = skipBlock(tokens, i, "RECORD_LAYOUT");
+	for (; i + 2 < end; i++) {
+		if (strcmp(tokens->items[i], "FNC_VALUES") == 0) {
+			const DataType_t *type = findDataType(tokens->items[i + 2]);
+			if (type == NULL) {
+				return -1;
+			}
+			*dataType = type->dataType;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+// COMPU_METHOD <name> <long id> <type> <format> <unit> ... COEFFS a b c d e f
+static int parseCompuMethod(const Tokens_t *tokens, const char *name, double coeffs[6]) {
+	if (strcmp(name, "NO_COMPU_METHOD") == 0) {
+		memcpy(coeffs, (const double[6]) { 0, 1, 0, 0, 0, 1 }, 6 * sizeof(double));
+		return 0;
+	}
+	int i = findBlock(tokens, "COMPU_METHOD", name);
+	if ((i < 0) || (i + 1 >= tokens->count)) {
+		return -1;
+	}
+	int end = skipBlock(tokens, i, "COMPU_METHOD");
+	const char *type = tokens->items[i + 1];
+	if (strcmp(type, "IDENTICAL") == 0) {
+		memcpy(coeffs, (const double[6]) { 0, 1, 0, 0, 0, 1 }, 6 * sizeof(double));
+		return 0;
+	}
+	if (strcmp(type, "RAT_FUNC") != 0) {
+		return -1;
+	}
+	for (; i + 6 < end; i++) {
+		if (strcmp(tokens->items[i], "COEFFS") == 0) {
+			for (int k = 0; k < 6; k++) {
+				coeffs[k] = strtod(tokens->items[i + 1 + k], NULL);
+			}
+			// only raw = (b * phys + c) / f is invertible without solving a quadratic
+			int linear = (coeffs[0] == 0.0) && (coeffs[3] == 0.0) && (coeffs[4] == 0.0)
+					&& (coeffs[1] != 0.0) && (coeffs[5] != 0.0);
+			return linear ? 0 : -1;
+		}
+	}
+	return -1;
+}
+
+static int parseMapping(SilA2l_t *a2l, const char *path) {
+	char *text = readFile(path);
+	if (text == NULL) {
+		return -1;
+	}
+	char *save = NULL;
+	for (char *line = strtok_r(text, "\r\n", &save); line != NULL; line = strtok_r(NULL, "\r\n", &save)) {
+		char *comma = strchr(line, ',');
+		if (comma == NULL) {
+			continue;
+		}
+		*comma = '\0';
+		for (int k = 0; k < a2l->count; k++) {
+			SilA2l_Characteristic_t *c = &a2l->characteristics[k];
+			if (strcmp(c->name, line) == 0) {
+				snprintf(c->cAccessName, sizeof(c->cAccessName), "%s", comma + 1);
+			}
+		}
+	}
+	free(text);
+	return 0;
+}
+
+static int hasSuffix(const char *name, const char *suffix) {
+	size_t n = strlen(name);
+	size_t s = strlen(suffix);
+	if (s > n) {
+		return 0;
+	}
+	return (strcmp(name + n - s, suffix) == 0) && ((s == n) || (name[n - s - 1] == '.'));
+}
+
+static double saturate(double value, double min, double max) {
+	value = round(value);
+	return fmin(fmax(value, min), max);
+}
+
+/****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+int SilA2l_Load(SilA2l_t *a2l, const char *a2lPath, const char *mappingPath) {
+	Tokens_t tokens = { 0 };
+	int result = 0;
+
+	a2l->count = 0;
+	a2l->characteristics = NULL;
+
+	char *text = readFile(a2lPath);
+	if (text == NULL) {
+		return -1;
+	}
+	tokenize(text, &tokens);
+
+	// CHARACTERISTIC <name> <long id> <type> <address> <record layout> <max diff> <conversion> <lower> <upper>
+	for (int i = 0; i < tokens.count; i++) {
+		if (!isBlock(&tokens, i, "CHARACTERISTIC") || (i + 11 >= tokens.count)) {
+			continue;
+		}
+		char **field = &tokens.items[i + 2];
+		if (strcmp(field[2], "VALUE") != 0) {
+			continue;
+		}
+		a2l->characteristics = realloc(a2l->characteristics, (a2l->count + 1) * sizeof(SilA2l_Characteristic_t));
+		SilA2l_Characteristic_t *c = &a2l->characteristics[a2l->count];
+		memset(c, 0, sizeof(*c));
+		snprintf(c->name, sizeof(c->name), "%s", field[0]);
+		c->lowerLimit = strtod(field[7], NULL);
+		c->upperLimit = strtod(field[8], NULL);
+		if (parseRecordLayout(&tokens, field[4], &c->dataType) != 0) {
+			fprintf(stderr, "A2L: %s: unsupported record layout %s\n", c->name, field[4]);
+			result = -1;
+			continue;
+		}
+		if (parseCompuMethod(&tokens, field[6], c->coeffs) != 0) {
+			fprintf(stderr, "A2L: %s: unsupported conversion %s\n", c->name, field[6]);
+			result = -1;
+			continue;
+		}
+		a2l->count++;
+	}
+	free(tokens.items);
+	free(text);
+
+	if ((result == 0) && (mappingPath != NULL)) {
+		result = parseMapping(a2l, mappingPath);
+	}
+	if (result != 0) {
+		SilA2l_Free(a2l);
+	}
+	return result;
+}
+
+void SilA2l_Free(SilA2l_t *a2l) {
+	free(a2l->characteristics);
+	a2l->characteristics = NULL;
+	a2l->count = 0;
+}
+
+const SilA2l_Characteristic_t *SilA2l_Find(const SilA2l_t *a2l, const char *name) {
+	const SilA2l_Characteristic_t *found = NULL;
+
+	for (int k = 0; k < a2l->count; k++) {
+		if (strcmp(a2l->characteristics[k].name, name) == 0) {
+			return &a2l->characteristics[k];
+		}
+		if (hasSuffix(a2l->characteristics[k].name, name)) {
+			if (found != NULL) {
+				return NULL;
+			}
+			found = &a2l->characteristics[k];
+		}
+	}
+	return found;
+}
+
+size_t SilA2l_GetSize(const SilA2l_Characteristic_t *characteristic) {
+	return dataTypes[characteristic->dataType].size;
+}
+
+void SilA2l_Encode(const SilA2l_Characteristic_t *characteristic, double phys, void *raw) {
+	const double *c = characteristic->coeffs;
+	double value = (c[1] * phys + c[2]) / c[5];
+
+	switch (characteristic->dataType) {
+	case SIL_A2L_UBYTE:
+		*(uint8_t *) raw = (uint8_t) saturate(value, 0, UINT8_MAX);
+		break;
+	case SIL_A2L_SBYTE:
+		*(int8_t *) raw = (int8_t) saturate(value, INT8_MIN, INT8_MAX);
+		break;
+	case SIL_A2L_UWORD:
+		*(uint16_t *) raw = (uint16_t) saturate(value, 0, UINT16_MAX);
+		break;
+	case SIL_A2L_SWORD:
+		*(int16_t *) raw = (int16_t) saturate(value, INT16_MIN, INT16_MAX);
+		break;
+	case SIL_A2L_ULONG:
+		*(uint32_t *) raw = (uint32_t) saturate(value, 0, UINT32_MAX);
+		break;
+	case SIL_A2L_SLONG:
+		*(int32_t *) raw = (int32_t) saturate(value, INT32_MIN, INT32_MAX);
+		break;
+	case SIL_A2L_FLOAT32_IEEE:
+		*(float *) raw = (float) value;
+		break;
+	case SIL_A2L_FLOAT64_IEEE:
+		*(double *) raw = value;
+		break;
+	}
+}
+
+double SilA2l_Decode(const SilA2l_Characteristic_t *characteristic, const void *raw) {
+	const double *c = characteristic->coeffs;
+	double value = 0.0;
+
+	switch (characteristic->dataType) {
+	case SIL_A2L_UBYTE:
+		value = *(const uint8_t *) raw;
+		break;
+	case SIL_A2L_SBYTE:
+		value = *(const int8_t *) raw;
+		break;
+	case SIL_A2L_UWORD:
+		value = *(const uint16_t *) raw;
+		break;
+	case SIL_A2L_SWORD:
+		value = *(const int16_t *) raw;
+		break;
+	case SIL_A2L_ULONG:
+		value = *(const uint32_t *) raw;
+		break;
+	case SIL_A2L_SLONG:
+		value = *(const int32_t *) raw;
+		break;
+	case SIL_A2L_FLOAT32_IEEE:
+		value = *(const float *) raw;
+		break;
+	case SIL_A2L_FLOAT64_IEEE:
+		value = *(const double *) raw;
+		break;
+	}
+	return (value * c[5] - c[2]) / c[1];
+}
@@ -0,0 +1,23 @@
+/**
+ * Table of the calibration characteristics of the model (internal to the SIL).
+ *
+ * Generated by the Makefile from the mapping file of the ASCET project
+ * (BalanceTube_STMicro.mapping.cnames.csv): one entry per CAL_MEM element,
+ * named by its C access name and pointing to the reference page.
+ */
+
+#ifndef HOST_SIL_CHARACTERISTICS_H_
+#define HOST_SIL_CHARACTERISTICS_H_
+
+#include <stddef.h>
+
+typedef struct {
+	const char *cAccessName;
+	const volatile void *address;
+	size_t size;
+} Sil_Characteristic_t;
+
+extern const Sil_Characteristic_t Sil_Characteristics[];
+extern const int Sil_CharacteristicCount;
+
+#endif /* HOST_SIL_CHARACTERISTICS_H_ */
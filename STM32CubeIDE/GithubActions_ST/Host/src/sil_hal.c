@@ -0,0 +1,351 @@
+/**
+ * Host stand-in for the STM32F3xx HAL and the peripherals of the Balance Tube.
+ *
+ * Models only what the adaptation layer observes: the ADC samples of the hand
+ * sensor, the buttons, the servo compare register, the NeoPixel DMA stream
+ * (decoded back into colors) and the HT16K33 display RAM. The VL53L0X is
+ * modeled in sil_vl53l0x.c.
+ */
+
+#include "sil_hal.h"
+#include "main.h"
+
+#define HT16K33_ADDR		(0x70 << 1)
+#define TIM3_PERIOD			76			// see MX_TIM3_Init()
+#define TIM15_RATE_HZ		3200		// ADC1 trigger, see MX_TIM15_Init()
+
+/****************************************************************************
+ * Peripheral handles (defined by main.c on the target)
+ ****************************************************************************/
+
+ADC_HandleTypeDef hadc1;
+I2C_HandleTypeDef hi2c1;
+TIM_HandleTypeDef htim2;
+TIM_HandleTypeDef htim3;
+TIM_HandleTypeDef htim6;
+TIM_HandleTypeDef htim15;
+
+GPIO_TypeDef SilHal_GpioA;
+GPIO_TypeDef SilHal_GpioB;
+GPIO_TypeDef SilHal_GpioC;
+
+DWT_Type SilHal_Dwt;
+CoreDebug_Type SilHal_CoreDebug;
+
+uint32_t SystemCoreClock = 64000000;		// see SystemClock_Config()
+
+/****************************************************************************
+ * Private variables
+ ****************************************************************************/
+
+static TIM_TypeDef tim2;
+static TIM_TypeDef tim3;
+static TIM_TypeDef tim6;
+static TIM_TypeDef tim15;
+
+static Sil_Inputs_t inputs;
+static Sil_Outputs_t outputs;
+static uint32_t tick_ms;
+static uint8_t tim6Running;
+static uint8_t tim15Running;
+static uint8_t tim3Dma;				// circular DMA of TIM3 CH1, until HAL_TIM_PWM_Stop_DMA()
+
+static uint16_t *adcDmaBuffer;		// circular, NULL until HAL_ADC_Start_DMA()
+static uint32_t adcDmaLength;
+static uint32_t adcDmaIndex;
+static uint32_t adcTriggerPhase;	// TIM15 updates * 1000 not yet converted
+
+/****************************************************************************
+ * Private function declarations
+ ****************************************************************************/
+
+static void convertHandPosition(void);
+static void ht16k33Transmit(const uint8_t *pData, uint16_t Size);
+static void streamNeoPixelFrame(const uint8_t *pData, uint16_t Length);
+
+/****************************************************************************
+ * SIL interface
+ ****************************************************************************/
+
+void SilHal_Reset(void) {
+	memset(&inputs, 0, sizeof(inputs));
+	memset(&outputs, 0, sizeof(outputs));
+	memset(&tim2, 0, sizeof(tim2));
+	memset(&tim3, 0, sizeof(tim3));
+	memset(&tim6, 0, sizeof(tim6));
+	memset(&tim15, 0, sizeof(tim15));
+	memset(&SilHal_Dwt, 0, sizeof(SilHal_Dwt));
+	memset(&SilHal_CoreDebug, 0, sizeof(SilHal_CoreDebug));
+	htim2.Instance = &tim2;
+	htim3.Instance = &tim3;
+	htim6.Instance = &tim6;
+	htim15.Instance = &tim15;
+	tick_ms = 0;
+	tim6Running = 0;
+	tim15Running = 0;
+	tim3Dma = 0;
+	adcDmaBuffer = NULL;
+	adcDmaLength = 0;
+	adcDmaIndex = 0;
+	adcTriggerPhase = 0;
+	SilHal_SetInputs(&inputs);
+	SilVl53l0x_Reset();
+}
+
+void SilHal_SetInputs(const Sil_Inputs_t *in) {
+	inputs = *in;
+
+	// buttons are active low (pull-up)
+	if (inputs.autoModeButton) {
+		BTN1_GPIO_Port->IDR &= ~(uint32_t) BTN1_Pin;
+	} else {
+		BTN1_GPIO_Port->IDR |= BTN1_Pin;
+	}
+	if (inputs.startGameButton) {
+		BTN2_GPIO_Port->IDR &= ~(uint32_t) BTN2_Pin;
+	} else {
+		BTN2_GPIO_Port->IDR |= BTN2_Pin;
+	}
+}
+
+const Sil_Inputs_t *SilHal_GetInputs(void) {
+	return &inputs;
+}
+
+Sil_Outputs_t *SilHal_GetOutputs(void) {
+	outputs.servoCompare = tim2.CCR2;
+	return &outputs;
+}
+
+void SilHal_Tick(void) {
+	tick_ms++;
+	// the cycle counter only advances with simulated time, code runs in zero time
+	if ((SilHal_CoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) && (SilHal_Dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+		SilHal_Dwt.CYCCNT += SystemCoreClock / 1000;
+	}
+	SilVl53l0x_Tick();
+	convertHandPosition();
+	if (tim6Running) {
+		HAL_TIM_PeriodElapsedCallback(&htim6);
+	}
+}
+
+/****************************************************************************
+ * GPIO
+ ****************************************************************************/
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+	return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+	if (PinState != GPIO_PIN_RESET) {
+		GPIOx->ODR |= GPIO_Pin;
+	} else {
+		GPIOx->ODR &= ~(uint32_t) GPIO_Pin;
+	}
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+	GPIOx->ODR ^= GPIO_Pin;
+}
+
+/****************************************************************************
+ * ADC
+ ****************************************************************************/
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc, uint32_t SingleDiff) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length) {
+	adcDmaBuffer = (uint16_t *) pData;
+	adcDmaLength = Length;
+	adcDmaIndex = 0;
+	return HAL_OK;
+}
+
+// the conversions TIM15 triggers within one tick, all of the current input
+static void convertHandPosition(void) {
+	if (!tim15Running || (adcDmaBuffer == NULL) || (adcDmaLength == 0)) {
+		return;
+	}
+	adcTriggerPhase += TIM15_RATE_HZ;
+	while (adcTriggerPhase >= 1000) {
+		adcTriggerPhase -= 1000;
+		adcDmaBuffer[adcDmaIndex] = inputs.adcHandPosition & 0x0FFF;
+		adcDmaIndex = (adcDmaIndex + 1) % adcDmaLength;
+	}
+}
+
+/****************************************************************************
+ * I2C
+ ****************************************************************************/
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c) {
+	hi2c->ErrorCode = 0;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+	outputs.i2cTransfers++;
+	outputs.i2cBytes += Size;
+
+	if (DevAddress == HT16K33_ADDR) {
+		ht16k33Transmit(pData, Size);
+		return HAL_OK;
+	}
+	return HAL_ERROR;	// no acknowledge
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+	outputs.i2cTransfers++;
+	outputs.i2cBytes += Size;
+
+	memset(pData, 0, Size);
+	return HAL_ERROR;	// no acknowledge
+}
+
+// Interrupt driven transfers complete instantly; the completion or error
+// callback is raised before returning, like the pulse finished callback of
+// the LED ring DMA.
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size) {
+	if (HAL_I2C_Master_Transmit(hi2c, DevAddress, pData, Size, 0) == HAL_OK) {
+		HAL_I2C_MasterTxCpltCallback(hi2c);
+	} else {
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		HAL_I2C_ErrorCallback(hi2c);
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size, uint32_t XferOptions) {
+	return HAL_I2C_Master_Transmit_IT(hi2c, DevAddress, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+		uint8_t *pData, uint16_t Size, uint32_t XferOptions) {
+	if (HAL_I2C_Master_Receive(hi2c, DevAddress, pData, Size, 0) == HAL_OK) {
+		HAL_I2C_MasterRxCpltCallback(hi2c);
+	} else {
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		HAL_I2C_ErrorCallback(hi2c);
+	}
+	return HAL_OK;
+}
+
+/****************************************************************************
+ * TIM
+ ****************************************************************************/
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim) {
+	if (htim == &htim15) {
+		tim15Running = 1;
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim) {
+	if (htim == &htim6) {
+		tim6Running = 1;
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel) {
+	return HAL_OK;
+}
+
+// The circular DMA of the LED ring runs to the end of the frame at once: the
+// half transfer and transfer complete callbacks are raised whenever a half
+// has been read, until they stop the DMA, just as it would be long before the
+// next 5 ms step.
+HAL_StatusTypeDef HAL_TIM_PWM_Start_DMA(TIM_HandleTypeDef *htim, uint32_t Channel,
+		const uint32_t *pData, uint16_t Length) {
+	if ((htim == &htim3) && (Length > 0)) {
+		streamNeoPixelFrame((const uint8_t *) pData, Length);
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t Channel) {
+	if (htim == &htim3) {
+		tim3Dma = 0;
+	}
+	return HAL_OK;
+}
+
+/****************************************************************************
+ * System
+ ****************************************************************************/
+
+uint32_t HAL_GetTick(void) {
+	return tick_ms;
+}
+
+void HAL_Delay(uint32_t Delay) {
+	for (uint32_t i = 0; i < Delay; i++) {
+		SilHal_Tick();
+	}
+}
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static void ht16k33Transmit(const uint8_t *pData, uint16_t Size) {
+	uint8_t cmd = pData[0];
+
+	if ((cmd & 0xF0) == 0x00) {
+		// display RAM write with address auto increment
+		uint8_t addr = cmd & 0x0F;
+		for (uint16_t i = 1; i < Size; i++) {
+			outputs.displayRam[addr] = pData[i];
+			addr = (addr + 1) & 0x0F;
+		}
+	} else if ((cmd & 0xF0) == 0x80) {
+		outputs.displayOn = cmd & 0x01;
+	} else if ((cmd & 0xF0) == 0xE0) {
+		outputs.displayBrightness = cmd & 0x0F;
+	}
+}
+
+// One byte per bit, the DMA memory size of TIM3 CH1 (see HAL_TIM_PWM_MspInit()),
+// read in circular mode. A compare value of 0 is a low period, no bit.
+static void streamNeoPixelFrame(const uint8_t *pData, uint16_t Length) {
+	uint8_t bits[SIL_NUM_PIXELS * 24];
+	uint32_t count = 0;
+
+	tim3Dma = 1;
+	for (uint32_t n = 0; tim3Dma && (n < (SIL_NUM_PIXELS + 8) * 24 + 2 * (uint32_t) Length); n++) {
+		uint16_t i = n % Length;
+		if ((pData[i] != 0) && (count < sizeof(bits))) {
+			bits[count++] = (2 * pData[i] > TIM3_PERIOD + 1);
+		}
+		if (i == Length / 2 - 1) {
+			HAL_TIM_PWM_PulseFinishedHalfCpltCallback(&htim3);
+		} else if (i == Length - 1) {
+			HAL_TIM_PWM_PulseFinishedCallback(&htim3);
+		}
+	}
+	tim3Dma = 0;
+
+	for (int i = 0; (i < SIL_NUM_PIXELS) && ((i + 1) * 24 <= count); i++) {
+		uint32_t grb = 0;
+		for (int bit = 0; bit < 24; bit++) {
+			grb = (grb << 1) | bits[i * 24 + bit];
+		}
+		outputs.ledRing[i].green = (grb >> 16) & 0xFF;
+		outputs.ledRing[i].red = (grb >> 8) & 0xFF;
+		outputs.ledRing[i].blue = grb & 0xFF;
+	}
+	outputs.ledFrames++;
+}
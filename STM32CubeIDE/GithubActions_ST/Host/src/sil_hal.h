@@ -0,0 +1,37 @@
+/**
+ * Peripheral models behind the host HAL stand-in (internal to the SIL).
+ */
+
+#ifndef HOST_SIL_HAL_H_
+#define HOST_SIL_HAL_H_
+
+#include "stm32f3xx_hal.h"
+#include "sil.h"
+
+extern ADC_HandleTypeDef hadc1;
+extern I2C_HandleTypeDef hi2c1;
+extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim3;
+extern TIM_HandleTypeDef htim6;
+
+void SilHal_Reset(void);
+void SilHal_SetInputs(const Sil_Inputs_t *inputs);
+const Sil_Inputs_t *SilHal_GetInputs(void);
+Sil_Outputs_t *SilHal_GetOutputs(void);
+
+/**
+ * Advances the 1 ms system tick and fires the TIM6 update interrupt if the
+ * timer has been started.
+ */
+void SilHal_Tick(void);
+
+/**
+ * Model of the VL53L0X in continuous ranging mode (sil_vl53l0x.c): a new
+ * range of the ball distance input every 33 ms, signaled on GPIO1.
+ */
+void SilVl53l0x_Reset(void);
+void SilVl53l0x_Tick(void);
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+#endif /* HOST_SIL_HAL_H_ */
@@ -0,0 +1,22 @@
+/**
+ * Descriptor of a SIL model image, renamed per image when it is linked.
+ */
+
+#include "sil_image.h"
+
+extern uint8_t sil_image_state_start[];	// defined by image.ld
+extern uint8_t sil_image_state_end[];
+
+__attribute__((visibility("default")))
+const Sil_Image_t silImage = {
+	.initialize = Sil_Initialize,
+	.setInputs = Sil_SetInputs,
+	.step = Sil_Step,
+	.getOutputs = Sil_GetOutputs,
+	.getSignals = Sil_GetSignals,
+	.getTimeMs = Sil_GetTimeMs,
+	.writeCharacteristic = Sil_WriteCharacteristic,
+	.readCharacteristic = Sil_ReadCharacteristic,
+	.stateStart = sil_image_state_start,
+	.stateEnd = sil_image_state_end,
+};
@@ -0,0 +1,32 @@
+/**
+ * Descriptor of a SIL model image (internal to the SIL).
+ *
+ * An image is a private copy of the complete firmware (generated model,
+ * adaptation layer, stand-in HAL) whose global symbols have been localized,
+ * so that several copies can be linked into one process and run on different
+ * threads at the same time. The descriptor is the only public symbol of an
+ * image.
+ */
+
+#ifndef HOST_SIL_IMAGE_H_
+#define HOST_SIL_IMAGE_H_
+
+#include "sil.h"
+
+typedef struct {
+	void (*initialize)(void);
+	void (*setInputs)(const Sil_Inputs_t *inputs);
+	void (*step)(void);
+	const Sil_Outputs_t *(*getOutputs)(void);
+	void (*getSignals)(Sil_Signals_t *signals);
+	uint32_t (*getTimeMs)(void);
+	int (*writeCharacteristic)(const char *cAccessName, const void *value, size_t size);
+	int (*readCharacteristic)(const char *cAccessName, void *value, size_t size);
+	uint8_t *stateStart;	// writable data of the image
+	uint8_t *stateEnd;
+} Sil_Image_t;
+
+extern const Sil_Image_t *const Sil_Images[];
+extern const int Sil_ImageCount;
+
+#endif /* HOST_SIL_IMAGE_H_ */
@@ -0,0 +1,166 @@
+/**
+ * Multi-instance support of the host SIL.
+ *
+ * The state of an instance is a copy of the writable data of its image (see
+ * image.ld). An image remembers which instance is currently loaded, so that
+ * switching costs two copies of a few kilobytes and running the same instance
+ * repeatedly costs nothing.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sil_instance.h"
+#include "sil_image.h"
+
+struct Sil_Instance {
+	int image;
+	uint8_t *state;
+	Sil_Inputs_t inputs;
+	Sil_Outputs_t outputs;
+	Sil_Signals_t signals;
+	uint32_t time_ms;
+};
+
+typedef struct {
+	pthread_mutex_t lock;
+	Sil_Instance_t *loaded;		// instance whose state is in the image
+	uint8_t *pristine;			// state of the image at process start
+} ImageSlot_t;
+
+static ImageSlot_t *slots = NULL;
+static pthread_once_t slotsOnce = PTHREAD_ONCE_INIT;
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static size_t stateSize(const Sil_Image_t *image) {
+	return (size_t) (image->stateEnd - image->stateStart);
+}
+
+static void initializeSlots(void) {
+	slots = calloc(Sil_ImageCount, sizeof(ImageSlot_t));
+	for (int i = 0; i < Sil_ImageCount; i++) {
+		const Sil_Image_t *image = Sil_Images[i];
+		pthread_mutex_init(&slots[i].lock, NULL);
+		slots[i].pristine = malloc(stateSize(image));
+		memcpy(slots[i].pristine, image->stateStart, stateSize(image));
+	}
+}
+
+// locks the image of the instance and swaps the instance in
+static const Sil_Image_t *load(Sil_Instance_t *instance) {
+	const Sil_Image_t *image = Sil_Images[instance->image];
+	ImageSlot_t *slot = &slots[instance->image];
+
+	pthread_mutex_lock(&slot->lock);
+	if (slot->loaded != instance) {
+		if (slot->loaded != NULL) {
+			memcpy(slot->loaded->state, image->stateStart, stateSize(image));
+		}
+		memcpy(image->stateStart, instance->state, stateSize(image));
+		slot->loaded = instance;
+	}
+	return image;
+}
+
+static void unload(Sil_Instance_t *instance, const Sil_Image_t *image) {
+	instance->outputs = *image->getOutputs();
+	image->getSignals(&instance->signals);
+	instance->time_ms = image->getTimeMs();
+	pthread_mutex_unlock(&slots[instance->image].lock);
+}
+
+/****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+int Sil_GetImageCount(void) {
+	return Sil_ImageCount;
+}
+
+Sil_Instance_t *Sil_InstanceCreate(int image) {
+	if ((image < 0) || (image >= Sil_ImageCount)) {
+		return NULL;
+	}
+	pthread_once(&slotsOnce, initializeSlots);
+
+	Sil_Instance_t *instance = calloc(1, sizeof(Sil_Instance_t));
+	if (instance == NULL) {
+		return NULL;
+	}
+	instance->image = image;
+	instance->state = malloc(stateSize(Sil_Images[image]));
+	if (instance->state == NULL) {
+		free(instance);
+		return NULL;
+	}
+	memcpy(instance->state, slots[image].pristine, stateSize(Sil_Images[image]));
+
+	const Sil_Image_t *img = load(instance);
+	img->initialize();
+	unload(instance, img);
+	return instance;
+}
+
+void Sil_InstanceDestroy(Sil_Instance_t *instance) {
+	if (instance == NULL) {
+		return;
+	}
+	ImageSlot_t *slot = &slots[instance->image];
+
+	pthread_mutex_lock(&slot->lock);
+	if (slot->loaded == instance) {
+		slot->loaded = NULL;
+	}
+	pthread_mutex_unlock(&slot->lock);
+
+	free(instance->state);
+	free(instance);
+}
+
+int Sil_InstanceGetImage(const Sil_Instance_t *instance) {
+	return instance->image;
+}
+
+void Sil_InstanceRun(Sil_Instance_t *instance, uint32_t steps, Sil_StepHook_t hook, void *user) {
+	const Sil_Image_t *image = load(instance);
+
+	for (uint32_t n = 0; n < steps; n++) {
+		if (hook != NULL) {
+			hook(&instance->inputs, image->getOutputs(), image->getTimeMs(), user);
+			image->setInputs(&instance->inputs);
+		}
+		image->step();
+	}
+	unload(instance, image);
+}
+
+int Sil_InstanceWriteCharacteristic(Sil_Instance_t *instance, const char *cAccessName,
+		const void *value, size_t size) {
+	const Sil_Image_t *image = load(instance);
+	int result = image->writeCharacteristic(cAccessName, value, size);
+	pthread_mutex_unlock(&slots[instance->image].lock);
+	return result;
+}
+
+int Sil_InstanceReadCharacteristic(Sil_Instance_t *instance, const char *cAccessName,
+		void *value, size_t size) {
+	const Sil_Image_t *image = load(instance);
+	int result = image->readCharacteristic(cAccessName, value, size);
+	pthread_mutex_unlock(&slots[instance->image].lock);
+	return result;
+}
+
+const Sil_Outputs_t *Sil_InstanceGetOutputs(const Sil_Instance_t *instance) {
+	return &instance->outputs;
+}
+
+const Sil_Signals_t *Sil_InstanceGetSignals(const Sil_Instance_t *instance) {
+	return &instance->signals;
+}
+
+uint32_t Sil_InstanceGetTimeMs(const Sil_Instance_t *instance) {
+	return instance->time_ms;
+}
@@ -0,0 +1,103 @@
+/**
+ * Host implementation of the calibration page handling.
+ *
+ * Mirrors xcp/TargetSpecific/xcp_mem.c: the CAL_MEM characteristics are linked
+ * into the .ascet_calibration_rom section (reference page, bounded by the
+ * symbols defined in sil.ld) and the generated code reads them through
+ * USE_PARAM_GLOBAL, which adds the offset of the active page. On the host the
+ * working page is a plain RAM buffer and is activated right away, so that
+ * calibration tools can change characteristics between steps.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sil_mem.h"
+
+/****************************************************************************
+ * Memory symbol definition (defined by linker script)
+ ****************************************************************************/
+
+extern const uint8_t _sascet_calibration_rom[]; // start address of ASCET characteristics (reference page)
+extern const uint8_t _eascet_calibration_rom[]; // end address of ASCET characteristics (reference page)
+
+/****************************************************************************
+ * Private defines
+ ****************************************************************************/
+
+// same size as the ASCET_CAL_MEM_RAM region of the target (see STM32F334R8TX_FLASH.ld)
+#define WORKING_PAGE_SIZE	2048
+
+#define REFERENCE_PAGE_START_ADDR	((uintptr_t) _sascet_calibration_rom)
+#define REFERENCE_PAGE_END_ADDR		((uintptr_t) _eascet_calibration_rom)
+#define WORKING_PAGE_START_ADDR		((uintptr_t) workingPage)
+
+#define CAL_PAGE_SIZE		((size_t) (REFERENCE_PAGE_END_ADDR - REFERENCE_PAGE_START_ADDR))
+#define CAL_PAGE_OFFSET		(WORKING_PAGE_START_ADDR - REFERENCE_PAGE_START_ADDR)
+
+/****************************************************************************
+ * Private variables
+ ****************************************************************************/
+
+static uint8_t workingPage[WORKING_PAGE_SIZE] __attribute__((aligned(8)));
+static uintptr_t activeEcuPageOffset = 0;
+
+/****************************************************************************
+ * Private function declarations
+ ****************************************************************************/
+
+static inline int isReferencePageAddress(uintptr_t addr);
+
+/****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+void SilMem_Initialize(void) {
+	if (CAL_PAGE_SIZE > WORKING_PAGE_SIZE) {
+		fprintf(stderr, "SIL: calibration page (%zu bytes) exceeds working page\n", CAL_PAGE_SIZE);
+		abort();
+	}
+	SilMem_CopyReferencePageToWorkingPage();
+	SilMem_SetEcuWorkingPage();
+}
+
+void SilMem_SetEcuReferencePage(void) {
+	activeEcuPageOffset = 0;
+}
+
+void SilMem_SetEcuWorkingPage(void) {
+	activeEcuPageOffset = CAL_PAGE_OFFSET;
+}
+
+void SilMem_CopyReferencePageToWorkingPage(void) {
+	memcpy(workingPage, _sascet_calibration_rom, CAL_PAGE_SIZE);
+}
+
+uintptr_t SilMem_GetActiveEcuPageOffset(void) {
+	return activeEcuPageOffset;
+}
+
+void *SilMem_GetEffectiveAddress(const volatile void *addr) {
+	if (isReferencePageAddress((uintptr_t) addr)) {
+		return (void *) ((uintptr_t) addr + activeEcuPageOffset);
+	}
+	return (void *) addr;
+}
+
+int SilMem_WriteCharacteristic(const volatile void *refAddr, const void *pSrc, size_t numBytes) {
+	uintptr_t addr = (uintptr_t) refAddr;
+
+	if (!isReferencePageAddress(addr) || !isReferencePageAddress(addr + numBytes - 1)) {
+		return 0;
+	}
+	memcpy((void *) (addr + CAL_PAGE_OFFSET), pSrc, numBytes);
+	return 1;
+}
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static inline int isReferencePageAddress(uintptr_t addr) {
+	return (addr >= REFERENCE_PAGE_START_ADDR) && (addr < REFERENCE_PAGE_END_ADDR);
+}
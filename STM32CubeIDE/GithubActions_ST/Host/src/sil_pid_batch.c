@@ -0,0 +1,173 @@
+/**
+ * Batch evaluator of the ServoController PID.
+ *
+ * Mirrors model_ServoController_Automatic_autoMode() of src-gen: any change of
+ * ServoController.autoMode in the model has to be reflected here, the check
+ * mode of tools/pid_batch.c compares both.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sil_pid_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNEL 1
+#endif
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static inline void stepLane(SilPidBatch_t *batch, int i, float ballPosition, float dT) {
+	float error = 0.5F - ballPosition;
+	float integral = batch->integral[i];
+	float servoPosition = batch->servoPosition[i];
+	float t;
+
+	if (batch->doIntegrate[i]) {
+		integral = (batch->ki[i] * error * dT) + integral;
+	}
+	batch->doIntegrate[i] = ((servoPosition < 0.9F) && (servoPosition > 0.1F)) ? -1 : 0;
+	t = (error - batch->lastValue[i]) * batch->kd[i];
+	t = (batch->kp[i] * error) + integral + ((dT == 0.0F) ? t : (t / dT)) + 0.5F;
+
+	batch->servoPosition[i] = (t >= 0.0F) ? ((t <= 1.0F) ? t : 1.0F) : 0.0F;
+	batch->integral[i] = integral;
+	batch->error[i] = error;
+	batch->lastValue[i] = error;
+}
+
+#ifdef HAVE_AVX2_KERNEL
+__attribute__((target("avx2")))
+static void stepAvx2(SilPidBatch_t *batch, const float *ballPosition, float dT, int count) {
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 half = _mm256_set1_ps(0.5F);
+	const __m256 one = _mm256_set1_ps(1.0F);
+	const __m256 lower = _mm256_set1_ps(0.1F);
+	const __m256 upper = _mm256_set1_ps(0.9F);
+	const __m256 vdT = _mm256_set1_ps(dT);
+	const int divide = (dT != 0.0F);
+
+	for (int i = 0; i < count; i += SIL_PID_BATCH_LANES) {
+		__m256 error = _mm256_sub_ps(half, _mm256_loadu_ps(&ballPosition[i]));
+		__m256 integral = _mm256_load_ps(&batch->integral[i]);
+		__m256 servoPosition = _mm256_load_ps(&batch->servoPosition[i]);
+		__m256 doIntegrate = _mm256_castsi256_ps(_mm256_load_si256((const __m256i *) &batch->doIntegrate[i]));
+		__m256 t;
+
+		t = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_load_ps(&batch->ki[i]), error), vdT), integral);
+		integral = _mm256_blendv_ps(integral, t, doIntegrate);
+		doIntegrate = _mm256_and_ps(_mm256_cmp_ps(servoPosition, upper, _CMP_LT_OQ),
+				_mm256_cmp_ps(servoPosition, lower, _CMP_GT_OQ));
+
+		t = _mm256_mul_ps(_mm256_sub_ps(error, _mm256_load_ps(&batch->lastValue[i])), _mm256_load_ps(&batch->kd[i]));
+		if (divide) {
+			t = _mm256_div_ps(t, vdT);
+		}
+		t = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(&batch->kp[i]), error), integral), t), half);
+
+		// (t >= 0) ? ((t <= 1) ? t : 1) : 0, NaN yields 0
+		servoPosition = _mm256_blendv_ps(one, t, _mm256_cmp_ps(t, one, _CMP_LE_OQ));
+		servoPosition = _mm256_blendv_ps(zero, servoPosition, _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+
+		_mm256_store_ps(&batch->servoPosition[i], servoPosition);
+		_mm256_store_ps(&batch->integral[i], integral);
+		_mm256_store_ps(&batch->error[i], error);
+		_mm256_store_ps(&batch->lastValue[i], error);
+		_mm256_store_si256((__m256i *) &batch->doIntegrate[i], _mm256_castps_si256(doIntegrate));
+	}
+}
+#endif
+
+/****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+SilPidBatch_t *SilPidBatch_Create(int count) {
+	if (count < 1) {
+		return NULL;
+	}
+	SilPidBatch_t *batch = calloc(1, sizeof(SilPidBatch_t));
+	if (batch == NULL) {
+		return NULL;
+	}
+	batch->count = count;
+	batch->capacity = (count + SIL_PID_BATCH_LANES - 1) / SIL_PID_BATCH_LANES * SIL_PID_BATCH_LANES;
+
+	// one block for all arrays, each 32 byte aligned
+	size_t arraySize = batch->capacity * sizeof(float);
+	uint8_t *block = aligned_alloc(32, 8 * arraySize);
+	if (block == NULL) {
+		free(batch);
+		return NULL;
+	}
+	memset(block, 0, 8 * arraySize);
+	batch->kp = (float *) (block + 0 * arraySize);
+	batch->ki = (float *) (block + 1 * arraySize);
+	batch->kd = (float *) (block + 2 * arraySize);
+	batch->error = (float *) (block + 3 * arraySize);
+	batch->integral = (float *) (block + 4 * arraySize);
+	batch->lastValue = (float *) (block + 5 * arraySize);
+	batch->servoPosition = (float *) (block + 6 * arraySize);
+	batch->doIntegrate = (int32_t *) (block + 7 * arraySize);
+
+	SilPidBatch_Reset(batch);
+	return batch;
+}
+
+void SilPidBatch_Destroy(SilPidBatch_t *batch) {
+	if (batch == NULL) {
+		return;
+	}
+	free(batch->kp);	// start of the block
+	free(batch);
+}
+
+void SilPidBatch_SetGains(SilPidBatch_t *batch, int index, float kp, float ki, float kd) {
+	batch->kp[index] = kp;
+	batch->ki[index] = ki;
+	batch->kd[index] = kd;
+}
+
+void SilPidBatch_Reset(SilPidBatch_t *batch) {
+	for (int i = 0; i < batch->capacity; i++) {
+		batch->error[i] = 0.0F;
+		batch->integral[i] = 0.0F;
+		batch->lastValue[i] = 0.0F;
+		batch->servoPosition[i] = 0.0F;
+		batch->doIntegrate[i] = -1;
+	}
+}
+
+void SilPidBatch_Step(SilPidBatch_t *batch, const float *ballPosition, float dT) {
+	int i = 0;
+
+#ifdef HAVE_AVX2_KERNEL
+	if (SilPidBatch_HasAvx2()) {
+		i = batch->count / SIL_PID_BATCH_LANES * SIL_PID_BATCH_LANES;
+		stepAvx2(batch, ballPosition, dT, i);
+	}
+#endif
+	for (; i < batch->count; i++) {
+		stepLane(batch, i, ballPosition[i], dT);
+	}
+}
+
+void SilPidBatch_StepScalar(SilPidBatch_t *batch, const float *ballPosition, float dT) {
+	for (int i = 0; i < batch->count; i++) {
+		stepLane(batch, i, ballPosition[i], dT);
+	}
+}
+
+int SilPidBatch_HasAvx2(void) {
+#ifdef HAVE_AVX2_KERNEL
+	static int hasAvx2 = -1;
+	if (hasAvx2 < 0) {
+		hasAvx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	return hasAvx2;
+#else
+	return 0;
+#endif
+}
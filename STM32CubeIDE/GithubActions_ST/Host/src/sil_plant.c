@@ -0,0 +1,144 @@
+/**
+ * Physical model of the Balance Tube for host SIL runs.
+ */
+
+#include <math.h>
+#include "sil_plant.h"
+
+#define DEG_TO_RAD		(M_PI / 180.0)
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+// xorshift64*
+static uint64_t nextRandom(SilPlant_t *plant) {
+	uint64_t x = plant->random;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	plant->random = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double randomUniform(SilPlant_t *plant) {
+	return ((nextRandom(plant) >> 11) + 0.5) * (1.0 / 9007199254740992.0);	// (0, 1)
+}
+
+static double randomGaussian(SilPlant_t *plant) {
+	double u1 = randomUniform(plant);
+	double u2 = randomUniform(plant);
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double acceleration(const SilPlant_t *plant, double velocity) {
+	const SilPlant_Params_t *p = &plant->params;
+	return p->rollingFactor * p->gravity_m_s2 * sin(plant->tilt_deg * DEG_TO_RAD) - p->damping_1_s * velocity;
+}
+
+static void integrate(SilPlant_t *plant, double h) {
+	double x = plant->position_m;
+	double v = plant->velocity_m_s;
+
+	double k1x = v;
+	double k1v = acceleration(plant, v);
+	double k2x = v + 0.5 * h * k1v;
+	double k2v = acceleration(plant, k2x);
+	double k3x = v + 0.5 * h * k2v;
+	double k3v = acceleration(plant, k3x);
+	double k4x = v + h * k3v;
+	double k4v = acceleration(plant, k4x);
+
+	x += h / 6.0 * (k1x + 2.0 * k2x + 2.0 * k3x + k4x);
+	v += h / 6.0 * (k1v + 2.0 * k2v + 2.0 * k3v + k4v);
+
+	// end stops
+	if (x < 0.0) {
+		x = 0.0;
+		v = (v < 0.0) ? -plant->params.restitution * v : v;
+	} else if (x > plant->params.travel_m) {
+		x = plant->params.travel_m;
+		v = (v > 0.0) ? -plant->params.restitution * v : v;
+	}
+	plant->position_m = x;
+	plant->velocity_m_s = v;
+}
+
+static void moveServo(SilPlant_t *plant, double servoPulse_us, double h) {
+	const SilPlant_Params_t *p = &plant->params;
+	double target = p->tiltOffset_deg + p->tiltGain_deg_us * (servoPulse_us - p->levelPulse_us);
+	double maxStep = p->slewRate_deg_s * h;
+
+	target = fmin(fmax(target, -p->tiltMax_deg), p->tiltMax_deg);
+	plant->tilt_deg += fmin(fmax(target - plant->tilt_deg, -maxStep), maxStep);
+}
+
+static void measureRange(SilPlant_t *plant) {
+	const SilPlant_Params_t *p = &plant->params;
+	double range = p->rangeFarEnd_mm - plant->position_m * 1000.0;
+	double sigma = p->tofNoise_mm + p->tofNoiseRelative * range;
+
+	range = round(range + sigma * randomGaussian(plant));
+	plant->tofRange_mm = (uint16_t) fmin(fmax(range, 0.0), 8190.0);
+}
+
+/****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+void SilPlant_GetDefaultParams(SilPlant_Params_t *params) {
+	params->travel_m = 0.41;
+	params->rangeFarEnd_mm = 470.0;
+	params->rollingFactor = 0.6;
+	params->damping_1_s = 0.4;
+	params->restitution = 0.3;
+	params->gravity_m_s2 = 9.81;
+
+	params->levelPulse_us = 1750.0;
+	params->tiltGain_deg_us = 0.03;
+	params->tiltOffset_deg = 0.0;
+	params->tiltMax_deg = 10.0;
+	params->slewRate_deg_s = 60.0;
+
+	params->tofPeriod_s = 0.033;		// timing budget of SetupSingleShot()
+	params->tofNoise_mm = 1.5;
+	params->tofNoiseRelative = 0.01;
+
+	params->subSteps = 10;
+}
+
+void SilPlant_Init(SilPlant_t *plant, const SilPlant_Params_t *params, double position, uint64_t seed) {
+	plant->params = *params;
+	plant->position_m = fmin(fmax(position, 0.0), 1.0) * params->travel_m;
+	plant->velocity_m_s = 0.0;
+	plant->tilt_deg = params->tiltOffset_deg;
+	plant->time_s = 0.0;
+	plant->tofTimer_s = 0.0;
+	plant->random = seed ? seed : 0x9E3779B97F4A7C15ULL;
+	measureRange(plant);
+}
+
+void SilPlant_Step(SilPlant_t *plant, double servoPulse_us, double dt_s) {
+	int n = (plant->params.subSteps > 0) ? plant->params.subSteps : 1;
+	double h = dt_s / n;
+
+	for (int i = 0; i < n; i++) {
+		moveServo(plant, servoPulse_us, h);
+		integrate(plant, h);
+
+		plant->tofTimer_s += h;
+		if (plant->tofTimer_s >= plant->params.tofPeriod_s) {
+			plant->tofTimer_s -= plant->params.tofPeriod_s;
+			measureRange(plant);
+		}
+	}
+	plant->time_s += dt_s;
+}
+
+uint16_t SilPlant_GetRangeMm(const SilPlant_t *plant) {
+	return plant->tofRange_mm;
+}
+
+double SilPlant_GetPosition(const SilPlant_t *plant) {
+	return plant->position_m / plant->params.travel_m;
+}
@@ -0,0 +1,225 @@
+/**
+ * Fixed-size thread pool for running SIL instances in parallel.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sil_pool.h"
+
+typedef struct {
+	Sil_Pool_t *pool;
+	int index;
+	pthread_t thread;
+} Worker_t;
+
+struct Sil_Pool {
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	Sil_PoolJob_t job;
+	void *arg;
+	unsigned long generation;	// incremented per Sil_PoolRun()
+	int pending;				// workers still busy with the current job
+	int shutdown;
+	int numWorkers;
+	Worker_t *workers;
+};
+
+// tasks [next, end) not yet started by a worker
+typedef struct {
+	pthread_mutex_t lock;
+	int next;
+	int end;
+} TaskRange_t;
+
+typedef struct {
+	Sil_PoolTask_t task;
+	void *arg;
+	int numRanges;
+	TaskRange_t *ranges;
+} TaskJob_t;
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static void *workerMain(void *param) {
+	Worker_t *worker = param;
+	Sil_Pool_t *pool = worker->pool;
+	unsigned long generation = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->shutdown && (pool->generation == generation)) {
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+		if (pool->shutdown) {
+			break;
+		}
+		generation = pool->generation;
+		Sil_PoolJob_t job = pool->job;
+		void *arg = pool->arg;
+		pthread_mutex_unlock(&pool->lock);
+
+		job(worker->index, arg);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->pending == 0) {
+			pthread_cond_signal(&pool->done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+// takes the next task of the own range, -1 if the range is empty
+static int popTask(TaskRange_t *range) {
+	int index = -1;
+
+	pthread_mutex_lock(&range->lock);
+	if (range->next < range->end) {
+		index = range->next++;
+	}
+	pthread_mutex_unlock(&range->lock);
+	return index;
+}
+
+// moves the upper half of the largest other range to the own (empty) range,
+// returns 0 if there is nothing left to steal
+static int stealTasks(TaskJob_t *job, int worker) {
+	for (;;) {
+		int victim = -1;
+		int remaining = 0;
+		for (int k = 0; k < job->numRanges; k++) {
+			TaskRange_t *range = &job->ranges[k];
+			pthread_mutex_lock(&range->lock);
+			if ((k != worker) && (range->end - range->next > remaining)) {
+				remaining = range->end - range->next;
+				victim = k;
+			}
+			pthread_mutex_unlock(&range->lock);
+		}
+		if (victim < 0) {
+			return 0;
+		}
+
+		TaskRange_t *from = &job->ranges[victim];
+		TaskRange_t *to = &job->ranges[worker];
+		int start = 0;
+		int end = 0;
+		pthread_mutex_lock(&from->lock);
+		if (from->next < from->end) {
+			end = from->end;
+			start = end - (from->end - from->next + 1) / 2;
+			from->end = start;
+		}
+		pthread_mutex_unlock(&from->lock);
+		if (start < end) {
+			pthread_mutex_lock(&to->lock);
+			to->next = start;
+			to->end = end;
+			pthread_mutex_unlock(&to->lock);
+			return 1;
+		}
+		// the victim finished its range in the meantime, look again
+	}
+}
+
+static void runTasks(int worker, void *arg) {
+	TaskJob_t *job = arg;
+
+	do {
+		int index;
+		while ((index = popTask(&job->ranges[worker])) >= 0) {
+			job->task(worker, index, job->arg);
+		}
+	} while (stealTasks(job, worker));
+}
+
+/****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+Sil_Pool_t *Sil_PoolCreate(int workers) {
+	if (workers < 1) {
+		return NULL;
+	}
+	Sil_Pool_t *pool = calloc(1, sizeof(Sil_Pool_t));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->numWorkers = workers;
+	pool->workers = calloc(workers, sizeof(Worker_t));
+	for (int i = 0; i < workers; i++) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i;
+		pthread_create(&pool->workers[i].thread, NULL, workerMain, &pool->workers[i]);
+	}
+	return pool;
+}
+
+void Sil_PoolDestroy(Sil_Pool_t *pool) {
+	if (pool == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0; i < pool->numWorkers; i++) {
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->start);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->workers);
+	free(pool);
+}
+
+int Sil_PoolGetWorkerCount(const Sil_Pool_t *pool) {
+	return pool->numWorkers;
+}
+
+void Sil_PoolRun(Sil_Pool_t *pool, Sil_PoolJob_t job, void *arg) {
+	pthread_mutex_lock(&pool->lock);
+	pool->job = job;
+	pool->arg = arg;
+	pool->pending = pool->numWorkers;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start);
+	while (pool->pending > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void Sil_PoolRunTasks(Sil_Pool_t *pool, int tasks, Sil_PoolTask_t task, void *arg) {
+	TaskJob_t job;
+
+	job.task = task;
+	job.arg = arg;
+	job.numRanges = pool->numWorkers;
+	job.ranges = calloc(pool->numWorkers, sizeof(TaskRange_t));
+	for (int k = 0; k < pool->numWorkers; k++) {
+		pthread_mutex_init(&job.ranges[k].lock, NULL);
+		job.ranges[k].next = (int) ((long long) tasks * k / pool->numWorkers);
+		job.ranges[k].end = (int) ((long long) tasks * (k + 1) / pool->numWorkers);
+	}
+
+	Sil_PoolRun(pool, runTasks, &job);
+
+	for (int k = 0; k < pool->numWorkers; k++) {
+		pthread_mutex_destroy(&job.ranges[k].lock);
+	}
+	free(job.ranges);
+}
+
+int Sil_GetProcessorCount(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? (int) n : 1;
+}
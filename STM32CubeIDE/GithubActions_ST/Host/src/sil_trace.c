@@ -0,0 +1,142 @@
+/**
+ * Input trace files of the host SIL.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sil_trace.h"
+
+#define WRITE_BUFFER_RECORDS	4096
+
+struct SilTrace_Writer {
+	FILE *file;
+	int error;
+	size_t used;
+	InputTrace_Record_t buffer[WRITE_BUFFER_RECORDS];
+};
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static void flush(SilTrace_Writer_t *writer) {
+	if (writer->used > 0) {
+		if (fwrite(writer->buffer, sizeof(InputTrace_Record_t), writer->used, writer->file) != writer->used) {
+			writer->error = 1;
+		}
+		writer->used = 0;
+	}
+}
+
+/****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+SilTrace_Writer_t *SilTrace_CreateWriter(const char *path, uint32_t period_ms) {
+	InputTrace_Header_t header;
+	SilTrace_Writer_t *writer = calloc(1, sizeof(SilTrace_Writer_t));
+
+	if (writer == NULL) {
+		return NULL;
+	}
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL) {
+		fprintf(stderr, "trace: cannot create %s\n", path);
+		free(writer);
+		return NULL;
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INPUT_TRACE_MAGIC, sizeof(header.magic));
+	header.version = INPUT_TRACE_VERSION;
+	header.headerSize = sizeof(InputTrace_Header_t);
+	header.recordSize = sizeof(InputTrace_Record_t);
+	header.period_ms = period_ms;
+	if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+		writer->error = 1;
+	}
+	return writer;
+}
+
+int SilTrace_Write(SilTrace_Writer_t *writer, const InputTrace_Record_t *record) {
+	writer->buffer[writer->used++] = *record;
+	if (writer->used == WRITE_BUFFER_RECORDS) {
+		flush(writer);
+	}
+	return !writer->error;
+}
+
+int SilTrace_CloseWriter(SilTrace_Writer_t *writer) {
+	flush(writer);
+	if (fclose(writer->file) != 0) {
+		writer->error = 1;
+	}
+	int ok = !writer->error;
+	free(writer);
+	return ok;
+}
+
+int SilTrace_Open(SilTrace_t *trace, const char *path) {
+	struct stat st;
+
+	memset(trace, 0, sizeof(*trace));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "trace: cannot open %s\n", path);
+		return -1;
+	}
+	if ((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(InputTrace_Header_t))) {
+		fprintf(stderr, "trace: %s is not a trace file\n", path);
+		close(fd);
+		return -1;
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "trace: cannot map %s\n", path);
+		return -1;
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+	const InputTrace_Header_t *header = map;
+	if ((memcmp(header->magic, INPUT_TRACE_MAGIC, sizeof(header->magic)) != 0)
+			|| (header->version != INPUT_TRACE_VERSION)
+			|| (header->recordSize != sizeof(InputTrace_Record_t))
+			|| (header->headerSize < sizeof(InputTrace_Header_t))
+			|| (header->headerSize % sizeof(uint32_t) != 0)
+			|| (header->headerSize > (size_t) st.st_size)) {
+		fprintf(stderr, "trace: %s has an unsupported format\n", path);
+		munmap(map, st.st_size);
+		return -1;
+	}
+	trace->header = header;
+	trace->records = (const InputTrace_Record_t *) ((const uint8_t *) map + header->headerSize);
+	trace->count = (st.st_size - header->headerSize) / sizeof(InputTrace_Record_t);
+	trace->map = map;
+	trace->mapSize = st.st_size;
+	return 0;
+}
+
+void SilTrace_Close(SilTrace_t *trace) {
+	if (trace->map != NULL) {
+		munmap(trace->map, trace->mapSize);
+	}
+	memset(trace, 0, sizeof(*trace));
+}
+
+void SilTrace_ToInputs(const InputTrace_Record_t *record, Sil_Inputs_t *inputs) {
+	inputs->adcHandPosition = record->adcHandPosition;
+	inputs->ballDistanceMm = record->ballDistanceMm;
+	inputs->autoModeButton = (record->buttons & INPUT_TRACE_BTN1) != 0;
+	inputs->startGameButton = (record->buttons & INPUT_TRACE_BTN2) != 0;
+}
+
+int SilTrace_IsSameInputs(const InputTrace_Record_t *a, const InputTrace_Record_t *b) {
+	return (a->adcHandPosition == b->adcHandPosition)
+			&& (a->ballDistanceMm == b->ballDistanceMm)
+			&& (a->buttons == b->buttons);
+}
@@ -0,0 +1,136 @@
+/**
+ * Host stand-in for the part of the VL53L0X API used by BalanceTube.c.
+ *
+ * Instead of running the ST driver against a register model, the sensor is
+ * represented by its result: in continuous ranging mode it takes the ball
+ * distance set via Sil_SetInputs() as a new range once per timing budget of
+ * the profile given to SetupSingleShot() (33 ms by default) and signals it on
+ * GPIO1 until the interrupt is cleared, like the real sensor. The
+ * register-level model that runs the ST driver itself is sil_vl53l0x_dev.h,
+ * used by tools/vl53l0x_bench.c.
+ */
+
+#include "vl53l0x_api.h"
+#include "vl53l0x_tof.h"
+#include "sil_hal.h"
+#include "main.h"
+
+#define VL53L0X_ID			0xEEAA
+
+// timing budget of the VL53L0X_RangingProfile_t, see SetupSingleShot() in vl53l0x_tof.c
+static const uint32_t rangingPeriods_ms[VL53L0X_NUM_PROFILES] = { 33, 20, 200 };
+
+static uint32_t rangingPeriod_ms;
+static uint8_t ranging;
+static uint8_t gpio1DataReady;		// GPIO1 configured for VL53L0X_GPIOFUNCTIONALITY_NEW_MEASURE_READY
+static uint8_t dataReady;
+static uint16_t range_mm;
+static uint32_t rangeTime_ms;
+static uint32_t rangingTimer_ms;
+
+void SilVl53l0x_Reset(void) {
+	ranging = 0;
+	gpio1DataReady = 0;
+	dataReady = 0;
+	range_mm = 0;
+	rangeTime_ms = 0;
+	rangingTimer_ms = 0;
+	rangingPeriod_ms = rangingPeriods_ms[VL53L0X_PROFILE_DEFAULT];
+}
+
+void SilVl53l0x_Tick(void) {
+	if (!ranging) {
+		return;
+	}
+	rangingTimer_ms++;
+	if (rangingTimer_ms < rangingPeriod_ms) {
+		return;
+	}
+	rangingTimer_ms = 0;
+	range_mm = SilHal_GetInputs()->ballDistanceMm;
+	rangeTime_ms = HAL_GetTick();
+	if (!dataReady) {
+		dataReady = 1;
+		if (gpio1DataReady) {
+			HAL_GPIO_EXTI_Callback(TOF_INT_Pin);	// falling edge of GPIO1
+		}
+	}
+}
+
+VL53L0X_Error VL53L0X_GetDeviceInfo(VL53L0X_DEV Dev, VL53L0X_DeviceInfo_t *pVL53L0X_DeviceInfo) {
+	strcpy(pVL53L0X_DeviceInfo->Name, "VL53L0X SIL");
+	strcpy(pVL53L0X_DeviceInfo->Type, "VL53L0X");
+	strcpy(pVL53L0X_DeviceInfo->ProductId, "SIL");
+	pVL53L0X_DeviceInfo->ProductType = 1;
+	pVL53L0X_DeviceInfo->ProductRevisionMajor = 1;
+	pVL53L0X_DeviceInfo->ProductRevisionMinor = 1;
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_RdWord(VL53L0X_DEV Dev, uint8_t index, uint16_t *data) {
+	*data = (index == VL53L0X_REG_IDENTIFICATION_MODEL_ID) ? VL53L0X_ID : 0;
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_DataInit(VL53L0X_DEV Dev) {
+	return VL53L0X_ERROR_NONE;
+}
+
+void SetupSingleShot(VL53L0X_DEV Dev, VL53L0X_RangingProfile_t Profile) {
+	if ((unsigned) Profile >= VL53L0X_NUM_PROFILES) {
+		Profile = VL53L0X_PROFILE_DEFAULT;
+	}
+	rangingPeriod_ms = rangingPeriods_ms[Profile];
+	Dev->CalibrationSource = VL53L0X_CALIBRATION_RESTORED;
+	Dev->RangingProfile = (uint8_t) Profile;
+}
+
+VL53L0X_Error VL53L0X_SetDeviceMode(VL53L0X_DEV Dev, VL53L0X_DeviceModes DeviceMode) {
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_StartMeasurement(VL53L0X_DEV Dev) {
+	ranging = 1;
+	rangingTimer_ms = 0;
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_SetGpioConfig(VL53L0X_DEV Dev, uint8_t Pin, VL53L0X_DeviceModes DeviceMode,
+		VL53L0X_GpioFunctionality Functionality, VL53L0X_InterruptPolarity Polarity) {
+	gpio1DataReady = (Functionality == VL53L0X_GPIOFUNCTIONALITY_NEW_MEASURE_READY);
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_ClearInterruptMask(VL53L0X_DEV Dev, uint32_t InterruptMask) {
+	dataReady = 0;
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_GetMeasurementDataReady(VL53L0X_DEV Dev, uint8_t *pMeasurementDataReady) {
+	*pMeasurementDataReady = dataReady;
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_GetRange(VL53L0X_DEV Dev, VL53L0X_Range_t *pRange) {
+	pRange->Ready = dataReady;
+	pRange->RangeMilliMeter = dataReady ? range_mm : 0;
+	pRange->RangeStatus = dataReady ? 0 : 255;
+	dataReady = 0;
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_StartRangeRead(VL53L0X_DEV Dev, VL53L0X_RangeCallback_t Callback) {
+	VL53L0X_Range_t range;
+	VL53L0X_GetRange(Dev, &range);
+	Callback(VL53L0X_ERROR_NONE, &range);	// the read completes instantly
+	return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_GetRangingMeasurementData(VL53L0X_DEV Dev,
+		VL53L0X_RangingMeasurementData_t *pRangingMeasurementData) {
+	memset(pRangingMeasurementData, 0, sizeof(*pRangingMeasurementData));
+	pRangingMeasurementData->TimeStamp = rangeTime_ms;
+	pRangingMeasurementData->RangeMilliMeter = range_mm;
+	pRangingMeasurementData->RangeStatus = 0;
+	return VL53L0X_ERROR_NONE;
+}
@@ -0,0 +1,340 @@
+/**
+ * Register-level model of the VL53L0X, see sil_vl53l0x_dev.h.
+ */
+
+#include <string.h>
+#include "sil_vl53l0x_dev.h"
+#include "vl53l0x_device.h"
+
+#define REG_PAGE_SELECT			0xFF
+#define REG_NVM_ADDRESS			0x94		// page 7: word address of the NVM read
+#define REG_NVM_STROBE			0x83		// page 7: 0 starts the read, non-zero when done
+#define REG_NVM_DATA			0x90		// page 7: 4 bytes, MSB first
+#define REG_VHV_SETTINGS		0xCB		// page 1: result of the VHV calibration
+#define REG_PHASE_CAL			0xEE		// page 1: result of the phase calibration
+#define REG_STOP_VARIABLE		0x91		// page 1
+
+#define SEQUENCE_TCC			0x10
+#define SEQUENCE_DSS			0x08
+#define SEQUENCE_MSRC			0x04
+#define SEQUENCE_PRE_RANGE		0x40
+#define SEQUENCE_FINAL_RANGE	0x80
+
+// overheads of the sequence steps as assumed by VL53L0X_get_measurement_timing_budget_micro_seconds()
+#define START_OVERHEAD_US		1910
+#define END_OVERHEAD_US			960
+#define MSRC_OVERHEAD_US		660
+#define TCC_OVERHEAD_US			590
+#define DSS_OVERHEAD_US			690
+#define PRE_RANGE_OVERHEAD_US	660
+#define FINAL_RANGE_OVERHEAD_US	550
+
+#define RANGE_STATUS_VALID		11			// device range status "range valid"
+
+// reference signal rate per enabled reference SPAD in 9.7 MCPS
+#define REF_RATE_NON_APERTURE	(3 << 7)
+#define REF_RATE_APERTURE		(1 << 6)
+
+// result of a ranging, 9.7 MCPS and 8.8 SPADs
+#define SIGNAL_RATE_RETURN		(10 << 7)
+#define AMBIENT_RATE_RETURN		(1 << 4)
+#define EFFECTIVE_SPAD_COUNT	(12 << 8)
+
+/****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+// xorshift64*
+static uint64_t nextRandom(SilVl53l0xDev_t *dev) {
+	uint64_t x = dev->random;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	dev->random = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static uint8_t *reg(SilVl53l0xDev_t *dev, uint8_t page, uint8_t index) {
+	return &dev->regs[page % SIL_VL53L0X_DEV_PAGES][index];
+}
+
+static uint16_t readWord(const SilVl53l0xDev_t *dev, uint8_t page, uint8_t index) {
+	return (uint16_t) ((dev->regs[page][index] << 8) | dev->regs[page][(uint8_t) (index + 1)]);
+}
+
+static void writeWord(SilVl53l0xDev_t *dev, uint8_t page, uint8_t index, uint16_t value) {
+	*reg(dev, page, index) = (uint8_t) (value >> 8);
+	*reg(dev, page, (uint8_t) (index + 1)) = (uint8_t) value;
+}
+
+// VL53L0X_decode_timeout() and VL53L0X_calc_timeout_us()
+static uint32_t timeoutUs(uint16_t encoded, uint8_t vcselPeriodReg) {
+	uint32_t mclks = ((uint32_t) (encoded & 0xFF) << (encoded >> 8)) + 1;
+	uint32_t vcselPclks = ((uint32_t) vcselPeriodReg + 1) << 1;
+	uint32_t macroPeriod_ns = (2304U * vcselPclks * 1655U + 500U) / 1000U;
+	return (uint32_t) (((uint64_t) mclks * macroPeriod_ns + macroPeriod_ns / 2) / 1000U);
+}
+
+static uint64_t busTime_ns(const SilVl53l0xDev_t *dev, uint32_t bytes) {
+	// start, address byte, data bytes with acknowledge, stop
+	uint64_t bits = 1 + 9 * (1 + (uint64_t) bytes) + 1;
+	return bits * 1000000000ULL / dev->config.bitRate_Hz;
+}
+
+// period of a measurement in continuous mode
+static uint64_t measurementPeriod_ns(const SilVl53l0xDev_t *dev) {
+	uint64_t budget_ns = (uint64_t) SilVl53l0xDev_GetTimingBudgetUs(dev) * 1000U;
+	if (dev->continuous != VL53L0X_REG_SYSRANGE_MODE_TIMED) {
+		return budget_ns;
+	}
+	// inter-measurement period in oscillator ticks per ms, see VL53L0X_SetInterMeasurementPeriodMilliSeconds()
+	uint32_t period = ((uint32_t) dev->regs[0][VL53L0X_REG_SYSTEM_INTERMEASUREMENT_PERIOD] << 24)
+			| ((uint32_t) dev->regs[0][VL53L0X_REG_SYSTEM_INTERMEASUREMENT_PERIOD + 1] << 16)
+			| ((uint32_t) dev->regs[0][VL53L0X_REG_SYSTEM_INTERMEASUREMENT_PERIOD + 2] << 8)
+			| dev->regs[0][VL53L0X_REG_SYSTEM_INTERMEASUREMENT_PERIOD + 3];
+	uint16_t osc = readWord(dev, 0, VL53L0X_REG_OSC_CALIBRATE_VAL);
+	uint64_t period_ns = (uint64_t) ((osc != 0) ? period / osc : period) * 1000000U;
+	return (period_ns > budget_ns) ? period_ns : budget_ns;
+}
+
+static uint16_t referenceSignalRate(const SilVl53l0xDev_t *dev) {
+	uint8_t startSelect = dev->regs[0][VL53L0X_REG_GLOBAL_CONFIG_REF_EN_START_SELECT];
+	uint32_t rate = 0;
+	for (uint32_t spad = 0; spad < 48; spad++) {
+		if (dev->regs[0][VL53L0X_REG_GLOBAL_CONFIG_SPAD_ENABLES_REF_0 + spad / 8] & (1U << (spad % 8))) {
+			// the quadrant of SPADs 128..191 is the non-aperture one, see is_aperture()
+			rate += (((startSelect + spad) >> 6) == 2) ? REF_RATE_NON_APERTURE : REF_RATE_APERTURE;
+		}
+	}
+	return (rate > 0xFFFF) ? 0xFFFF : (uint16_t) rate;
+}
+
+static void completeMeasurement(SilVl53l0xDev_t *dev) {
+	uint8_t wasActive = SilVl53l0xDev_IsInterruptActive(dev);
+	double distance = SilVl53l0xDev_GetDistanceMm(dev);
+	if (dev->config.noise_mm > 0.0) {
+		distance += dev->config.noise_mm * (2.0 * (double) (nextRandom(dev) >> 11) / 9007199254740992.0 - 1.0);
+	}
+	if (distance < 0.0) {
+		distance = 0.0;
+	}
+	// fractional ranges are reported in quarter millimeters
+	uint8_t fractional = dev->regs[0][VL53L0X_REG_SYSTEM_RANGE_CONFIG] & 0x01;
+	double range = fractional ? distance * 4.0 : distance;
+	uint16_t range_reg = (range >= 65535.0) ? 65535 : (uint16_t) (range + 0.5);
+
+	// result block at 0x14, as read by VL53L0X_GetRangingMeasurementData()
+	dev->regs[0][VL53L0X_REG_RESULT_RANGE_STATUS] = (RANGE_STATUS_VALID << 3) | 0x01;
+	writeWord(dev, 0, VL53L0X_REG_RESULT_RANGE_STATUS + 2, EFFECTIVE_SPAD_COUNT);
+	writeWord(dev, 0, VL53L0X_REG_RESULT_RANGE_STATUS + 6, SIGNAL_RATE_RETURN);
+	writeWord(dev, 0, VL53L0X_REG_RESULT_RANGE_STATUS + 8, AMBIENT_RATE_RETURN);
+	writeWord(dev, 0, VL53L0X_REG_RESULT_RANGE_STATUS + 10, range_reg);
+	writeWord(dev, 1, VL53L0X_REG_RESULT_PEAK_SIGNAL_RATE_REF, referenceSignalRate(dev));
+
+	uint8_t functionality = dev->regs[0][VL53L0X_REG_SYSTEM_INTERRUPT_CONFIG_GPIO] & 0x07;
+	if (functionality != 0) {
+		dev->regs[0][VL53L0X_REG_RESULT_INTERRUPT_STATUS] =
+				(dev->regs[0][VL53L0X_REG_RESULT_INTERRUPT_STATUS] & ~0x07) | functionality;
+	}
+	dev->stats.measurements++;
+
+	if (dev->continuous) {
+		dev->measurementEnd_ns += measurementPeriod_ns(dev);
+	} else {
+		dev->measuring = 0;
+	}
+	if (!wasActive && SilVl53l0xDev_IsInterruptActive(dev) && (dev->interrupt != NULL)) {
+		dev->interrupt(dev->interruptUser);
+	}
+}
+
+static void startMeasurement(SilVl53l0xDev_t *dev, uint8_t mode) {
+	dev->measuring = 1;
+	dev->continuous = mode & (VL53L0X_REG_SYSRANGE_MODE_BACKTOBACK | VL53L0X_REG_SYSRANGE_MODE_TIMED);
+	dev->measurementEnd_ns = dev->time_ns + (uint64_t) SilVl53l0xDev_GetTimingBudgetUs(dev) * 1000U;
+	// the start bit clears as soon as the sequence runs
+	dev->regs[0][VL53L0X_REG_SYSRANGE_START] = mode & ~VL53L0X_REG_SYSRANGE_MODE_START_STOP;
+}
+
+static void readNvm(SilVl53l0xDev_t *dev) {
+	uint32_t word = dev->nvm[dev->regs[7][REG_NVM_ADDRESS] % SIL_VL53L0X_DEV_NVM_WORDS];
+	for (int i = 0; i < 4; i++) {
+		dev->regs[7][REG_NVM_DATA + i] = (uint8_t) (word >> (24 - 8 * i));
+	}
+	dev->regs[7][REG_NVM_STROBE] = 0x10;
+}
+
+// side effects of a register write, after the value has been stored
+static void writeRegister(SilVl53l0xDev_t *dev, uint8_t index, uint8_t value) {
+	if (index == REG_PAGE_SELECT) {
+		dev->page = value % SIL_VL53L0X_DEV_PAGES;
+		return;
+	}
+	*reg(dev, dev->page, index) = value;
+
+	if ((dev->page == 7) && (index == REG_NVM_STROBE) && (value == 0)) {
+		readNvm(dev);
+		return;
+	}
+	if (dev->page != 0) {
+		return;
+	}
+	switch (index) {
+	case VL53L0X_REG_SYSRANGE_START:
+		if (value & VL53L0X_REG_SYSRANGE_MODE_START_STOP) {
+			startMeasurement(dev, value);
+		} else if (value & (VL53L0X_REG_SYSRANGE_MODE_BACKTOBACK | VL53L0X_REG_SYSRANGE_MODE_TIMED)) {
+			startMeasurement(dev, value);
+		} else {
+			dev->measuring = 0;			// stop, the measurement in progress is abandoned
+			dev->continuous = 0;
+		}
+		break;
+	case VL53L0X_REG_SYSTEM_INTERRUPT_CLEAR:
+		if (value & 0x01) {
+			dev->regs[0][VL53L0X_REG_RESULT_INTERRUPT_STATUS] &= ~0x07;
+			dev->regs[0][VL53L0X_REG_RESULT_RANGE_STATUS] &= ~0x01;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+void SilVl53l0xDev_GetDefaultConfig(SilVl53l0xDev_Config_t *config) {
+	memset(config, 0, sizeof(*config));
+	config->bitRate_Hz = 400000;
+	config->partUidUpper = 0x10EA5C31;
+	config->partUidLower = 0x2D0F63B9;
+	config->distance_mm = 300.0;
+	config->seed = 1;
+}
+
+void SilVl53l0xDev_Reset(SilVl53l0xDev_t *dev, const SilVl53l0xDev_Config_t *config) {
+	void (*interrupt)(void *user) = dev->interrupt;
+	void *interruptUser = dev->interruptUser;
+
+	memset(dev, 0, sizeof(*dev));
+	dev->config = *config;
+	if (dev->config.bitRate_Hz == 0) {
+		dev->config.bitRate_Hz = 400000;
+	}
+	dev->random = (config->seed != 0) ? config->seed : 1;
+	dev->interrupt = interrupt;
+	dev->interruptUser = interruptUser;
+
+	// power-on values of the registers the driver reads before writing them
+	writeWord(dev, 0, VL53L0X_REG_IDENTIFICATION_MODEL_ID, 0xEEAA);
+	dev->regs[0][VL53L0X_REG_IDENTIFICATION_REVISION_ID] = 0x10;
+	dev->regs[0][VL53L0X_REG_SYSTEM_SEQUENCE_CONFIG] = 0xFF;
+	dev->regs[0][VL53L0X_REG_PRE_RANGE_CONFIG_VCSEL_PERIOD] = 6;		// 14 PCLKs
+	dev->regs[0][VL53L0X_REG_FINAL_RANGE_CONFIG_VCSEL_PERIOD] = 4;	// 10 PCLKs
+	dev->regs[0][VL53L0X_REG_MSRC_CONFIG_TIMEOUT_MACROP] = 0x0C;
+	writeWord(dev, 0, VL53L0X_REG_PRE_RANGE_CONFIG_TIMEOUT_MACROP_HI, 0x0158);
+	writeWord(dev, 0, VL53L0X_REG_FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI, 0x0224);
+	dev->regs[0][VL53L0X_REG_GPIO_HV_MUX_ACTIVE_HIGH] = 0x11;
+	writeWord(dev, 0, VL53L0X_REG_OSC_CALIBRATE_VAL, 0x00BA);
+	dev->regs[0][VL53L0X_REG_GLOBAL_CONFIG_REF_EN_START_SELECT] = 0xB4;
+	dev->regs[1][REG_STOP_VARIABLE] = 0x3C;
+	dev->regs[1][REG_VHV_SETTINGS] = 0x1E;
+	dev->regs[1][REG_PHASE_CAL] = 0x01;
+	writeWord(dev, 1, 0x84, 0x1C00);		// oscillator frequency, 4.12 MHz
+
+	// NVM words as read by VL53L0X_get_info_from_device()
+	dev->nvm[0x02] = 0x01000000;			// module ID
+	dev->nvm[0x24] = 0xFFFFFFFF;			// reference good SPAD map
+	dev->nvm[0x25] = 0xFFFF0000;
+	dev->nvm[0x6B] = (1U << 15) | (5U << 8);	// 5 aperture reference SPADs
+	dev->nvm[0x77] = 0x5A1C3D80;			// product ID characters
+	dev->nvm[0x78] = 0x00000000;
+	dev->nvm[0x79] = 0x00000000;
+	dev->nvm[0x7A] = 0x00000000;
+	dev->nvm[0x7B] = config->partUidUpper;	// the MSB is the revision as well
+	dev->nvm[0x7C] = config->partUidLower;
+}
+
+void SilVl53l0xDev_Transmit(SilVl53l0xDev_t *dev, const uint8_t *data, uint16_t size) {
+	dev->stats.transmits++;
+	dev->stats.bytes += size;
+	dev->stats.bus_ns += busTime_ns(dev, size);
+	SilVl53l0xDev_Advance(dev, busTime_ns(dev, size));
+	if (size == 0) {
+		return;
+	}
+	dev->index = data[0];
+	for (uint16_t i = 1; i < size; i++) {
+		writeRegister(dev, dev->index, data[i]);
+		dev->index++;
+	}
+}
+
+void SilVl53l0xDev_Receive(SilVl53l0xDev_t *dev, uint8_t *data, uint16_t size) {
+	dev->stats.receives++;
+	dev->stats.bytes += size;
+	dev->stats.bus_ns += busTime_ns(dev, size);
+	SilVl53l0xDev_Advance(dev, busTime_ns(dev, size));
+	for (uint16_t i = 0; i < size; i++) {
+		data[i] = (dev->index == REG_PAGE_SELECT) ? dev->page : *reg(dev, dev->page, dev->index);
+		dev->index++;
+	}
+}
+
+void SilVl53l0xDev_Advance(SilVl53l0xDev_t *dev, uint64_t ns) {
+	uint64_t end_ns = dev->time_ns + ns;
+	while (dev->measuring && (dev->measurementEnd_ns <= end_ns)) {
+		dev->time_ns = dev->measurementEnd_ns;
+		completeMeasurement(dev);
+	}
+	dev->time_ns = end_ns;
+}
+
+uint8_t SilVl53l0xDev_IsInterruptActive(const SilVl53l0xDev_t *dev) {
+	return (dev->regs[0][VL53L0X_REG_RESULT_INTERRUPT_STATUS] & 0x07) != 0;
+}
+
+uint32_t SilVl53l0xDev_GetTimingBudgetUs(const SilVl53l0xDev_t *dev) {
+	uint8_t sequence = dev->regs[0][VL53L0X_REG_SYSTEM_SEQUENCE_CONFIG];
+	uint8_t preRangeVcsel = dev->regs[0][VL53L0X_REG_PRE_RANGE_CONFIG_VCSEL_PERIOD];
+	uint8_t finalRangeVcsel = dev->regs[0][VL53L0X_REG_FINAL_RANGE_CONFIG_VCSEL_PERIOD];
+	uint16_t preRangeTimeout = readWord(dev, 0, VL53L0X_REG_PRE_RANGE_CONFIG_TIMEOUT_MACROP_HI);
+	uint32_t budget_us = START_OVERHEAD_US + END_OVERHEAD_US;
+
+	if (sequence & (SEQUENCE_TCC | SEQUENCE_MSRC | SEQUENCE_DSS)) {
+		uint32_t msrc_us = timeoutUs(dev->regs[0][VL53L0X_REG_MSRC_CONFIG_TIMEOUT_MACROP], preRangeVcsel);
+		if (sequence & SEQUENCE_TCC) {
+			budget_us += msrc_us + TCC_OVERHEAD_US;
+		}
+		if (sequence & SEQUENCE_DSS) {
+			budget_us += 2 * (msrc_us + DSS_OVERHEAD_US);
+		} else if (sequence & SEQUENCE_MSRC) {
+			budget_us += msrc_us + MSRC_OVERHEAD_US;
+		}
+	}
+	if (sequence & SEQUENCE_PRE_RANGE) {
+		budget_us += timeoutUs(preRangeTimeout, preRangeVcsel) + PRE_RANGE_OVERHEAD_US;
+	}
+	if (sequence & SEQUENCE_FINAL_RANGE) {
+		// the final range timeout register includes the pre-range
+		uint16_t finalRangeTimeout = readWord(dev, 0, VL53L0X_REG_FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI);
+		uint32_t mclks = ((uint32_t) (finalRangeTimeout & 0xFF) << (finalRangeTimeout >> 8)) + 1;
+		if (sequence & SEQUENCE_PRE_RANGE) {
+			mclks -= ((uint32_t) (preRangeTimeout & 0xFF) << (preRangeTimeout >> 8)) + 1;
+		}
+		uint32_t vcselPclks = ((uint32_t) finalRangeVcsel + 1) << 1;
+		uint32_t macroPeriod_ns = (2304U * vcselPclks * 1655U + 500U) / 1000U;
+		budget_us += (uint32_t) (((uint64_t) (uint16_t) mclks * macroPeriod_ns + macroPeriod_ns / 2) / 1000U)
+				+ FINAL_RANGE_OVERHEAD_US;
+	}
+	return budget_us;
+}
+
+double SilVl53l0xDev_GetDistanceMm(const SilVl53l0xDev_t *dev) {
+	if (dev->config.profile != NULL) {
+		return dev->config.profile(dev->time_ns / 1000U, dev->config.user);
+	}
+	return dev->config.distance_mm;
+}
@@ -0,0 +1,96 @@
+/**
+ * Closed-loop host run of the Balance Tube firmware.
+ *
+ * Plays one game: the start button is pushed after 0.5 s, the controller is
+ * switched to automatic mode after 1 s and the ball is simulated with the
+ * physical plant (or the model of simulation/Stimulator.esdl), driven by the
+ * servo pulse width the firmware writes to TIM2 (see sil_scenario.c). Prints a
+ * trace of the run and the achieved simulation speed compared to real time.
+ *
+ * usage: balancetube_sil [-t seconds] [-s] [-q]
+ *
+ *   -s   use the kinematic ball model of simulation/Stimulator.esdl
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "sil.h"
+#include "sil_scenario.h"
+#include "runtime_stats.h"
+#include "model_Signals_stm32f334r8.h"
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+	double duration_s = 125.0;
+	int quiet = 0;
+	int stimulator = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:sq")) != -1) {
+		switch (opt) {
+		case 't':
+			duration_s = atof(optarg);
+			break;
+		case 's':
+			stimulator = 1;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t seconds] [-s] [-q]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	Sil_Inputs_t inputs = { 0 };
+	SilScenario_t scenario;
+	uint32_t steps = (uint32_t) (duration_s * 1000.0 / SIL_STEP_MS);
+
+	SilScenario_Init(&scenario, 500, 1000);
+	if (stimulator) {
+		SilScenario_UseStimulator(&scenario);
+	}
+	Sil_Initialize();
+
+	double start = now_s();
+	for (uint32_t n = 0; n < steps; n++) {
+		uint32_t t_ms = Sil_GetTimeMs();
+
+		SilScenario_Hook(&inputs, Sil_GetOutputs(), t_ms, &scenario);
+		Sil_SetInputs(&inputs);
+
+		Sil_Step();
+
+		if (!quiet && (t_ms % 5000 == 0)) {
+			printf("t=%7.3fs ball=%.3f servo=%.0fus score=%.1f\n", t_ms / 1000.0,
+					model_Signals_ballPosition, Sil_GetServoPulseUs(), model_Signals_score);
+		}
+	}
+	double elapsed = now_s() - start;
+
+	const Sil_Outputs_t *out = Sil_GetOutputs();
+	printf("steps:        %u (%.1f s simulated)\n", steps, Sil_GetTimeMs() / 1000.0);
+	printf("wall time:    %.3f s\n", elapsed);
+	printf("step rate:    %.0f steps/s\n", steps / elapsed);
+	printf("speed:        %.0fx real time\n", (Sil_GetTimeMs() / 1000.0) / elapsed);
+	printf("score:        %.1f s\n", model_Signals_score);
+	printf("i2c:          %u transfers, %u bytes\n", out->i2cTransfers, out->i2cBytes);
+	printf("ball ranges:  %u (%.2f Hz)\n", runtimeStats.ballRange.ranges, runtimeStats.ballRange.rate_mHz / 1000.0);
+	printf("led frames:   %u\n", out->ledFrames);
+	uint32_t overruns = 0;
+	printf("task runs:   ");
+	for (int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+		printf(" %u", runtimeStats.scheduler.task[i].runs);
+		overruns += runtimeStats.scheduler.task[i].overruns;
+	}
+	printf(" (%u overruns)\n", overruns);
+	return 0;
+}
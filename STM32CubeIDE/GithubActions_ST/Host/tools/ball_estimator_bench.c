@@ -0,0 +1,417 @@
+/**
+ * Latency and noise of the ball distance estimate of ReadBallPosition().
+ *
+ * Runs the 5 ms steps of ReadBallPosition() with both estimates of the ball
+ * distance, the running mean of the held range (ballFilter Boxcar, Core/Src/
+ * running_filter.h) and the alpha-beta estimator of the fresh ranges
+ * (ballFilter AlphaBeta, Core/Src/ball_estimator.h), and compares them with a
+ * reference:
+ *
+ *   - without files, a ball swinging through the tube, ranged every 33 ms with
+ *     +-8 mm noise like the VL53L0X; the reference is the true distance
+ *   - with input trace files (recorded on the board or by sil_replay -r), the
+ *     recorded ranges; the reference is a centered (zero phase) mean of the
+ *     fresh ranges, so it has no delay but some smoothing of its own
+ *
+ * The lag is the shift of the reference that fits the estimate best, the noise
+ * the RMS deviation at that shift. The velocity is compared with the
+ * difference quotient of the reference, against the step-to-step difference of
+ * the running mean, which is what the derivative of the PID sees otherwise.
+ * The fixed-point estimator is checked against the same filter in double.
+ *
+ * usage: ball_estimator_bench [-a alpha] [-b beta] [-n length] [-t seconds] [-c] [file...]
+ *
+ *   -a, -b  gains of the estimator (default: balanceTube_cal)
+ *   -n      window of the running mean (default: balanceTube_cal)
+ *   -c      self-check run
+ *
+ * Exits with 1 on file errors, if the fixed-point estimate deviates from the
+ * double one by more than MAX_ERROR_MM, or (synthetic run) if the estimator
+ * lags the running mean or is noisier.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ball_estimator.h"
+#include "balancetube_cal.h"
+#include "running_filter.h"
+#include "sil_trace.h"
+
+#define STEP_MS				5
+#define RANGE_PERIOD_MS		33			// timing budget of the VL53L0X
+#define MAX_LAG_STEPS		40			// 200 ms
+#define REFERENCE_HALF_WIDTH	2		// fresh ranges on either side of the centered mean
+#define MAX_ERROR_MM		0.1
+
+typedef struct {
+	uint32_t steps;
+	uint32_t *time_ms;			// start of the step
+	uint16_t *range_mm;			// balanceTube_ballRange.distance_mm, held between ranges
+	uint32_t *range_ms;			// balanceTube_ballRange.time_ms
+	uint8_t *fresh;
+	double *reference;			// mm
+	double *referenceVelocity;	// mm/s
+} Input_t;
+
+typedef struct {
+	double *distance;
+	double *velocity;
+} Estimate_t;
+
+typedef struct {
+	double lag_ms;
+	double noise_mm;
+	double error_mm;			// RMS deviation without shift
+	double velocityError;		// RMS deviation of the velocity in mm/s
+} Quality_t;
+
+// double counterpart of BallEstimator_Update()/_Predict()
+typedef struct {
+	double distance;
+	double velocity;			// mm/ms
+	uint32_t time_ms;
+	int valid;
+} AlphaBeta_t;
+
+static uint32_t random_state = 1;
+
+static int allocate(Input_t *input, uint32_t steps) {
+	input->steps = steps;
+	input->time_ms = calloc(steps, sizeof(uint32_t));
+	input->range_mm = calloc(steps, sizeof(uint16_t));
+	input->range_ms = calloc(steps, sizeof(uint32_t));
+	input->fresh = calloc(steps, sizeof(uint8_t));
+	input->reference = calloc(steps, sizeof(double));
+	input->referenceVelocity = calloc(steps, sizeof(double));
+	return (input->time_ms != NULL) && (input->range_mm != NULL) && (input->range_ms != NULL)
+			&& (input->fresh != NULL) && (input->reference != NULL) && (input->referenceVelocity != NULL);
+}
+
+static void release(Input_t *input) {
+	free(input->time_ms);
+	free(input->range_mm);
+	free(input->range_ms);
+	free(input->fresh);
+	free(input->reference);
+	free(input->referenceVelocity);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// inputs
+
+static double swing(double t_s) {
+	return 265.0 + 205.0 * sin(2.0 * M_PI * t_s / 3.0);
+}
+
+// ball swinging between both ends of the tube, ranged every RANGE_PERIOD_MS
+static int generate(Input_t *input, double duration_s) {
+	if (!allocate(input, (uint32_t) (duration_s * 1000.0 / STEP_MS))) {
+		return -1;
+	}
+	uint32_t nextRange_ms = 0;
+	uint16_t range_mm = 0;
+	uint32_t range_ms = 0;
+	for (uint32_t n = 0; n < input->steps; n++) {
+		uint32_t t = n * STEP_MS;
+		input->fresh[n] = 0;
+		if (t >= nextRange_ms) {
+			random_state = random_state * 1664525U + 1013904223U;
+			range_ms = nextRange_ms;
+			range_mm = (uint16_t) (swing(range_ms / 1000.0) + (double) (random_state >> 28) - 8.0);
+			nextRange_ms += RANGE_PERIOD_MS;
+			input->fresh[n] = 1;
+		}
+		input->time_ms[n] = t;
+		input->range_mm[n] = range_mm;
+		input->range_ms[n] = range_ms;
+		input->reference[n] = swing(t / 1000.0);
+		input->referenceVelocity[n] = 205.0 * 2.0 * M_PI / 3.0 * cos(2.0 * M_PI * t / 3000.0);
+	}
+	return 0;
+}
+
+// records of a trace; without fresh flags (older recordings) every change counts as a new range
+static int load(Input_t *input, const SilTrace_t *trace) {
+	if (!allocate(input, (uint32_t) trace->count)) {
+		return -1;
+	}
+	int flagged = 0;
+	for (size_t n = 0; n < trace->count; n++) {
+		flagged |= (trace->records[n].flags & INPUT_TRACE_BALL_FRESH) != 0;
+	}
+
+	uint32_t *freshIndex = malloc(trace->count * sizeof(uint32_t));
+	uint32_t freshCount = 0;
+	if (freshIndex == NULL) {
+		return -1;
+	}
+	uint32_t range_ms = 0;
+	for (uint32_t n = 0; n < input->steps; n++) {
+		const InputTrace_Record_t *record = &trace->records[n];
+		int fresh = flagged ? ((record->flags & INPUT_TRACE_BALL_FRESH) != 0)
+				: ((n == 0) || (record->ballDistanceMm != trace->records[n - 1].ballDistanceMm));
+		if (fresh) {
+			range_ms = record->time_ms;
+			freshIndex[freshCount++] = n;
+		}
+		input->time_ms[n] = record->time_ms;
+		input->range_mm[n] = record->ballDistanceMm;
+		input->range_ms[n] = range_ms;
+		input->fresh[n] = (uint8_t) fresh;
+	}
+
+	// centered mean of the fresh ranges, interpolated between them
+	double *centered = malloc((freshCount + 1) * sizeof(double));
+	if (centered == NULL) {
+		free(freshIndex);
+		return -1;
+	}
+	for (uint32_t k = 0; k < freshCount; k++) {
+		uint32_t first = (k >= REFERENCE_HALF_WIDTH) ? k - REFERENCE_HALF_WIDTH : 0;
+		uint32_t last = (k + REFERENCE_HALF_WIDTH < freshCount) ? k + REFERENCE_HALF_WIDTH : freshCount - 1;
+		double sum = 0.0;
+		for (uint32_t j = first; j <= last; j++) {
+			sum += input->range_mm[freshIndex[j]];
+		}
+		centered[k] = sum / (last - first + 1);
+	}
+	uint32_t k = 0;
+	for (uint32_t n = 0; n < input->steps; n++) {
+		while ((k + 1 < freshCount) && (freshIndex[k + 1] <= n)) {
+			k++;
+		}
+		if ((freshCount < 2) || (k + 1 >= freshCount)) {
+			input->reference[n] = (freshCount > 0) ? centered[k] : input->range_mm[n];
+			input->referenceVelocity[n] = 0.0;
+			continue;
+		}
+		double t0 = input->time_ms[freshIndex[k]];
+		double t1 = input->time_ms[freshIndex[k + 1]];
+		double slope = (centered[k + 1] - centered[k]) / (t1 - t0);
+		input->reference[n] = centered[k] + slope * (input->time_ms[n] - t0);
+		input->referenceVelocity[n] = slope * 1000.0;
+	}
+	free(centered);
+	free(freshIndex);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// estimates
+
+static void runBoxcar(const Input_t *input, uint8_t length, Estimate_t *estimate) {
+	RunningFilter_t filter = { 0 };
+	RunningFilter_SetLength(&filter, length);
+	double previous = 0.0;
+	for (uint32_t n = 0; n < input->steps; n++) {
+		double mean = (double) RunningFilter_Update(&filter, input->range_mm[n])
+				/ (double) (1U << RUNNING_FILTER_FRAC_BITS);
+		estimate->distance[n] = mean;
+		estimate->velocity[n] = (n > 0) ? (mean - previous) * 1000.0 / STEP_MS : 0.0;
+		previous = mean;
+	}
+}
+
+static void runEstimator(const Input_t *input, uint16_t alpha, uint16_t beta, Estimate_t *estimate) {
+	BallEstimator_t estimator;
+	BallEstimator_Reset(&estimator);
+	for (uint32_t n = 0; n < input->steps; n++) {
+		if (input->fresh[n]) {
+			BallEstimator_Update(&estimator, input->range_mm[n], input->range_ms[n], alpha, beta);
+		}
+		estimate->distance[n] = (double) BallEstimator_Predict(&estimator, input->time_ms[n])
+				/ (double) (1U << BALL_ESTIMATOR_FRAC_BITS);
+		estimate->velocity[n] = (double) estimator.velocity * 1000.0 / (double) (1U << BALL_ESTIMATOR_FRAC_BITS);
+	}
+}
+
+static void alphaBetaUpdate(AlphaBeta_t *filter, double distance, uint32_t time_ms, double alpha, double beta) {
+	const double maxVelocity = (double) BALL_ESTIMATOR_MAX_VELOCITY / (double) (1U << BALL_ESTIMATOR_FRAC_BITS);
+	uint32_t dt_ms = time_ms - filter->time_ms;
+	if (filter->valid && ((dt_ms == 0) || ((int32_t) dt_ms < 0))) {
+		return;
+	}
+	if (!filter->valid || (dt_ms > BALL_ESTIMATOR_MAX_GAP_MS)) {
+		filter->distance = distance;
+		filter->velocity = 0.0;
+		filter->time_ms = time_ms;
+		filter->valid = 1;
+		return;
+	}
+	double predicted = filter->distance + filter->velocity * dt_ms;
+	double residual = distance - predicted;
+	filter->distance = predicted + alpha * residual;
+	filter->velocity = fmin(fmax(filter->velocity + beta * residual / dt_ms, -maxVelocity), maxVelocity);
+	filter->time_ms = time_ms;
+}
+
+static double alphaBetaPredict(const AlphaBeta_t *filter, uint32_t now_ms) {
+	int32_t age_ms = (int32_t) (now_ms - filter->time_ms);
+	if (age_ms < 0) {
+		age_ms = 0;
+	} else if (age_ms > BALL_ESTIMATOR_MAX_PREDICTION_MS) {
+		age_ms = BALL_ESTIMATOR_MAX_PREDICTION_MS;
+	}
+	return filter->distance + filter->velocity * age_ms;
+}
+
+// largest deviation of the fixed-point estimate from the double filter
+static double fixedPointError(const Input_t *input, uint16_t alpha, uint16_t beta, const Estimate_t *estimate) {
+	AlphaBeta_t filter = { 0 };
+	double maxError = 0.0;
+	for (uint32_t n = 0; n < input->steps; n++) {
+		if (input->fresh[n]) {
+			alphaBetaUpdate(&filter, input->range_mm[n], input->range_ms[n], alpha / 65536.0, beta / 65536.0);
+		}
+		double error = fabs(estimate->distance[n] - alphaBetaPredict(&filter, input->time_ms[n]));
+		if (error > maxError) {
+			maxError = error;
+		}
+	}
+	return maxError;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// comparison
+
+// RMS deviation from the reference shifted by lag steps, skipping the settling of the filters
+static double rmsDeviation(const Input_t *input, const double *estimate, uint32_t lag) {
+	uint32_t first = MAX_LAG_STEPS + 64;
+	double sum = 0.0;
+	if (input->steps <= first) {
+		return 0.0;
+	}
+	for (uint32_t n = first; n < input->steps; n++) {
+		double d = estimate[n] - input->reference[n - lag];
+		sum += d * d;
+	}
+	return sqrt(sum / (input->steps - first));
+}
+
+static Quality_t assess(const Input_t *input, const Estimate_t *estimate) {
+	Quality_t quality = { 0 };
+	uint32_t bestLag = 0;
+	double best = rmsDeviation(input, estimate->distance, 0);
+	for (uint32_t lag = 1; lag <= MAX_LAG_STEPS; lag++) {
+		double rms = rmsDeviation(input, estimate->distance, lag);
+		if (rms < best) {
+			best = rms;
+			bestLag = lag;
+		}
+	}
+	quality.lag_ms = bestLag * STEP_MS;
+	quality.noise_mm = best;
+	quality.error_mm = rmsDeviation(input, estimate->distance, 0);
+
+	uint32_t first = MAX_LAG_STEPS + 64;
+	double sum = 0.0;
+	for (uint32_t n = first; n < input->steps; n++) {
+		double d = estimate->velocity[n] - input->referenceVelocity[n];
+		sum += d * d;
+	}
+	quality.velocityError = (input->steps > first) ? sqrt(sum / (input->steps - first)) : 0.0;
+	return quality;
+}
+
+static void report(const char *name, const Quality_t *quality) {
+	printf("  %-18s lag %5.1f ms, noise %6.2f mm, error %6.2f mm, velocity error %7.1f mm/s\n", name,
+			quality->lag_ms, quality->noise_mm, quality->error_mm, quality->velocityError);
+}
+
+// compares both estimates on one input, returns 0 if the fixed-point estimator matches the double one
+static int compare(const char *name, const Input_t *input, uint8_t length, uint16_t alpha, uint16_t beta,
+		Quality_t *boxcar, Quality_t *estimator) {
+	Estimate_t estimate = { calloc(input->steps, sizeof(double)), calloc(input->steps, sizeof(double)) };
+	if ((estimate.distance == NULL) || (estimate.velocity == NULL)) {
+		return -1;
+	}
+	runBoxcar(input, length, &estimate);
+	*boxcar = assess(input, &estimate);
+	runEstimator(input, alpha, beta, &estimate);
+	*estimator = assess(input, &estimate);
+	double error = fixedPointError(input, alpha, beta, &estimate);
+
+	uint32_t ranges = 0;
+	for (uint32_t n = 0; n < input->steps; n++) {
+		ranges += input->fresh[n];
+	}
+	printf("%s: %u steps, %u ranges\n", name, input->steps, ranges);
+	report("running mean", boxcar);
+	report("alpha-beta", estimator);
+	printf("  fixed point vs double: %.4f mm (limit %.4f mm)\n", error, MAX_ERROR_MM);
+
+	free(estimate.distance);
+	free(estimate.velocity);
+	return (error <= MAX_ERROR_MM) ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+	double duration_s = 600.0;
+	int alpha = balanceTube_cal.ballEstimatorAlpha;
+	int beta = balanceTube_cal.ballEstimatorBeta;
+	int length = balanceTube_cal.ballFilterLength;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "a:b:n:t:c")) != -1) {
+		switch (opt) {
+		case 'a':
+			alpha = (int) lround(atof(optarg) * 65536.0);
+			break;
+		case 'b':
+			beta = (int) lround(atof(optarg) * 65536.0);
+			break;
+		case 'n':
+			length = atoi(optarg);
+			break;
+		case 't':
+			duration_s = atof(optarg);
+			break;
+		case 'c':
+			duration_s = 60.0;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-a alpha] [-b beta] [-n length] [-t seconds] [-c] [file...]\n", argv[0]);
+			return 2;
+		}
+	}
+	if ((alpha < 0) || (alpha > 65535) || (beta < 0) || (beta > 65535) || (length < 1)
+			|| (length > RUNNING_FILTER_MAX_LENGTH) || (duration_s <= 0.0)) {
+		fprintf(stderr, "gains must be 0..0.99998, the length 1..%d\n", RUNNING_FILTER_MAX_LENGTH);
+		return 2;
+	}
+	printf("running mean of %d steps, alpha %.4f, beta %.4f\n", length, alpha / 65536.0, beta / 65536.0);
+
+	Input_t input;
+	Quality_t boxcar;
+	Quality_t estimator;
+	int failed = 0;
+
+	if (optind == argc) {
+		if (generate(&input, duration_s) != 0) {
+			return 2;
+		}
+		failed = compare("swinging ball", &input, (uint8_t) length, (uint16_t) alpha, (uint16_t) beta, &boxcar,
+				&estimator) != 0;
+		failed |= (estimator.lag_ms >= boxcar.lag_ms) || (estimator.error_mm >= boxcar.error_mm);
+		release(&input);
+	}
+	for (int i = optind; i < argc; i++) {
+		SilTrace_t trace;
+		if (SilTrace_Open(&trace, argv[i]) != 0) {
+			failed = 1;
+			continue;
+		}
+		if (load(&input, &trace) != 0) {
+			SilTrace_Close(&trace);
+			return 2;
+		}
+		failed |= compare(argv[i], &input, (uint8_t) length, (uint16_t) alpha, (uint16_t) beta, &boxcar,
+				&estimator) != 0;
+		release(&input);
+		SilTrace_Close(&trace);
+	}
+	return failed ? 1 : 0;
+}
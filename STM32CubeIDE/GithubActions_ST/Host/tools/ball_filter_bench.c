@@ -0,0 +1,157 @@
+/**
+ * Equivalence check and benchmark of the ball distance filter.
+ *
+ * Feeds the same distance samples (a ball moving through the tube with sensor
+ * noise) to the running filter of ReadBallPosition() (Core/Src/running_filter.h)
+ * and to the double ring buffer it replaced, which sums the complete window in
+ * every step. Compares the means once the window is filled and reports the
+ * time per step of both.
+ *
+ * The host has a hardware FPU, so the gap is far smaller than on the
+ * Cortex-M4F, where double arithmetic is emulated in software. The cycles on
+ * the target are measured by runtimeStats.ReadBallPosition (see
+ * Core/Src/runtime_stats.h).
+ *
+ * usage: ball_filter_bench [-n length] [-s steps] [-c]
+ *
+ *   -c   short self-check run
+ *
+ * Exits with 1 if a mean deviates by more than the rounding of the fixed-point
+ * result.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+#include "running_filter.h"
+
+#define MAX_ERROR_MM	(0.5 / (1U << RUNNING_FILTER_FRAC_BITS))
+
+typedef struct {
+	double buf[RUNNING_FILTER_MAX_LENGTH];
+	uint8_t length;
+	uint8_t i;
+} Boxcar_t;
+
+static uint32_t random_state = 1;
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t cycles(void) {
+#ifdef __x86_64__
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// ball swinging between both ends of the tube, +-8 mm noise as from the VL53L0X
+static void generateSamples(uint16_t *samples, uint32_t steps) {
+	for (uint32_t n = 0; n < steps; n++) {
+		random_state = random_state * 1664525U + 1013904223U;
+		double position = 265.0 + 205.0 * sin(2.0 * M_PI * n * 0.005 / 3.0);
+		samples[n] = (uint16_t) (position + (double) (random_state >> 28) - 8.0);
+	}
+}
+
+// ReadBallPosition() before the running filter (BUF_SIZE samples, starting with zeros)
+static double boxcarUpdate(Boxcar_t *boxcar, uint16_t sample) {
+	boxcar->buf[boxcar->i] = (double) sample;
+	boxcar->i++;
+	if (boxcar->i >= boxcar->length) {
+		boxcar->i = 0;
+	}
+	double sum = 0.0;
+	for (uint8_t j = 0; j < boxcar->length; j++) {
+		sum += boxcar->buf[j];
+	}
+	return sum / ((double) boxcar->length);
+}
+
+static double runningUpdate(RunningFilter_t *filter, uint16_t sample) {
+	return (double) RunningFilter_Update(filter, sample) / (double) (1U << RUNNING_FILTER_FRAC_BITS);
+}
+
+int main(int argc, char *argv[]) {
+	uint32_t steps = 10000000;
+	int length = 32;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:c")) != -1) {
+		switch (opt) {
+		case 'n':
+			length = atoi(optarg);
+			break;
+		case 's':
+			steps = (uint32_t) atol(optarg);
+			break;
+		case 'c':
+			steps = 1000000;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n length] [-s steps] [-c]\n", argv[0]);
+			return 2;
+		}
+	}
+	if ((length < 1) || (length > RUNNING_FILTER_MAX_LENGTH) || (steps <= (uint32_t) length)) {
+		fprintf(stderr, "length must be 1..%d and less than the steps\n", RUNNING_FILTER_MAX_LENGTH);
+		return 2;
+	}
+
+	uint16_t *samples = malloc(steps * sizeof(uint16_t));
+	double *reference = malloc(steps * sizeof(double));
+	double *filtered = malloc(steps * sizeof(double));
+	if ((samples == NULL) || (reference == NULL) || (filtered == NULL)) {
+		return 2;
+	}
+	generateSamples(samples, steps);
+
+	Boxcar_t boxcar = { .length = (uint8_t) length };
+	double t0 = now_s();
+	uint64_t c0 = cycles();
+	for (uint32_t n = 0; n < steps; n++) {
+		reference[n] = boxcarUpdate(&boxcar, samples[n]);
+	}
+	uint64_t c1 = cycles();
+	double t1 = now_s();
+
+	RunningFilter_t filter = { 0 };
+	RunningFilter_SetLength(&filter, (uint8_t) length);
+	double t2 = now_s();
+	uint64_t c2 = cycles();
+	for (uint32_t n = 0; n < steps; n++) {
+		filtered[n] = runningUpdate(&filter, samples[n]);
+	}
+	uint64_t c3 = cycles();
+	double t3 = now_s();
+
+	// the ring buffer starts with zeros, compare once the window is filled
+	double maxError = 0.0;
+	for (uint32_t n = (uint32_t) length - 1; n < steps; n++) {
+		double error = fabs(filtered[n] - reference[n]);
+		if (error > maxError) {
+			maxError = error;
+		}
+	}
+
+	printf("window %d, %u steps\n", length, steps);
+	printf("  double ring buffer:  %6.2f ns/step, %6.1f TSC cycles/step\n",
+			(t1 - t0) * 1e9 / steps, (double) (c1 - c0) / steps);
+	printf("  running filter:      %6.2f ns/step, %6.1f TSC cycles/step (%.1fx)\n",
+			(t3 - t2) * 1e9 / steps, (double) (c3 - c2) / steps, (t1 - t0) / (t3 - t2));
+	printf("  max deviation:       %.6f mm (limit %.6f mm)\n", maxError, MAX_ERROR_MM);
+
+	free(samples);
+	free(reference);
+	free(filtered);
+	return (maxError <= MAX_ERROR_MM) ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+/**
+ * Finds double arithmetic reachable from the control step.
+ *
+ * The STM32F334 has a single-precision FPU, so every double operation of the
+ * firmware becomes a call into the soft-float routines of libgcc. This tool
+ * reads the disassembly of the host objects of the firmware and the model
+ * (objdump -dr --no-show-raw-insn, x86-64) from stdin, builds the call graph from the call and
+ * jump targets and relocations of every function, and reports each function
+ * reachable from the roots that contains a double-precision instruction (SSE2
+ * scalar or packed double, conversions from or to double, x87), with the
+ * call path that reaches it. The host compiler turns double arithmetic of the
+ * C source into these instructions just like the target compiler turns it
+ * into soft-float calls, so the check stands in for the target build.
+ *
+ * Calls through function pointers and interrupt handlers are not part of the
+ * graph, so functions called through a table (the tasks of the scheduler) are
+ * given as roots of their own; functions outside of the objects (HAL, libc)
+ * are leaves. The cold
+ * parts the compiler splits off a function (name.cold) count as the function.
+ *
+ * usage: objdump -dr --no-show-raw-insn objects... | double_check [-r root]... [-v]
+ *
+ *   -r  root of the call graph (default runBalanceTube), may be repeated
+ *   -v  list every reachable function
+ *
+ * Exits with 1 if a reachable function uses double, 2 on input errors.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_FUNCTIONS		4096
+#define MAX_EDGES			32768
+#define MAX_ROOTS			8
+#define MAX_NAME			128
+
+typedef struct {
+	char name[MAX_NAME];
+	uint32_t doubles;			// double-precision instructions
+	char example[64];			// the first of them
+	int parent;					// on the call path from a root, -1 for a root
+	int reached;
+} Function_t;
+
+typedef struct {
+	int from;
+	char to[MAX_NAME];
+} Edge_t;
+
+static Function_t functions[MAX_FUNCTIONS];
+static int functionCount;
+static Edge_t edges[MAX_EDGES];
+static int edgeCount;
+
+static const char *const doubleMnemonics[] = {
+	"addsd", "subsd", "mulsd", "divsd", "sqrtsd", "minsd", "maxsd",
+	"addpd", "subpd", "mulpd", "divpd", "sqrtpd", "minpd", "maxpd",
+	"comisd", "ucomisd", "cmpsd", "cmppd",
+	"cvtss2sd", "cvtsd2ss", "cvtsi2sd", "cvtsi2sdl", "cvtsi2sdq", "cvtsd2si", "cvttsd2si",
+	"cvtps2pd", "cvtpd2ps", "cvtdq2pd", "cvtpd2dq", "cvttpd2dq",
+	NULL
+};
+
+// function name without the suffix of a split off cold part
+static void baseName(char *name) {
+	char *cold = strstr(name, ".cold");
+	if (cold != NULL) {
+		*cold = '\0';
+	}
+}
+
+static int findFunction(const char *name) {
+	for (int i = 0; i < functionCount; i++) {
+		if (strcmp(functions[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int addFunction(const char *name) {
+	int i = findFunction(name);
+	if (i >= 0) {
+		return i;
+	}
+	if (functionCount >= MAX_FUNCTIONS) {
+		fprintf(stderr, "more than %d functions\n", MAX_FUNCTIONS);
+		exit(2);
+	}
+	Function_t *function = &functions[functionCount];
+	snprintf(function->name, sizeof(function->name), "%s", name);
+	function->parent = -1;
+	return functionCount++;
+}
+
+static void addEdge(int from, const char *to) {
+	char name[MAX_NAME];
+	snprintf(name, sizeof(name), "%s", to);
+	name[strcspn(name, "+-@")] = '\0';		// offset, addend or symbol version
+	baseName(name);
+	if ((name[0] == '\0') || (name[0] == '.') || (strcmp(name, functions[from].name) == 0)) {
+		return;		// section symbols and jumps within the function
+	}
+	if (edgeCount >= MAX_EDGES) {
+		fprintf(stderr, "more than %d references\n", MAX_EDGES);
+		exit(2);
+	}
+	edges[edgeCount].from = from;
+	snprintf(edges[edgeCount].to, sizeof(edges[edgeCount].to), "%s", name);
+	edgeCount++;
+}
+
+static int isDouble(const char *mnemonic) {
+	if ((mnemonic[0] == 'v') && (strlen(mnemonic) > 4)) {
+		mnemonic++;				// VEX encoded form
+	}
+	if (mnemonic[0] == 'f') {
+		return 1;				// x87, only used for double and long double
+	}
+	for (int i = 0; doubleMnemonics[i] != NULL; i++) {
+		if (strcmp(mnemonic, doubleMnemonics[i]) == 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void parse(FILE *input) {
+	char line[512];
+	int current = -1;
+
+	while (fgets(line, sizeof(line), input) != NULL) {
+		line[strcspn(line, "\n")] = '\0';
+		char name[MAX_NAME];
+		unsigned long long address;
+
+		// "0000000000000000 <ReadButtons>:"
+		if ((sscanf(line, "%llx <%127[^>]>:", &address, name) == 2) && (line[0] != ' ')) {
+			baseName(name);
+			current = addFunction(name);
+			continue;
+		}
+		if ((current < 0) || (line[0] != ' ' && line[0] != '\t')) {
+			continue;
+		}
+		// relocation: "\t\t\tf: R_X86_64_PLT32\tHAL_GPIO_ReadPin-0x4"
+		char *reloc = strstr(line, "R_X86_64_");
+		if (reloc != NULL) {
+			char *symbol = strpbrk(reloc, " \t");
+			if (symbol != NULL) {
+				symbol += strspn(symbol, " \t");
+				addEdge(current, symbol);
+			}
+			continue;
+		}
+		// instruction: "   4:\tcall   13 <ReadButtons+0x13>"
+		char *text = strchr(line, '\t');
+		if ((text == NULL) || (text[-1] != ':')) {
+			continue;
+		}
+		text += strspn(text, " \t");
+		char mnemonic[32];
+		if (sscanf(text, "%31s", mnemonic) != 1) {
+			continue;
+		}
+		if (isDouble(mnemonic)) {
+			if (functions[current].doubles++ == 0) {
+				snprintf(functions[current].example, sizeof(functions[current].example), "%s", text);
+			}
+		}
+		char *target = strchr(text, '<');
+		if ((target != NULL) && ((strncmp(mnemonic, "call", 4) == 0) || (mnemonic[0] == 'j'))) {
+			char *end = strchr(target, '>');
+			if (end != NULL) {
+				*end = '\0';
+				addEdge(current, target + 1);
+			}
+		}
+	}
+}
+
+static void printPath(int f) {
+	if (functions[f].parent >= 0) {
+		printPath(functions[f].parent);
+		printf(" -> ");
+	}
+	printf("%s", functions[f].name);
+}
+
+int main(int argc, char *argv[]) {
+	const char *roots[MAX_ROOTS];
+	int rootCount = 0;
+	int verbose = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:v")) != -1) {
+		switch (opt) {
+		case 'r':
+			if (rootCount < MAX_ROOTS) {
+				roots[rootCount++] = optarg;
+			}
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: objdump -dr --no-show-raw-insn objects... | %s [-r root]... [-v]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (rootCount == 0) {
+		roots[rootCount++] = "runBalanceTube";
+	}
+
+	parse(stdin);
+
+	// breadth first, so the path printed is a shortest one
+	int queue[MAX_FUNCTIONS];
+	int head = 0, tail = 0;
+	for (int r = 0; r < rootCount; r++) {
+		int f = findFunction(roots[r]);
+		if (f < 0) {
+			fprintf(stderr, "root %s not found in the disassembly\n", roots[r]);
+			return 2;
+		}
+		functions[f].reached = 1;
+		queue[tail++] = f;
+	}
+	while (head < tail) {
+		int from = queue[head++];
+		for (int e = 0; e < edgeCount; e++) {
+			if (edges[e].from != from) {
+				continue;
+			}
+			int to = findFunction(edges[e].to);
+			if ((to >= 0) && !functions[to].reached) {
+				functions[to].reached = 1;
+				functions[to].parent = from;
+				queue[tail++] = to;
+			}
+		}
+	}
+
+	int offending = 0;
+	for (int i = 0; i < tail; i++) {
+		Function_t *function = &functions[queue[i]];
+		if (verbose) {
+			printf("  %-48s %u double instructions\n", function->name, function->doubles);
+		}
+		if (function->doubles > 0) {
+			offending++;
+			printf("double in ");
+			printPath(queue[i]);
+			printf(": %u instructions, first: %s\n", function->doubles, function->example);
+		}
+	}
+	printf("%d functions in the objects, %d reachable from", functionCount, tail);
+	for (int r = 0; r < rootCount; r++) {
+		printf(" %s()", roots[r]);
+	}
+	printf(", %d with double arithmetic\n", offending);
+	return (offending > 0) ? 1 : 0;
+}
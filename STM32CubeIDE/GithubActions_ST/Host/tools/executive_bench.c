@@ -0,0 +1,196 @@
+/**
+ * Self-check of the dispatching of the executive (Core/Inc/executive.h).
+ *
+ * Runs scenarios of three tasks of the priorities 0 (highest) to 2 against the
+ * SIL port of the executive, where a dispatch runs when the OS interrupts are
+ * resumed, like PendSV on the target after the interrupt or the API call that
+ * made a task ready. Every task body is a script: it appends its start and end
+ * to a trace (the digit of the task at the start, its letter at the end) and
+ * calls the API in between, so a preemption shows as a nested pair, e.g.
+ * "20ac" for task 0 preempting task 2. The cycle counter is advanced by
+ * hand to check that the execution time of a task does not include the time
+ * it was preempted.
+ *
+ * usage: executive_bench [-c]
+ *
+ *   -c  self-check run (the default, the option is accepted for make check)
+ *
+ * Exits with 1 if a scenario does not run in the expected order or with the
+ * expected status codes and statistics.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "executive.h"
+#include "runtime_stats.h"
+
+#define NUM_TASKS			3
+#define MAX_STEPS			5
+
+typedef enum {
+	STEP_NONE = 0,
+	STEP_ACTIVATE,				// ActivateTask(arg)
+	STEP_GET,					// GetResource(arg)
+	STEP_RELEASE,				// ReleaseResource(arg)
+	STEP_SPEND					// arg cycles pass
+} StepKind_t;
+
+typedef struct {
+	StepKind_t kind;
+	uint8_t arg;
+	StatusType expected;
+} Step_t;
+
+typedef struct {
+	const char *name;
+	Step_t background[MAX_STEPS];		// all with the OS interrupts suspended
+	Step_t task[NUM_TASKS][MAX_STEPS];
+	const char *trace;
+	uint32_t last[NUM_TASKS];			// 0: not checked
+	uint32_t preemptions[NUM_TASKS];
+} Scenario_t;
+
+static const Scenario_t scenarios[] = {
+	{
+		.name = "priority order",
+		.background = { { STEP_ACTIVATE, 2 }, { STEP_ACTIVATE, 0 }, { STEP_ACTIVATE, 1 } },
+		.trace = "0a1b2c"
+	},
+	{
+		.name = "preemption by a higher activation",
+		.background = { { STEP_ACTIVATE, 2 } },
+		.task[2] = { { STEP_SPEND, 100 }, { STEP_ACTIVATE, 0 }, { STEP_SPEND, 50 } },
+		.task[0] = { { STEP_SPEND, 30 } },
+		.trace = "20ac",
+		.last = { 30, 0, 150 },
+		.preemptions = { 0, 0, 1 }
+	},
+	{
+		.name = "no preemption by a lower activation",
+		.background = { { STEP_ACTIVATE, 0 } },
+		.task[0] = { { STEP_ACTIVATE, 2 } },
+		.trace = "0a2c"
+	},
+	{
+		.name = "activation while ready or running",
+		.background = { { STEP_ACTIVATE, 1 }, { STEP_ACTIVATE, 1, E_OS_LIMIT }, { STEP_ACTIVATE, 3, E_OS_ID } },
+		.task[1] = { { STEP_ACTIVATE, 1, E_OS_LIMIT } },
+		.trace = "1b"
+	},
+	{
+		.name = "ceiling of a resource",
+		.background = { { STEP_ACTIVATE, 2 } },
+		.task[2] = { { STEP_GET, 1 }, { STEP_ACTIVATE, 1 }, { STEP_ACTIVATE, 0 }, { STEP_RELEASE, 1 } },
+		.trace = "20a1bc",
+		.preemptions = { 0, 0, 2 }
+	},
+	{
+		.name = "RES_SCHEDULER in the background",
+		.background = { { STEP_GET, RES_SCHEDULER }, { STEP_ACTIVATE, 0 }, { STEP_RELEASE, RES_SCHEDULER } },
+		.trace = "0a"
+	},
+	{
+		.name = "release out of order",
+		.background = { { STEP_RELEASE, 1, E_OS_NOFUNC }, { STEP_ACTIVATE, 2 } },
+		.task[2] = { { STEP_GET, 1 }, { STEP_GET, 0 }, { STEP_RELEASE, 1, E_OS_NOFUNC }, { STEP_RELEASE, 0 },
+				{ STEP_RELEASE, 1 } },
+		.trace = "2c"
+	}
+};
+
+static const Scenario_t *scenario;
+static char trace[64];
+static int failed;
+
+static void append(char c) {
+	size_t length = strlen(trace);
+	if (length < sizeof(trace) - 1) {
+		trace[length] = c;
+		trace[length + 1] = '\0';
+	}
+}
+
+// context: the task, -1 for the background
+static void runSteps(const Step_t *steps, int context) {
+	for (int i = 0; (i < MAX_STEPS) && (steps[i].kind != STEP_NONE); i++) {
+		StatusType status = E_OK;
+		switch (steps[i].kind) {
+		case STEP_ACTIVATE:
+			status = ActivateTask(steps[i].arg);
+			break;
+		case STEP_GET:
+			status = GetResource(steps[i].arg);
+			break;
+		case STEP_RELEASE:
+			status = ReleaseResource(steps[i].arg);
+			break;
+		case STEP_SPEND:
+			DWT->CYCCNT += steps[i].arg;
+			break;
+		default:
+			break;
+		}
+		if (status != steps[i].expected) {
+			printf("  %s: step %d of %s %d returned %u, expected %u\n", scenario->name, i,
+					(context < 0) ? "background" : "task", context, status, steps[i].expected);
+			failed = 1;
+		}
+	}
+}
+
+static void runTask(TaskType task) {
+	append((char) ('0' + task));
+	runSteps(scenario->task[task], task);
+	append((char) ('a' + task));
+}
+
+static void task0(void) {
+	runTask(0);
+}
+
+static void task1(void) {
+	runTask(1);
+}
+
+static void task2(void) {
+	runTask(2);
+}
+
+static const Executive_Entry_t tasks[NUM_TASKS] = { task0, task1, task2 };
+
+int main(int argc, char **argv) {
+	int count = (int) (sizeof(scenarios) / sizeof(scenarios[0]));
+
+	for (int s = 0; s < count; s++) {
+		int failedBefore = failed;
+		scenario = &scenarios[s];
+		trace[0] = '\0';
+		memset(&runtimeStats, 0, sizeof(runtimeStats));
+		Executive_Initialize(tasks, NUM_TASKS);
+
+		SuspendOSInterrupts();
+		runSteps(scenario->background, -1);
+		ResumeOSInterrupts();
+
+		if (strcmp(trace, scenario->trace) != 0) {
+			printf("  %s: trace %s, expected %s\n", scenario->name, trace, scenario->trace);
+			failed = 1;
+		}
+		for (int t = 0; t < NUM_TASKS; t++) {
+			const RuntimeStats_Task_t *stats = &runtimeStats.scheduler.task[t];
+			if ((scenario->last[t] != 0) && (stats->last != scenario->last[t])) {
+				printf("  %s: task %d took %u cycles, expected %u\n", scenario->name, t, stats->last,
+						scenario->last[t]);
+				failed = 1;
+			}
+			if (stats->preemptions != scenario->preemptions[t]) {
+				printf("  %s: task %d preempted %u times, expected %u\n", scenario->name, t,
+						stats->preemptions, scenario->preemptions[t]);
+				failed = 1;
+			}
+		}
+		printf("%-36s %-8s %s\n", scenario->name, trace, (failed != failedBefore) ? "FAILED" : "ok");
+	}
+
+	return failed;
+}
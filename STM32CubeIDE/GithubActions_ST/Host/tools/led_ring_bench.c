@@ -0,0 +1,173 @@
+/**
+ * Check and benchmark of the gamma-corrected packing of the LED ring.
+ *
+ * ControlLedRing() packs the channels of the model output through the
+ * NeoPixel_Gamma table (Core/Src/neopixel.h) straight into the frame the DMA
+ * streams. This runs the generated methods of model.LedController for the
+ * channels:
+ *
+ *   - fadeViolet() through several fading cycles of the stop watch
+ *   - indicateGameTime() over a sweep of the game time and beyond its ends
+ *
+ * and packs every ring with the table and with the gamma formula computed per
+ * channel, which have to give the same frame. It also checks every table
+ * entry against its formula and reports the time per frame of both packings.
+ *
+ * usage: led_ring_bench [-s steps] [-c]
+ *
+ *   -s  frames per packing for the timing (default 10000000)
+ *   -c  short self-check run
+ *
+ * Exits with 1 if a table entry or a packed frame is off.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+#include "model_LedController_stm32f334r8.h"
+#include "neopixel.h"
+
+#define NUM_LEDS			12
+#define DT_S				0.005F		// 5 ms step
+#define FADE_STEPS			3000		// 15 s, more than three cycles of 4 s
+#define SWEEP_STEPS			120000		// game time -0.1 .. 1.1 in steps of 1e-5
+
+#define RAM					esdl_ledController_model_MainClass_RAM
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t cycles(void) {
+#ifdef __x86_64__
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static uint8_t gammaFormula(uint8_t brightness) {
+	return (uint8_t) lround(255.0 * pow(brightness / 255.0, NEOPIXEL_GAMMA));
+}
+
+__attribute__((noinline)) static void packTable(const struct model_RgbLed_stm32f334r8 *ring, uint32_t *frame) {
+	for (int i = 0; i < NUM_LEDS; i++) {
+		frame[i] = NeoPixel_GammaGrb(ring[i].red, ring[i].green, ring[i].blue);
+	}
+}
+
+__attribute__((noinline)) static void packFormula(const struct model_RgbLed_stm32f334r8 *ring, uint32_t *frame) {
+	for (int i = 0; i < NUM_LEDS; i++) {
+		frame[i] = NeoPixel_Grb(gammaFormula(ring[i].red), gammaFormula(ring[i].green), gammaFormula(ring[i].blue));
+	}
+}
+
+// 1 if both packings of the current model output differ
+static int frameDeviates(void) {
+	uint32_t table[NUM_LEDS];
+	uint32_t formula[NUM_LEDS];
+
+	packTable(RAM.ledRing, table);
+	packFormula(RAM.ledRing, formula);
+	for (int i = 0; i < NUM_LEDS; i++) {
+		if (table[i] != formula[i]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int checkFrames(void) {
+	uint32_t deviating = 0;
+
+	RAM.sw.timeCounter = 0.0F;
+	for (int n = 0; n < FADE_STEPS; n++) {
+		model_LedController_stm32f334r8_fadeViolet();
+		deviating += frameDeviates();
+	}
+	for (int n = 0; n <= SWEEP_STEPS; n++) {
+		RAM.gameTime = -0.1F + (float32) n * 1e-5F;
+		model_LedController_stm32f334r8_indicateGameTime();
+		deviating += frameDeviates();
+	}
+	printf("frames:            %d fade and %d game time frames, %u deviating\n", FADE_STEPS, SWEEP_STEPS + 1,
+			deviating);
+	return deviating != 0;
+}
+
+static int checkGamma(void) {
+	int wrong = 0;
+	for (int i = 0; i < 256; i++) {
+		wrong += (NeoPixel_Gamma[i] != gammaFormula((uint8_t) i));
+	}
+	printf("NeoPixel_Gamma:    256 entries, %d wrong\n", wrong);
+	return wrong != 0;
+}
+
+static void timing(uint32_t steps) {
+	uint32_t frame[NUM_LEDS];
+	double t[3];
+	uint64_t c[3];
+	volatile uint32_t sink;
+
+	RAM.gameTime = 0.5F;
+	model_LedController_stm32f334r8_indicateGameTime();
+
+	t[0] = now_s();
+	c[0] = cycles();
+	for (uint32_t n = 0; n < steps; n++) {
+		RAM.ledRing[n % NUM_LEDS].green = (uint8) n;
+		packFormula(RAM.ledRing, frame);
+	}
+	c[1] = cycles();
+	t[1] = now_s();
+	for (uint32_t n = 0; n < steps; n++) {
+		RAM.ledRing[n % NUM_LEDS].green = (uint8) n;
+		packTable(RAM.ledRing, frame);
+	}
+	c[2] = cycles();
+	t[2] = now_s();
+	sink = frame[0];
+	(void) sink;
+
+	printf("%u frames of %d pixels\n", steps, NUM_LEDS);
+	printf("  formula %7.2f ns/frame, %7.1f TSC cycles/frame; table %6.2f ns/frame, %6.1f TSC cycles/frame (%.1fx)\n",
+			(t[1] - t[0]) * 1e9 / steps, (double) (c[1] - c[0]) / steps, (t[2] - t[1]) * 1e9 / steps,
+			(double) (c[2] - c[1]) / steps, (t[1] - t[0]) / (t[2] - t[1]));
+}
+
+int main(int argc, char *argv[]) {
+	uint32_t steps = 10000000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:c")) != -1) {
+		switch (opt) {
+		case 's':
+			steps = (uint32_t) atol(optarg);
+			break;
+		case 'c':
+			steps = 100000;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s steps] [-c]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (steps < 1) {
+		fprintf(stderr, "steps must be at least 1\n");
+		return 2;
+	}
+
+	ASD_DT_SCALED = DT_S;
+	int failed = checkFrames();
+	failed |= checkGamma();
+	timing(steps);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+/**
+ * Timing model of the ping-pong streaming of NeoPixel frames.
+ *
+ * Runs the encoder of Core/Src/neopixel.h against a cycle model of the
+ * circular TIM3 DMA of the LED ring: the DMA loads one compare value per PWM
+ * period (TIM3 ARR + 1 CPU cycles at 64 MHz, 831 kHz, a bit faster than the
+ * 800 kHz of the WS2812), and after the last value of a half it raises the
+ * half transfer or transfer complete interrupt. The interrupt starts after
+ * the entry latency and after any other interrupt of the same priority that
+ * runs at that moment (the interrupts of the firmware but TIM6 have priority 0,
+ * so that is the worst case for blocking), and the refill of the half is taken
+ * as done only at its end. If the DMA loads a value of a half whose refill
+ * has not completed, the ring would get a stale bit: an underrun.
+ *
+ * The cycles of the interrupt are an estimate for the target:
+ * HAL_DMA_IRQHandler() and the TIM callback chain about 150 cycles, the
+ * refill about 60 and HAL_TIM_PWM_Stop_DMA() at the end of the frame about
+ * 150; 400 by default leaves margin. The deadline is the 24 bit periods of the
+ * other half, about 1900 cycles.
+ *
+ * The values the DMA loads are decoded again and compared with the frame of
+ * random colors.
+ *
+ * usage: neopixel_stream_bench [-n pixels] [-i isr_cycles] [-b blocking_cycles] [-c]
+ *
+ *   -n  pixels of the frame (default 300)
+ *   -i  cycles of the interrupt including the refill (default 400)
+ *   -b  longest other interrupt that may delay it (default 640, 10 us)
+ *   -c  self-check run: 12, 300 and 1000 pixels, then an interrupt too slow
+ *       for the deadline, which the model has to report
+ *
+ * Exits with 1 if a frame underruns or decodes wrongly with the given costs,
+ * or if the too slow interrupt of the self-check does not underrun.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "neopixel.h"
+
+#define CORE_HZ				64000000
+#define PERIOD_CYCLES		77			// TIM3 ARR + 1, see MX_TIM3_Init()
+#define ENTRY_CYCLES		12			// exception entry of the Cortex-M4
+#define HALF_LENGTH			(NEOPIXEL_STREAM_DMA_LENGTH / 2)
+
+typedef struct {
+	uint32_t pixels;
+	uint32_t isrCycles;
+	uint32_t blockingCycles;
+} Costs_t;
+
+typedef struct {
+	uint32_t underruns;			// values loaded from a half before its refill completed
+	uint32_t wrongPixels;
+	uint32_t interrupts;
+	int64_t minSlack;			// cycles between the end of a refill and its deadline
+	uint64_t frame;				// cycles from the start until the DMA stops
+	double refill_ns;			// host time of NeoPixel_StreamRefill()
+} Result_t;
+
+typedef struct {
+	uint8_t pending;
+	uint64_t end;				// cycle the interrupt has refilled the half
+	uint64_t deadline;			// cycle the DMA loads the first value of the half again
+} Refill_t;
+
+static uint32_t random_state = 1;
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void randomFrame(uint32_t *grb, uint32_t pixels) {
+	for (uint32_t i = 0; i < pixels; i++) {
+		random_state = random_state * 1664525U + 1013904223U;
+		grb[i] = random_state >> 8;
+	}
+}
+
+static Result_t stream(const uint32_t *grb, const Costs_t *costs, uint8_t *loaded, uint32_t maxLoads) {
+	NeoPixel_Stream_t ring;
+	Refill_t refill[NEOPIXEL_STREAM_HALVES] = { { 0 } };
+	Result_t result = { .minSlack = INT64_MAX };
+	uint64_t isrFree = 0;		// end of the interrupt running last
+	uint64_t stop = UINT64_MAX;
+	uint32_t loads = 0;
+	double refillTime = 0.0;
+
+	NeoPixel_StreamStart(&ring, grb, (uint16_t) costs->pixels);
+
+	for (uint32_t n = 0; n < maxLoads; n++) {
+		uint64_t t = (uint64_t) n * PERIOD_CYCLES;
+		uint16_t i = n % NEOPIXEL_STREAM_DMA_LENGTH;
+		uint8_t half = i / HALF_LENGTH;
+
+		// refills that completed before this load, in the order of their interrupts
+		for (uint8_t k = 0; k < NEOPIXEL_STREAM_HALVES; k++) {
+			uint8_t h = (half + 1 + k) % NEOPIXEL_STREAM_HALVES;
+			if (refill[h].pending && (refill[h].end <= t)) {
+				refill[h].pending = 0;
+				double t0 = now_s();
+				uint8_t done = NeoPixel_StreamRefill(&ring, h);
+				refillTime += now_s() - t0;
+				if (done && (stop == UINT64_MAX)) {
+					stop = refill[h].end;
+				}
+			}
+		}
+		if (t >= stop) {
+			break;
+		}
+		if (refill[half].pending) {
+			result.underruns++;
+		}
+		loaded[loads++] = ((const uint8_t *) ring.buffer)[i];
+
+		if ((i % HALF_LENGTH) == HALF_LENGTH - 1) {
+			uint64_t start = t + ENTRY_CYCLES + costs->blockingCycles;
+			start = (start > isrFree) ? start : isrFree;
+			refill[half].pending = 1;
+			refill[half].end = start + costs->isrCycles;
+			refill[half].deadline = t + (uint64_t) (HALF_LENGTH + 1) * PERIOD_CYCLES;
+			int64_t slack = (int64_t) refill[half].deadline - (int64_t) refill[half].end;
+			result.minSlack = (slack < result.minSlack) ? slack : result.minSlack;
+			isrFree = refill[half].end;
+			result.interrupts++;
+		}
+	}
+	result.frame = (stop != UINT64_MAX) ? stop : (uint64_t) maxLoads * PERIOD_CYCLES;
+	result.refill_ns = (result.interrupts > 0) ? refillTime * 1e9 / result.interrupts : 0.0;
+
+	// the bits on the line: every value but 0 is a period of the frame, 0 is low
+	uint32_t bits = 0;
+	uint32_t color = 0;
+	for (uint32_t n = 0; n < loads; n++) {
+		if (loaded[n] == 0) {
+			continue;
+		}
+		color = (color << 1) | (loaded[n] == NEOPIXEL_ONE);
+		if (++bits % 24 == 0) {
+			uint32_t pixel = bits / 24 - 1;
+			if ((pixel >= costs->pixels) || ((color & 0xFFFFFF) != grb[pixel])) {
+				result.wrongPixels++;
+			}
+			color = 0;
+		}
+	}
+	if (bits < costs->pixels * 24) {
+		result.wrongPixels += costs->pixels - bits / 24;
+	}
+	return result;
+}
+
+static int run(const Costs_t *costs, int expectUnderrun) {
+	uint32_t *grb = malloc(costs->pixels * sizeof(uint32_t));
+	uint32_t maxLoads = (costs->pixels + 4) * 24 + 4 * NEOPIXEL_STREAM_DMA_LENGTH;
+	uint8_t *loaded = malloc(maxLoads);
+	if ((grb == NULL) || (loaded == NULL)) {
+		exit(2);
+	}
+	randomFrame(grb, costs->pixels);
+	Result_t result = stream(grb, costs, loaded, maxLoads);
+
+	double cycle_us = 1e6 / CORE_HZ;
+	printf("%5u pixels, interrupt %u + blocking %u cycles: frame %.1f us, %u interrupts, slack %lld cycles, "
+			"%u underruns, %u wrong pixels, load %.1f%%, refill %.0f ns on the host\n",
+			costs->pixels, costs->isrCycles, costs->blockingCycles, result.frame * cycle_us, result.interrupts,
+			(long long) result.minSlack, result.underruns, result.wrongPixels,
+			100.0 * costs->isrCycles / (HALF_LENGTH * PERIOD_CYCLES), result.refill_ns);
+	free(grb);
+	free(loaded);
+
+	if (expectUnderrun) {
+		return (result.underruns == 0);
+	}
+	return (result.underruns != 0) || (result.wrongPixels != 0) || (result.minSlack < 0);
+}
+
+int main(int argc, char *argv[]) {
+	Costs_t costs = { .pixels = 300, .isrCycles = 400, .blockingCycles = 640 };
+	int check = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:i:b:c")) != -1) {
+		switch (opt) {
+		case 'n':
+			costs.pixels = (uint32_t) atoi(optarg);
+			break;
+		case 'i':
+			costs.isrCycles = (uint32_t) atoi(optarg);
+			break;
+		case 'b':
+			costs.blockingCycles = (uint32_t) atoi(optarg);
+			break;
+		case 'c':
+			check = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n pixels] [-i isr_cycles] [-b blocking_cycles] [-c]\n", argv[0]);
+			return 2;
+		}
+	}
+	if ((costs.pixels < 1) || (costs.pixels > 65535)) {
+		fprintf(stderr, "pixels must be 1..65535\n");
+		return 2;
+	}
+
+	uint32_t deadline = (HALF_LENGTH + 1) * PERIOD_CYCLES;
+	printf("bit period %u cycles (%.0f kHz), deadline of a refill %u cycles (%.1f us), ping-pong buffer %zu bytes\n",
+			PERIOD_CYCLES, CORE_HZ / 1e3 / PERIOD_CYCLES, deadline, deadline * 1e6 / CORE_HZ,
+			sizeof(((NeoPixel_Stream_t *) 0)->buffer));
+	printf("interrupt plus blocking may take up to %u cycles\n", deadline - ENTRY_CYCLES);
+
+	int failed = 0;
+	if (check) {
+		static const uint32_t pixels[] = { 12, 300, 1000 };
+		for (size_t i = 0; i < sizeof(pixels) / sizeof(pixels[0]); i++) {
+			costs.pixels = pixels[i];
+			failed |= run(&costs, 0);
+		}
+		Costs_t slow = { .pixels = 300, .isrCycles = deadline, .blockingCycles = 0 };
+		printf("too slow for the deadline:\n");
+		failed |= run(&slow, 1);
+	} else {
+		failed |= run(&costs, 0);
+	}
+	return failed ? 1 : 0;
+}
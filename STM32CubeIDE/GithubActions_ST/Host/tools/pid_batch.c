@@ -0,0 +1,182 @@
+/**
+ * Equivalence check and benchmark of the batch PID evaluator.
+ *
+ * Feeds the same pseudo-random ball positions to the generated
+ * model_ServoController_Automatic_autoMode() (one candidate after the other,
+ * gains written to the calibration working page) and to the batch evaluator,
+ * compares the servo positions of every step and the final controller states
+ * bit by bit and reports the throughput of both.
+ *
+ * usage: pid_batch [-n candidates] [-s steps] [-c]
+ *
+ *   -c   short self-check run
+ *
+ * Exits with 1 if a candidate differs from the generated code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sil_mem.h"
+#include "sil_pid_batch.h"
+#include "model_ServoController_Automatic.h"
+#include "esdl_deltaTimeDefs.h"
+
+typedef struct {
+	float kp;
+	float ki;
+	float kd;
+} Gains_t;
+
+static uint32_t random_state = 1;
+
+static float randomUniform(float min, float max) {
+	random_state = random_state * 1664525U + 1013904223U;
+	return min + (max - min) * (float) (random_state >> 8) / (float) (1U << 24);
+}
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// runs all candidates through the generated code, returns the servo positions [step][candidate]
+static void runGenerated(const Gains_t *gains, int count, const float *inputs, int steps, float *servo) {
+	for (int i = 0; i < count; i++) {
+		SilMem_WriteCharacteristic(&esdl_servoController_model_MainClass_CAL_MEM.kp, &gains[i].kp, sizeof(float32));
+		SilMem_WriteCharacteristic(&esdl_servoController_model_MainClass_CAL_MEM.ki, &gains[i].ki, sizeof(float32));
+		SilMem_WriteCharacteristic(&esdl_servoController_model_MainClass_CAL_MEM.kd, &gains[i].kd, sizeof(float32));
+		esdl_servoController_model_MainClass_RAM.error = 0.0F;
+		esdl_servoController_model_MainClass_RAM.integral = 0.0F;
+		esdl_servoController_model_MainClass_RAM.lastValue = 0.0F;
+		esdl_servoController_model_MainClass_RAM.servoPosition = 0.0F;
+		esdl_servoController_model_MainClass_RAM.doIntegrate = true;
+
+		for (int s = 0; s < steps; s++) {
+			esdl_servoController_model_MainClass_RAM.ballPosition = inputs[s * count + i];
+			model_ServoController_Automatic_autoMode();
+			servo[s * count + i] = esdl_servoController_model_MainClass_RAM.servoPosition;
+		}
+	}
+}
+
+static void runBatch(SilPidBatch_t *batch, int simd, const float *inputs, int steps, float *servo) {
+	SilPidBatch_Reset(batch);
+	for (int s = 0; s < steps; s++) {
+		if (simd) {
+			SilPidBatch_Step(batch, &inputs[s * batch->count], ASD_DT_SCALED);
+		} else {
+			SilPidBatch_StepScalar(batch, &inputs[s * batch->count], ASD_DT_SCALED);
+		}
+		memcpy(&servo[s * batch->count], batch->servoPosition, batch->count * sizeof(float));
+	}
+}
+
+// compares the final state of candidate i with the generated code (which holds the last candidate)
+static int isStateEqual(const SilPidBatch_t *batch, int i) {
+	return (memcmp(&batch->error[i], &esdl_servoController_model_MainClass_RAM.error, sizeof(float)) == 0)
+			&& (memcmp(&batch->integral[i], &esdl_servoController_model_MainClass_RAM.integral, sizeof(float)) == 0)
+			&& (memcmp(&batch->lastValue[i], &esdl_servoController_model_MainClass_RAM.lastValue, sizeof(float)) == 0)
+			&& ((batch->doIntegrate[i] != 0) == (esdl_servoController_model_MainClass_RAM.doIntegrate != 0));
+}
+
+static int compare(const char *name, const float *reference, const float *servo, int count, int steps) {
+	int errors = 0;
+	for (int i = 0; i < count; i++) {
+		for (int s = 0; s < steps; s++) {
+			if (memcmp(&reference[s * count + i], &servo[s * count + i], sizeof(float)) != 0) {
+				if (errors < 5) {
+					printf("%s: candidate %d differs in step %d: %.9g != %.9g\n", name, i, s,
+							reference[s * count + i], servo[s * count + i]);
+				}
+				errors++;
+				break;
+			}
+		}
+	}
+	return errors;
+}
+
+static int checkAndMeasure(int count, int steps, float dT) {
+	Gains_t *gains = malloc(count * sizeof(Gains_t));
+	float *inputs = malloc((size_t) steps * count * sizeof(float));
+	float *reference = calloc((size_t) steps * count, sizeof(float));
+	float *servo = calloc((size_t) steps * count, sizeof(float));
+	SilPidBatch_t *batch = SilPidBatch_Create(count);
+	int errors = 0;
+
+	for (int i = 0; i < count; i++) {
+		gains[i].kp = randomUniform(0.0F, 1.0F);
+		gains[i].ki = randomUniform(0.0F, 1.0F);
+		gains[i].kd = randomUniform(0.0F, 1.0F);
+		SilPidBatch_SetGains(batch, i, gains[i].kp, gains[i].ki, gains[i].kd);
+	}
+	for (int k = 0; k < steps * count; k++) {
+		inputs[k] = randomUniform(0.0F, 1.0F);
+	}
+	ASD_DT_SCALED = dT;
+
+	double t0 = now_s();
+	runGenerated(gains, count, inputs, steps, reference);
+	double t1 = now_s();
+	runBatch(batch, 0, inputs, steps, servo);
+	double t2 = now_s();
+	errors += compare("scalar batch", reference, servo, count, steps);
+	errors += !isStateEqual(batch, count - 1);
+	double t3 = now_s();
+	runBatch(batch, 1, inputs, steps, servo);
+	double t4 = now_s();
+	errors += compare("SIMD batch", reference, servo, count, steps);
+	errors += !isStateEqual(batch, count - 1);
+
+	double evaluations = (double) count * steps;
+	printf("dT = %g s, %d candidates x %d steps\n", dT, count, steps);
+	printf("  generated code:  %12.0f steps/s\n", evaluations / (t1 - t0));
+	printf("  scalar batch:    %12.0f steps/s (%.1fx)\n", evaluations / (t2 - t1), (t1 - t0) / (t2 - t1));
+	printf("  %s batch:      %12.0f steps/s (%.1fx)\n", SilPidBatch_HasAvx2() ? "AVX2" : "SIMD",
+			evaluations / (t4 - t3), (t1 - t0) / (t4 - t3));
+	printf("  %s\n", (errors == 0) ? "bit-identical" : "MISMATCH");
+
+	SilPidBatch_Destroy(batch);
+	free(servo);
+	free(reference);
+	free(inputs);
+	free(gains);
+	return errors;
+}
+
+int main(int argc, char *argv[]) {
+	int count = 4096;
+	int steps = 1000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:c")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 's':
+			steps = atoi(optarg);
+			break;
+		case 'c':
+			count = 1027;	// not a multiple of the SIMD width
+			steps = 200;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n candidates] [-s steps] [-c]\n", argv[0]);
+			return 2;
+		}
+	}
+	if ((count < 1) || (steps < 1)) {
+		return 2;
+	}
+
+	SilMem_Initialize();
+
+	int errors = checkAndMeasure(count, steps, 1.0e-6 * 5000);	// see Task_5ms
+	errors += checkAndMeasure(count, steps / 10 + 1, 0.0F);
+	return (errors > 0) ? 1 : 0;
+}
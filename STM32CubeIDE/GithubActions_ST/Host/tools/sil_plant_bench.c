@@ -0,0 +1,73 @@
+/**
+ * Speed of the physical plant model alone.
+ *
+ * Simulates the plant in 5 ms steps with a servo sweeping slowly around the
+ * level position and reports how much faster than real time it runs.
+ *
+ * usage: sil_plant_bench [-t seconds] [-c]
+ *
+ *   -c   short self-check run
+ *
+ * Exits with 1 if the plant runs less than 1000 times faster than real time.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "sil.h"
+#include "sil_plant.h"
+
+#define MIN_SPEED_FACTOR	1000.0
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+	double duration_s = 3600.0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:c")) != -1) {
+		switch (opt) {
+		case 't':
+			duration_s = atof(optarg);
+			break;
+		case 'c':
+			duration_s = 600.0;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t seconds] [-c]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	SilPlant_Params_t params;
+	SilPlant_t plant;
+	SilPlant_GetDefaultParams(&params);
+	SilPlant_Init(&plant, &params, 0.5, 1);
+
+	const double dt_s = SIL_STEP_MS * 1e-3;
+	long steps = (long) (duration_s / dt_s);
+	uint32_t rangeSum = 0;
+
+	double start = now_s();
+	for (long n = 0; n < steps; n++) {
+		double pulse_us = 1750.0 + 100.0 * sin(2.0 * M_PI * 0.2 * n * dt_s);
+		SilPlant_Step(&plant, pulse_us, dt_s);
+		rangeSum += SilPlant_GetRangeMm(&plant);
+	}
+	double elapsed = now_s() - start;
+	double speed = duration_s / elapsed;
+
+	printf("%.0f s simulated (%d RK4 sub-steps per %d ms) in %.3f s: %.0fx real time (range checksum %u)\n",
+			duration_s, params.subSteps, SIL_STEP_MS, elapsed, speed, rangeSum);
+	if (speed < MIN_SPEED_FACTOR) {
+		printf("FAILED: plant is slower than %.0fx real time\n", MIN_SPEED_FACTOR);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,266 @@
+/**
+ * Recording and replay of input traces (see Core/Src/input_trace.h).
+ *
+ * Recording plays one game in closed loop like balancetube_sil and stores
+ * the inputs the firmware consumed in every step. Replay maps one or more
+ * traces (from the SIL or recorded on the board) and runs each of them open
+ * loop on its own SIL instance, as fast as the model steps and in parallel on
+ * the thread pool: every record provides the inputs of one step, gaps in the
+ * time stamps are bridged by repeating the previous inputs.
+ *
+ * usage: sil_replay -r file [-t seconds] [-s]
+ *        sil_replay [-j workers] file...
+ *        sil_replay -c
+ *
+ *   -s   use the kinematic ball model of simulation/Stimulator.esdl
+ *   -c   self-check: record a game, replay it and compare the final state
+ *        bit by bit with the recording run
+ *
+ * Exits with 1 on file errors or if the self-check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sil.h"
+#include "sil_instance.h"
+#include "sil_pool.h"
+#include "sil_scenario.h"
+#include "sil_trace.h"
+
+typedef struct {
+	const char *path;
+	SilTrace_t trace;
+	int error;
+	// replay state
+	uint32_t base_ms;			// time stamp of the trace at simulated time 0
+	size_t next;				// next record
+	size_t gapSteps;			// steps without record, inputs held
+	uint32_t steps;
+	double elapsed_s;
+	Sil_Signals_t signals;
+	Sil_Outputs_t outputs;
+	uint32_t time_ms;
+} Replay_t;
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int record(const char *path, double duration_s, int stimulator, Sil_Signals_t *signals,
+		Sil_Outputs_t *outputs) {
+	SilTrace_Writer_t *writer = SilTrace_CreateWriter(path, SIL_STEP_MS);
+	if (writer == NULL) {
+		return -1;
+	}
+	Sil_Inputs_t inputs = { 0 };
+	SilScenario_t scenario;
+	uint32_t steps = (uint32_t) (duration_s * 1000.0 / SIL_STEP_MS);
+	int ok = 1;
+
+	SilScenario_Init(&scenario, 500, 1000);
+	if (stimulator) {
+		SilScenario_UseStimulator(&scenario);
+	}
+	Sil_Initialize();
+	for (uint32_t n = 0; n < steps; n++) {
+		InputTrace_Record_t consumed;
+
+		SilScenario_Hook(&inputs, Sil_GetOutputs(), Sil_GetTimeMs(), &scenario);
+		Sil_SetInputs(&inputs);
+		Sil_Step();
+		Sil_GetInputRecord(&consumed);
+		ok &= SilTrace_Write(writer, &consumed);
+	}
+	ok &= SilTrace_CloseWriter(writer);
+	Sil_GetSignals(signals);
+	*outputs = *Sil_GetOutputs();
+
+	printf("recorded %u steps (%.1f s) to %s\n", steps, steps * SIL_STEP_MS / 1000.0, path);
+	return ok ? 0 : -1;
+}
+
+// feeds the record that is due in the upcoming step, holds the inputs otherwise
+static void replayHook(Sil_Inputs_t *inputs, const Sil_Outputs_t *outputs, uint32_t time_ms, void *user) {
+	Replay_t *replay = user;
+
+	if (replay->next < replay->trace.count) {
+		const InputTrace_Record_t *rec = &replay->trace.records[replay->next];
+		if ((int32_t) (rec->time_ms - replay->base_ms - time_ms) <= SIL_STEP_MS) {
+			SilTrace_ToInputs(rec, inputs);
+			replay->next++;
+			return;
+		}
+	}
+	replay->gapSteps++;
+}
+
+static void replayTask(int worker, int task, void *arg) {
+	Replay_t *replay = &((Replay_t *) arg)[task];
+	const SilTrace_t *trace = &replay->trace;
+
+	if (replay->error || (trace->count == 0)) {
+		return;
+	}
+	Sil_Instance_t *instance = Sil_InstanceCreate(worker);
+	if (instance == NULL) {
+		replay->error = 1;
+		return;
+	}
+	// the first record belongs to the first step, which ends at SIL_STEP_MS
+	replay->base_ms = trace->records[0].time_ms - SIL_STEP_MS;
+	replay->steps = (trace->records[trace->count - 1].time_ms - replay->base_ms) / SIL_STEP_MS;
+	if (replay->steps < trace->count) {
+		replay->steps = trace->count;	// time stamps not increasing
+	}
+
+	double start = now_s();
+	Sil_InstanceRun(instance, replay->steps, replayHook, replay);
+	replay->elapsed_s = now_s() - start;
+
+	replay->signals = *Sil_InstanceGetSignals(instance);
+	replay->outputs = *Sil_InstanceGetOutputs(instance);
+	replay->time_ms = Sil_InstanceGetTimeMs(instance);
+	Sil_InstanceDestroy(instance);
+}
+
+// raw streaming speed of the mapped records, for comparison with the replay
+static double scanRate(const SilTrace_t *trace, uint32_t *checksum) {
+	uint32_t sum = 0;
+	double start = now_s();
+	for (size_t i = 0; i < trace->count; i++) {
+		const InputTrace_Record_t *rec = &trace->records[i];
+		sum += rec->time_ms + rec->adcHandPosition + rec->ballDistanceMm + rec->buttons;
+	}
+	double elapsed = now_s() - start;
+	*checksum = sum;
+	return (elapsed > 0.0) ? trace->count * sizeof(InputTrace_Record_t) / elapsed : 0.0;
+}
+
+static int play(Replay_t *replays, int count, int workers) {
+	int errors = 0;
+
+	for (int k = 0; k < count; k++) {
+		replays[k].error = (SilTrace_Open(&replays[k].trace, replays[k].path) != 0);
+	}
+
+	Sil_Pool_t *pool = Sil_PoolCreate(workers);
+	double start = now_s();
+	Sil_PoolRunTasks(pool, count, replayTask, replays);
+	double elapsed = now_s() - start;
+	Sil_PoolDestroy(pool);
+
+	uint64_t totalSteps = 0;
+	for (int k = 0; k < count; k++) {
+		Replay_t *replay = &replays[k];
+		if (replay->error) {
+			errors++;
+			continue;
+		}
+		uint32_t checksum;
+		double bytesPerSecond = scanRate(&replay->trace, &checksum);
+		double rate = (replay->elapsed_s > 0.0) ? replay->steps / replay->elapsed_s : 0.0;
+		printf("%s: %zu records (%.1f MB, checksum %08x, scan %.0f MB/s), %u steps (%zu bridged),"
+				" %.0f steps/s, %.0fx real time, score %.1f s\n",
+				replay->path, replay->trace.count, replay->trace.mapSize / 1e6, checksum, bytesPerSecond / 1e6,
+				replay->steps, replay->gapSteps, rate, rate * SIL_STEP_MS / 1000.0, replay->signals.score);
+		totalSteps += replay->steps;
+		SilTrace_Close(&replay->trace);
+	}
+	if (count > 1) {
+		printf("%d traces, %d workers: %.3f s, %.0f steps/s\n", count, workers, elapsed, totalSteps / elapsed);
+	}
+	return errors;
+}
+
+static int selfCheck(void) {
+	char path[] = "/tmp/sil_replay_XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return 1;
+	}
+	close(fd);
+
+	Sil_Signals_t signals;
+	Sil_Outputs_t outputs;
+	Replay_t replay = { .path = path };
+	int errors = 0;
+
+	if ((record(path, 60.0, 0, &signals, &outputs) != 0) || (play(&replay, 1, 1) != 0)) {
+		errors++;
+	} else {
+		errors += (replay.gapSteps > 0) || (replay.time_ms != Sil_GetTimeMs());
+		errors += memcmp(&signals, &replay.signals, sizeof(signals)) != 0;
+		errors += outputs.servoCompare != replay.outputs.servoCompare;
+		errors += memcmp(outputs.ledRing, replay.outputs.ledRing, sizeof(outputs.ledRing)) != 0;
+		errors += memcmp(outputs.displayRam, replay.outputs.displayRam, sizeof(outputs.displayRam)) != 0;
+	}
+	unlink(path);
+
+	printf("%s\n", (errors == 0) ? "replay identical to recording" : "FAILED: replay differs from recording");
+	return (errors == 0) ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+	const char *recordPath = NULL;
+	double duration_s = 125.0;
+	int stimulator = 0;
+	int workers = Sil_GetProcessorCount();
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:t:j:sc")) != -1) {
+		switch (opt) {
+		case 'r':
+			recordPath = optarg;
+			break;
+		case 't':
+			duration_s = atof(optarg);
+			break;
+		case 'j':
+			workers = atoi(optarg);
+			break;
+		case 's':
+			stimulator = 1;
+			break;
+		case 'c':
+			return selfCheck();
+		default:
+			fprintf(stderr, "usage: %s -r file [-t seconds] [-s]\n"
+					"       %s [-j workers] file...\n"
+					"       %s -c\n", argv[0], argv[0], argv[0]);
+			return 2;
+		}
+	}
+
+	if (recordPath != NULL) {
+		Sil_Signals_t signals;
+		Sil_Outputs_t outputs;
+		return (record(recordPath, duration_s, stimulator, &signals, &outputs) == 0) ? 0 : 1;
+	}
+
+	int count = argc - optind;
+	if (count < 1) {
+		fprintf(stderr, "no trace file given\n");
+		return 2;
+	}
+	if (workers > Sil_GetImageCount()) {
+		workers = Sil_GetImageCount();
+	}
+	if (workers > count) {
+		workers = count;
+	}
+	if (workers < 1) {
+		return 2;
+	}
+	Replay_t *replays = calloc(count, sizeof(Replay_t));
+	for (int k = 0; k < count; k++) {
+		replays[k].path = argv[optind + k];
+	}
+	int errors = play(replays, count, workers);
+	free(replays);
+	return (errors > 0) ? 1 : 0;
+}
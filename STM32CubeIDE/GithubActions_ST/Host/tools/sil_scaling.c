@@ -0,0 +1,170 @@
+/**
+ * Scaling benchmark of the multi-instance SIL.
+ *
+ * Runs a number of independent Balance Tubes (instances) per worker thread,
+ * each playing one game with its own stimulus, for 1, 2, 4, ... workers and
+ * reports the step throughput and the speed-up relative to one worker. Every
+ * instance is compared bit by bit with a reference run of the same game on a
+ * single instance, so any state shared between instances shows up as an
+ * error.
+ *
+ * usage: sil_scaling [-w max workers] [-i instances per worker] [-t seconds] [-c]
+ *
+ *   -c   short self-check run that uses up to 4 workers regardless of the
+ *        number of processors
+ *
+ * Exits with 1 if an instance differs from its reference run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sil_instance.h"
+#include "sil_pool.h"
+#include "sil_scenario.h"
+
+typedef struct {
+	Sil_Instance_t **instances;
+	SilScenario_t *scenarios;
+	int numInstances;
+	uint32_t steps;
+} Job_t;
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// every instance gets a slightly different game
+static void initScenario(SilScenario_t *scenario, int k) {
+	SilScenario_Init(scenario, 500 + 5 * (k % 16), 1000 + 35 * (k % 7));
+}
+
+// worker w runs all instances of image w
+static void runJob(int worker, void *arg) {
+	Job_t *job = arg;
+
+	for (int k = 0; k < job->numInstances; k++) {
+		if (Sil_InstanceGetImage(job->instances[k]) == worker) {
+			Sil_InstanceRun(job->instances[k], job->steps, SilScenario_Hook, &job->scenarios[k]);
+		}
+	}
+}
+
+static int isEqual(const Sil_Instance_t *a, const Sil_Instance_t *b) {
+	const Sil_Signals_t *sa = Sil_InstanceGetSignals(a);
+	const Sil_Signals_t *sb = Sil_InstanceGetSignals(b);
+	const Sil_Outputs_t *oa = Sil_InstanceGetOutputs(a);
+	const Sil_Outputs_t *ob = Sil_InstanceGetOutputs(b);
+
+	return (memcmp(&sa->score, &sb->score, sizeof(float)) == 0)
+			&& (memcmp(&sa->ballPosition, &sb->ballPosition, sizeof(float)) == 0)
+			&& (memcmp(&sa->servoPosition, &sb->servoPosition, sizeof(float)) == 0)
+			&& (oa->servoCompare == ob->servoCompare)
+			&& (memcmp(oa->ledRing, ob->ledRing, sizeof(oa->ledRing)) == 0)
+			&& (memcmp(oa->displayRam, ob->displayRam, sizeof(oa->displayRam)) == 0)
+			&& (Sil_InstanceGetTimeMs(a) == Sil_InstanceGetTimeMs(b));
+}
+
+int main(int argc, char *argv[]) {
+	int maxWorkers = Sil_GetProcessorCount();
+	int perWorker = 4;
+	double duration_s = 30.0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "w:i:t:c")) != -1) {
+		switch (opt) {
+		case 'w':
+			maxWorkers = atoi(optarg);
+			break;
+		case 'i':
+			perWorker = atoi(optarg);
+			break;
+		case 't':
+			duration_s = atof(optarg);
+			break;
+		case 'c':
+			maxWorkers = 4;
+			duration_s = 5.0;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-w max workers] [-i instances per worker] [-t seconds] [-c]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (maxWorkers > Sil_GetImageCount()) {
+		maxWorkers = Sil_GetImageCount();
+	}
+	if ((maxWorkers < 1) || (perWorker < 1)) {
+		return 2;
+	}
+
+	uint32_t steps = (uint32_t) (duration_s * 1000.0 / SIL_STEP_MS);
+	int maxInstances = maxWorkers * perWorker;
+
+	// reference: every game alone on one instance
+	Sil_Instance_t **reference = calloc(maxInstances, sizeof(Sil_Instance_t *));
+	for (int k = 0; k < maxInstances; k++) {
+		SilScenario_t scenario;
+		initScenario(&scenario, k);
+		reference[k] = Sil_InstanceCreate(0);
+		Sil_InstanceRun(reference[k], steps, SilScenario_Hook, &scenario);
+	}
+
+	printf("images: %d, processors: %d, %.1f s simulated per instance\n",
+			Sil_GetImageCount(), Sil_GetProcessorCount(), duration_s);
+	printf("%8s %10s %14s %10s %10s %9s\n", "workers", "instances", "steps/s", "speed-up", "efficiency", "identical");
+
+	int errors = 0;
+	double baseRate = 0.0;
+	for (int workers = 1;; workers = (workers * 2 < maxWorkers) ? workers * 2 : maxWorkers) {
+		Job_t job;
+		job.numInstances = workers * perWorker;
+		job.steps = steps;
+		job.instances = calloc(job.numInstances, sizeof(Sil_Instance_t *));
+		job.scenarios = calloc(job.numInstances, sizeof(SilScenario_t));
+		for (int k = 0; k < job.numInstances; k++) {
+			job.instances[k] = Sil_InstanceCreate(k % workers);
+			initScenario(&job.scenarios[k], k);
+		}
+
+		Sil_Pool_t *pool = Sil_PoolCreate(workers);
+		double start = now_s();
+		Sil_PoolRun(pool, runJob, &job);
+		double elapsed = now_s() - start;
+		Sil_PoolDestroy(pool);
+
+		int identical = 0;
+		for (int k = 0; k < job.numInstances; k++) {
+			identical += isEqual(job.instances[k], reference[k]);
+			Sil_InstanceDestroy(job.instances[k]);
+		}
+		errors += job.numInstances - identical;
+
+		double rate = (double) job.numInstances * steps / elapsed;
+		if (workers == 1) {
+			baseRate = rate;
+		}
+		printf("%8d %10d %14.0f %9.2fx %9.0f%% %4d/%-4d\n", workers, job.numInstances, rate,
+				rate / baseRate, 100.0 * rate / baseRate / workers, identical, job.numInstances);
+
+		free(job.instances);
+		free(job.scenarios);
+		if (workers == maxWorkers) {
+			break;
+		}
+	}
+
+	for (int k = 0; k < maxInstances; k++) {
+		Sil_InstanceDestroy(reference[k]);
+	}
+	free(reference);
+
+	if (errors > 0) {
+		printf("FAILED: %d instances differ from their reference run\n", errors);
+	}
+	return (errors > 0) ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * Stimulus of one game for the SIL tools.
+ */
+
+#include "sil_scenario.h"
+
+#define BUTTON_PUSH_MS		100
+
+// ball distance of ReadBallPosition() for position 0, 0.5 and 1
+#define BALL_POS_START_MM	470.0F
+#define BALL_POS_MID_MM		300.0F
+#define BALL_POS_END_MM		60.0F
+
+#define HAND_ADC_MID		1400
+
+// see simulation/Stimulator.esdl
+static float calcBallPosition(SilScenario_t *scenario, float servoPosition) {
+	const float velocityCoefficient = 0.05F;
+	float x = velocityCoefficient * (servoPosition - 0.5F);
+	int rightEdge = (scenario->ballPosition > 0.9999F && x > 0.0F);
+	int leftEdge = (scenario->ballPosition < 0.0001F && x < 0.0F);
+
+	if (!(rightEdge || leftEdge)) {
+		float ballPosition = scenario->ballPosition + x;
+		ballPosition = (ballPosition < 1.0F) ? ballPosition : 1.0F;
+		ballPosition = (ballPosition > 0.0F) ? ballPosition : 0.0F;
+		scenario->ballPosition = ballPosition;
+	}
+	return scenario->ballPosition;
+}
+
+static uint16_t ballDistanceMm(float position) {
+	if (position <= 0.5F) {
+		return (uint16_t) (BALL_POS_START_MM + (position / 0.5F) * (BALL_POS_MID_MM - BALL_POS_START_MM) + 0.5F);
+	}
+	return (uint16_t) (BALL_POS_MID_MM + ((position - 0.5F) / 0.5F) * (BALL_POS_END_MM - BALL_POS_MID_MM) + 0.5F);
+}
+
+// inverse of ballDistanceMm()
+static float ballPosition(float distance_mm) {
+	float position;
+	if (distance_mm >= BALL_POS_MID_MM) {
+		position = 0.5F * (distance_mm - BALL_POS_START_MM) / (BALL_POS_MID_MM - BALL_POS_START_MM);
+	} else {
+		position = 0.5F + 0.5F * (distance_mm - BALL_POS_MID_MM) / (BALL_POS_END_MM - BALL_POS_MID_MM);
+	}
+	position = (position < 1.0F) ? position : 1.0F;
+	return (position > 0.0F) ? position : 0.0F;
+}
+
+static int isPushed(uint32_t time_ms, uint32_t push_ms) {
+	return (time_ms >= push_ms) && (time_ms < push_ms + BUTTON_PUSH_MS);
+}
+
+void SilScenario_Init(SilScenario_t *scenario, uint32_t startGame_ms, uint32_t autoMode_ms) {
+	scenario->startGame_ms = startGame_ms;
+	scenario->autoMode_ms = autoMode_ms;
+	scenario->adcHandPosition = HAND_ADC_MID;
+	scenario->useStimulator = 0;
+	scenario->ballPosition = 0.0F;
+
+	SilPlant_Params_t params;
+	SilPlant_GetDefaultParams(&params);
+	SilPlant_Init(&scenario->plant, &params, 0.0, 1);
+}
+
+void SilScenario_UseStimulator(SilScenario_t *scenario) {
+	scenario->useStimulator = 1;
+}
+
+void SilScenario_Hook(Sil_Inputs_t *inputs, const Sil_Outputs_t *outputs, uint32_t time_ms, void *user) {
+	SilScenario_t *scenario = user;
+	float servoPulse_us = outputs->servoCompare / 3.2F;
+
+	inputs->adcHandPosition = scenario->adcHandPosition;
+	inputs->startGameButton = isPushed(time_ms, scenario->startGame_ms);
+	inputs->autoModeButton = isPushed(time_ms, scenario->autoMode_ms);
+	if (scenario->useStimulator) {
+		float servoPosition = (servoPulse_us - 1600.0F) / 300.0F;
+		inputs->ballDistanceMm = ballDistanceMm(calcBallPosition(scenario, servoPosition));
+	} else {
+		SilPlant_Step(&scenario->plant, servoPulse_us, SIL_STEP_MS * 1e-3);
+		inputs->ballDistanceMm = SilPlant_GetRangeMm(&scenario->plant);
+	}
+}
+
+float SilScenario_GetBallPosition(const SilScenario_t *scenario) {
+	if (scenario->useStimulator) {
+		return scenario->ballPosition;
+	}
+	const SilPlant_t *plant = &scenario->plant;
+	return ballPosition((float) (plant->params.rangeFarEnd_mm - plant->position_m * 1000.0));
+}
@@ -0,0 +1,44 @@
+/**
+ * Stimulus of one game for the SIL tools: buttons, hand sensor and a ball
+ * driven by the servo output. The ball is simulated by the physical plant
+ * (sil_plant.h) or, for comparison, by the kinematic model of
+ * simulation/Stimulator.esdl.
+ */
+
+#ifndef HOST_SIL_SCENARIO_H_
+#define HOST_SIL_SCENARIO_H_
+
+#include "sil.h"
+#include "sil_plant.h"
+
+typedef struct {
+	uint32_t startGame_ms;		// push of the start button (BTN2)
+	uint32_t autoMode_ms;		// push of the mode button (BTN1)
+	uint16_t adcHandPosition;
+	int useStimulator;
+	float ballPosition;			// state of the Stimulator model
+	SilPlant_t plant;
+} SilScenario_t;
+
+/**
+ * Initializes the scenario with the physical plant (default parameters).
+ */
+void SilScenario_Init(SilScenario_t *scenario, uint32_t startGame_ms, uint32_t autoMode_ms);
+
+/**
+ * Switches to the kinematic model of simulation/Stimulator.esdl.
+ */
+void SilScenario_UseStimulator(SilScenario_t *scenario);
+
+/**
+ * Computes the inputs of the next step, matches Sil_StepHook_t.
+ */
+void SilScenario_Hook(Sil_Inputs_t *inputs, const Sil_Outputs_t *outputs, uint32_t time_ms, void *user);
+
+/**
+ * \return true ball position (without sensor noise) on the scale of
+ *         model_Signals_ballPosition, i.e. mapped like ReadBallPosition()
+ */
+float SilScenario_GetBallPosition(const SilScenario_t *scenario);
+
+#endif /* HOST_SIL_SCENARIO_H_ */
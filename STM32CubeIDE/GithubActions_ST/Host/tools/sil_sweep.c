@@ -0,0 +1,515 @@
+/**
+ * Parallel calibration sweep of the Balance Tube.
+ *
+ * Takes the calibration parameters from the A2L file of the project (data
+ * type, conversion, limits) and the mapping file (C access names), generates
+ * a full-factorial grid or a Latin hypercube sample over the requested
+ * ranges and plays one game per sample (see sil_scenario.c) on the
+ * multi-instance SIL. The runs are distributed over a work-stealing thread
+ * pool, one model image per worker. For every run the tool reports:
+ *
+ *   score       model_Signals_score at the end of the run
+ *   settling_s  time from switching to automatic mode until the true ball
+ *               position stays within 0.5 +/- band (empty if it never does)
+ *   overshoot   largest true ball position above 0.5 after the first
+ *               crossing of 0.5
+ *
+ * usage: sil_sweep [-a a2l] [-m mapping] [-p name[=min:max[:points]]]...
+ *                  [-n points] [-l samples] [-r seed] [-j workers]
+ *                  [-t seconds] [-b band] [-o results.csv] [-c]
+ *
+ *   -p   parameter to sweep, by A2L name or unique suffix (e.g. "kp");
+ *        the range defaults to 50 % .. 150 % of the reference value,
+ *        default parameters: kp, ki, kd
+ *   -n   grid points per parameter (default 5)
+ *   -l   Latin hypercube with the given number of samples instead of a grid
+ *   -c   short self-check: the same sweep with one and with several workers
+ *        must give bit-identical results
+ *
+ * The results are written as CSV (to stdout if -o is not given), the summary
+ * lines start with '#'.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sil_a2l.h"
+#include "sil_instance.h"
+#include "sil_pool.h"
+#include "sil_scenario.h"
+
+#ifndef SIL_SRC_GEN_DIR
+#define SIL_SRC_GEN_DIR		"../src-gen"
+#endif
+
+#define MAX_PARAMS			16
+#define MAX_RUNS			1000000
+
+#define START_GAME_MS		500
+#define AUTO_MODE_MS		1000
+#define BALL_SETPOINT		0.5F
+
+typedef struct {
+	const SilA2l_Characteristic_t *characteristic;
+	double min;
+	double max;
+	int points;
+	int hasRange;
+} Param_t;
+
+typedef struct {
+	double values[MAX_PARAMS];
+	float score;
+	double settling_s;
+	float overshoot;
+	int error;
+} Run_t;
+
+typedef struct {
+	Param_t *params;
+	int numParams;
+	Run_t *runs;
+	int numRuns;
+	uint32_t steps;
+	float band;
+} Sweep_t;
+
+typedef struct {
+	SilScenario_t scenario;
+	float band;
+	uint32_t lastOutside_ms;	// last step with the ball outside the band
+	int crossed;
+	float peak;
+} Metrics_t;
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// xorshift64*, uniform in [0, 1)
+static double randomUniform(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return ((x * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void metricsHook(Sil_Inputs_t *inputs, const Sil_Outputs_t *outputs, uint32_t time_ms, void *user) {
+	Metrics_t *metrics = user;
+
+	SilScenario_Hook(inputs, outputs, time_ms, &metrics->scenario);
+	if (time_ms < AUTO_MODE_MS) {
+		return;
+	}
+	float position = SilScenario_GetBallPosition(&metrics->scenario);
+	if (fabsf(position - BALL_SETPOINT) > metrics->band) {
+		metrics->lastOutside_ms = time_ms;
+	}
+	if (position >= BALL_SETPOINT) {
+		metrics->crossed = 1;
+	}
+	if (metrics->crossed && (position > metrics->peak)) {
+		metrics->peak = position;
+	}
+}
+
+static void runTask(int worker, int task, void *arg) {
+	Sweep_t *sweep = arg;
+	Run_t *run = &sweep->runs[task];
+	Sil_Instance_t *instance = Sil_InstanceCreate(worker);
+
+	if (instance == NULL) {
+		run->error = 1;
+		return;
+	}
+	for (int p = 0; p < sweep->numParams; p++) {
+		const SilA2l_Characteristic_t *c = sweep->params[p].characteristic;
+		uint8_t raw[8];
+		SilA2l_Encode(c, run->values[p], raw);
+		if (!Sil_InstanceWriteCharacteristic(instance, c->cAccessName, raw, SilA2l_GetSize(c))) {
+			run->error = 1;
+		}
+	}
+
+	Metrics_t metrics;
+	SilScenario_Init(&metrics.scenario, START_GAME_MS, AUTO_MODE_MS);
+	metrics.band = sweep->band;
+	metrics.lastOutside_ms = AUTO_MODE_MS;
+	metrics.crossed = 0;
+	metrics.peak = BALL_SETPOINT;
+	Sil_InstanceRun(instance, sweep->steps, metricsHook, &metrics);
+
+	uint32_t lastStep_ms = Sil_InstanceGetTimeMs(instance) - SIL_STEP_MS;
+	run->score = Sil_InstanceGetSignals(instance)->score;
+	run->settling_s = (metrics.lastOutside_ms < lastStep_ms)
+			? (metrics.lastOutside_ms + SIL_STEP_MS - AUTO_MODE_MS) * 1e-3 : NAN;
+	run->overshoot = metrics.peak - BALL_SETPOINT;
+	Sil_InstanceDestroy(instance);
+}
+
+static int generateGrid(Sweep_t *sweep) {
+	long long total = 1;
+	for (int p = 0; p < sweep->numParams; p++) {
+		total *= sweep->params[p].points;
+		if (total > MAX_RUNS) {
+			return -1;
+		}
+	}
+	sweep->numRuns = (int) total;
+	sweep->runs = calloc(sweep->numRuns, sizeof(Run_t));
+	for (int r = 0; r < sweep->numRuns; r++) {
+		int index = r;
+		for (int p = sweep->numParams - 1; p >= 0; p--) {
+			const Param_t *param = &sweep->params[p];
+			int k = index % param->points;
+			index /= param->points;
+			sweep->runs[r].values[p] = (param->points > 1)
+					? param->min + (param->max - param->min) * k / (param->points - 1) : param->min;
+		}
+	}
+	return 0;
+}
+
+// one stratum per sample and parameter, strata shuffled independently per parameter
+static int generateLatinHypercube(Sweep_t *sweep, int samples, uint64_t seed) {
+	if ((samples < 1) || (samples > MAX_RUNS)) {
+		return -1;
+	}
+	uint64_t state = seed ? seed : 1;
+	int *strata = malloc(samples * sizeof(int));
+
+	sweep->numRuns = samples;
+	sweep->runs = calloc(samples, sizeof(Run_t));
+	for (int p = 0; p < sweep->numParams; p++) {
+		const Param_t *param = &sweep->params[p];
+		for (int k = 0; k < samples; k++) {
+			strata[k] = k;
+		}
+		for (int k = samples - 1; k > 0; k--) {
+			int j = (int) (randomUniform(&state) * (k + 1));
+			int tmp = strata[k];
+			strata[k] = strata[j];
+			strata[j] = tmp;
+		}
+		for (int r = 0; r < samples; r++) {
+			double u = (strata[r] + randomUniform(&state)) / samples;
+			sweep->runs[r].values[p] = param->min + (param->max - param->min) * u;
+		}
+	}
+	free(strata);
+	return 0;
+}
+
+// name[=min:max[:points]]
+static int parseParam(const SilA2l_t *a2l, char *spec, Param_t *param, int defaultPoints) {
+	char *range = strchr(spec, '=');
+
+	if (range != NULL) {
+		*range++ = '\0';
+	}
+	param->characteristic = SilA2l_Find(a2l, spec);
+	if (param->characteristic == NULL) {
+		fprintf(stderr, "unknown or ambiguous characteristic: %s\n", spec);
+		return -1;
+	}
+	if (param->characteristic->cAccessName[0] == '\0') {
+		fprintf(stderr, "%s: not in the mapping file\n", param->characteristic->name);
+		return -1;
+	}
+	param->points = defaultPoints;
+	param->hasRange = 0;
+	if (range != NULL) {
+		int n = sscanf(range, "%lf:%lf:%d", &param->min, &param->max, &param->points);
+		if ((n < 2) || (param->points < 1)) {
+			fprintf(stderr, "invalid range: %s\n", range);
+			return -1;
+		}
+		param->hasRange = 1;
+	}
+	return 0;
+}
+
+// default ranges around the reference values, clipped to the A2L limits
+static int completeParams(Param_t *params, int numParams) {
+	Sil_Instance_t *instance = Sil_InstanceCreate(0);
+
+	for (int p = 0; p < numParams; p++) {
+		Param_t *param = &params[p];
+		const SilA2l_Characteristic_t *c = param->characteristic;
+		if (!param->hasRange) {
+			uint8_t raw[8];
+			if (!Sil_InstanceReadCharacteristic(instance, c->cAccessName, raw, SilA2l_GetSize(c))) {
+				fprintf(stderr, "%s: unknown to the SIL\n", c->name);
+				Sil_InstanceDestroy(instance);
+				return -1;
+			}
+			double value = SilA2l_Decode(c, raw);
+			param->min = (value != 0.0) ? 0.5 * value : 0.0;
+			param->max = (value != 0.0) ? 1.5 * value : 1.0;
+			if (param->min > param->max) {
+				double tmp = param->min;
+				param->min = param->max;
+				param->max = tmp;
+			}
+		}
+		param->min = fmax(param->min, c->lowerLimit);
+		param->max = fmin(param->max, c->upperLimit);
+		if (param->min > param->max) {
+			fprintf(stderr, "%s: range outside the limits [%g, %g]\n", c->name, c->lowerLimit, c->upperLimit);
+			Sil_InstanceDestroy(instance);
+			return -1;
+		}
+	}
+	Sil_InstanceDestroy(instance);
+	return 0;
+}
+
+static double runSweep(Sweep_t *sweep, int workers) {
+	Sil_Pool_t *pool = Sil_PoolCreate(workers);
+	double start = now_s();
+
+	Sil_PoolRunTasks(pool, sweep->numRuns, runTask, sweep);
+	double elapsed = now_s() - start;
+	Sil_PoolDestroy(pool);
+	return elapsed;
+}
+
+static void printResults(FILE *out, const Sweep_t *sweep) {
+	fprintf(out, "run");
+	for (int p = 0; p < sweep->numParams; p++) {
+		fprintf(out, ",%s", sweep->params[p].characteristic->name);
+	}
+	fprintf(out, ",score,settling_s,overshoot\n");
+
+	for (int r = 0; r < sweep->numRuns; r++) {
+		const Run_t *run = &sweep->runs[r];
+		fprintf(out, "%d", r);
+		for (int p = 0; p < sweep->numParams; p++) {
+			fprintf(out, ",%.9g", run->values[p]);
+		}
+		if (run->error) {
+			fprintf(out, ",,,\n");
+		} else if (isnan(run->settling_s)) {
+			fprintf(out, ",%.3f,,%.4f\n", run->score, run->overshoot);
+		} else {
+			fprintf(out, ",%.3f,%.3f,%.4f\n", run->score, run->settling_s, run->overshoot);
+		}
+	}
+}
+
+static void printBest(const Sweep_t *sweep) {
+	int best = -1;
+	for (int r = 0; r < sweep->numRuns; r++) {
+		if (!sweep->runs[r].error && ((best < 0) || (sweep->runs[r].score > sweep->runs[best].score))) {
+			best = r;
+		}
+	}
+	if (best < 0) {
+		return;
+	}
+	printf("# best score: %.3f s (run %d:", sweep->runs[best].score, best);
+	for (int p = 0; p < sweep->numParams; p++) {
+		printf(" %s=%.6g", sweep->params[p].characteristic->name, sweep->runs[best].values[p]);
+	}
+	printf(")\n");
+}
+
+// the same sweep on one worker and on several workers, returns the time of the latter
+static int selfCheck(Sweep_t *sweep, int workers, double *elapsed) {
+	int errors = 0;
+	Run_t *parallel = malloc(sweep->numRuns * sizeof(Run_t));
+
+	*elapsed = runSweep(sweep, workers);
+	memcpy(parallel, sweep->runs, sweep->numRuns * sizeof(Run_t));
+	runSweep(sweep, 1);
+
+	for (int r = 0; r < sweep->numRuns; r++) {
+		const Run_t *a = &sweep->runs[r];
+		const Run_t *b = &parallel[r];
+		int equal = !a->error && !b->error
+				&& (memcmp(&a->score, &b->score, sizeof(float)) == 0)
+				&& (memcmp(&a->settling_s, &b->settling_s, sizeof(double)) == 0)
+				&& (memcmp(&a->overshoot, &b->overshoot, sizeof(float)) == 0);
+		if (!equal) {
+			printf("# run %d differs between 1 and %d workers\n", r, workers);
+			errors++;
+		}
+	}
+	// the gains must have an effect, otherwise the characteristics were not written
+	int distinct = 0;
+	for (int r = 1; r < sweep->numRuns; r++) {
+		distinct += (sweep->runs[r].score != sweep->runs[0].score);
+	}
+	if (distinct == 0) {
+		printf("# all runs have the same score\n");
+		errors++;
+	}
+	free(parallel);
+	return errors;
+}
+
+int main(int argc, char *argv[]) {
+	const char *a2lPath = SIL_SRC_GEN_DIR "/BalanceTube_STMicro.a2l";
+	const char *mappingPath = SIL_SRC_GEN_DIR "/BalanceTube_STMicro.mapping.cnames.csv";
+	const char *outputPath = NULL;
+	char *specs[MAX_PARAMS];
+	int numSpecs = 0;
+	int points = 5;
+	int samples = 0;
+	uint64_t seed = 1;
+	int workers = Sil_GetProcessorCount();
+	double duration_s = 125.0;
+	double band = 0.05;
+	int check = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "a:m:p:n:l:r:j:t:b:o:c")) != -1) {
+		switch (opt) {
+		case 'a':
+			a2lPath = optarg;
+			break;
+		case 'm':
+			mappingPath = optarg;
+			break;
+		case 'p':
+			if (numSpecs == MAX_PARAMS) {
+				fprintf(stderr, "too many parameters\n");
+				return 2;
+			}
+			specs[numSpecs++] = optarg;
+			break;
+		case 'n':
+			points = atoi(optarg);
+			break;
+		case 'l':
+			samples = atoi(optarg);
+			break;
+		case 'r':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'j':
+			workers = atoi(optarg);
+			break;
+		case 't':
+			duration_s = atof(optarg);
+			break;
+		case 'b':
+			band = atof(optarg);
+			break;
+		case 'o':
+			outputPath = optarg;
+			break;
+		case 'c':
+			check = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-a a2l] [-m mapping] [-p name[=min:max[:points]]]... [-n points]\n"
+					"       [-l samples] [-r seed] [-j workers] [-t seconds] [-b band] [-o results.csv] [-c]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+	if (check) {
+		static char kp[] = "kp=0.1:0.6:3";
+		static char kd[] = "kd";
+		specs[0] = kp;
+		specs[1] = kd;
+		numSpecs = 2;
+		points = 3;
+		samples = 0;
+		workers = 4;
+		duration_s = 20.0;
+	}
+	if (workers > Sil_GetImageCount()) {
+		workers = Sil_GetImageCount();
+	}
+	if ((workers < 1) || (points < 1) || (duration_s <= 0.0)) {
+		return 2;
+	}
+
+	SilA2l_t a2l;
+	if (SilA2l_Load(&a2l, a2lPath, mappingPath) != 0) {
+		return 1;
+	}
+	if (numSpecs == 0) {
+		static char gains[3][3] = { "kp", "ki", "kd" };
+		for (int k = 0; k < 3; k++) {
+			specs[numSpecs++] = gains[k];
+		}
+	}
+
+	Param_t params[MAX_PARAMS];
+	Sweep_t sweep = { 0 };
+	sweep.params = params;
+	sweep.numParams = numSpecs;
+	sweep.steps = (uint32_t) (duration_s * 1000.0 / SIL_STEP_MS);
+	sweep.band = (float) band;
+	for (int p = 0; p < numSpecs; p++) {
+		if (parseParam(&a2l, specs[p], &params[p], points) != 0) {
+			return 1;
+		}
+	}
+	if (completeParams(params, numSpecs) != 0) {
+		return 1;
+	}
+	int generated = (samples > 0) ? generateLatinHypercube(&sweep, samples, seed) : generateGrid(&sweep);
+	if (generated != 0) {
+		fprintf(stderr, "too many runs (maximum %d)\n", MAX_RUNS);
+		return 2;
+	}
+
+	int errors = 0;
+	double elapsed;
+	if (check) {
+		// every A2L characteristic must be known to the SIL
+		Sil_Instance_t *instance = Sil_InstanceCreate(0);
+		for (int k = 0; k < a2l.count; k++) {
+			uint8_t raw[8];
+			const SilA2l_Characteristic_t *c = &a2l.characteristics[k];
+			if (!Sil_InstanceReadCharacteristic(instance, c->cAccessName, raw, SilA2l_GetSize(c))) {
+				printf("# %s: unknown to the SIL\n", c->name);
+				errors++;
+			}
+		}
+		Sil_InstanceDestroy(instance);
+		errors += selfCheck(&sweep, workers, &elapsed);
+	} else {
+		elapsed = runSweep(&sweep, workers);
+	}
+
+	FILE *out = stdout;
+	if (outputPath != NULL) {
+		out = fopen(outputPath, "w");
+		if (out == NULL) {
+			fprintf(stderr, "cannot write %s\n", outputPath);
+			return 1;
+		}
+	}
+	printResults(out, &sweep);
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	for (int r = 0; r < sweep.numRuns; r++) {
+		errors += sweep.runs[r].error;
+	}
+	printf("# %d runs x %.1f s simulated, %d workers, %d characteristics in the A2L\n",
+			sweep.numRuns, duration_s, workers, a2l.count);
+	printf("# wall time: %.3f s, %.1f runs/s, %.0f steps/s\n", elapsed, sweep.numRuns / elapsed,
+			(double) sweep.numRuns * sweep.steps / elapsed);
+	printBest(&sweep);
+	if (errors > 0) {
+		printf("# FAILED: %d errors\n", errors);
+	}
+
+	free(sweep.runs);
+	SilA2l_Free(&a2l);
+	return (errors > 0) ? 1 : 0;
+}
@@ -0,0 +1,520 @@
+/**
+ * I2C cost of the VL53L0X driver calls of the firmware.
+ *
+ * Runs the ST driver (Core/Src/vl53l0x), its platform layer vl53l0x_tof.c, the
+ * calibration store and the I2C queue against the register model of
+ * sil_vl53l0x_dev.h, with a HAL of its own instead of the SIL library: the
+ * I2C interrupt functions go to the model, HAL_GetTick() and HAL_Delay() run
+ * on the time of the model and the calibration flash page is an array.
+ *
+ * It boots the sensor like initializeBallDistanceSensor() in BalanceTube.c,
+ * twice: from a blank calibration page (the reference calibration is
+ * performed and stored) and after a power cycle (the record is restored).
+ * Then it ranges continuously, with the asynchronous read of the firmware
+ * (VL53L0X_StartRangeRead() when GPIO1 signals), with its blocking form
+ * VL53L0X_GetRange() and with the API calls VL53L0X_GetRangingMeasurementData()
+ * and VL53L0X_ClearInterruptMask(). For every call it reports the transfers,
+ * data bytes and bus time on the I2C, the time that passed on the sensor side
+ * (bus and polling delays) and the host time spent in the driver.
+ *
+ * Last it boots with each ranging profile of SetupSingleShot() and ranges
+ * with the range-only read, for the timing budget and sample rate of each.
+ *
+ * The target moves on a ramp, so every range can be checked against the
+ * distance of the model when the measurement completed.
+ *
+ * usage: vl53l0x_bench [-f kHz] [-n ranges] [-s noise_mm] [-p profile] [-c]
+ *
+ *   -f  I2C clock (default 400)
+ *   -n  ranges of each ranging run (default 100)
+ *   -s  noise of the ranges, no range check if not 0
+ *   -p  VL53L0X_RangingProfile_t of the boots (default 0)
+ *   -c  self-check run
+ *
+ * Exits with 1 if the boots do not perform and then restore the calibration,
+ * the restored boot needs as many transfers as the first, a range differs
+ * from the model, the ranging period is not the timing budget of the model or
+ * that differs from the budget the driver reports, or if the range-only read
+ * takes as much bus time as the API calls. The same checks of the period and
+ * the budget apply to every profile.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "stm32f3xx_hal.h"
+#include "vl53l0x_api.h"
+#include "vl53l0x_tof.h"
+#include "sil_vl53l0x_dev.h"
+
+#define DEVICE_ADDRESS		0x52		// PROXIMITY_I2C_ADDRESS
+#define GPIO1_POLL_NS		100000		// check of the interrupt line while waiting for a range
+#define RAMP_START_MM		60.0
+#define RAMP_SPEED_MM_S		250.0		// ball speed through the tube
+#define RAMP_LENGTH_MM		400.0
+
+typedef struct {
+	SilVl53l0xDev_Stats_t stats;
+	uint64_t time_ns;
+	struct timespec host;
+} Probe_t;
+
+typedef struct {
+	uint32_t transfers;			// transmits and receives
+	uint32_t bytes;
+	uint64_t bus_ns;
+	uint64_t elapsed_ns;
+	uint64_t host_ns;
+} Cost_t;
+
+typedef struct {
+	Cost_t perRange;			// mean of the reads
+	uint32_t ranges;
+	uint32_t wrongRanges;
+	uint64_t periodMin_ns;
+	uint64_t periodMax_ns;
+} RangingResult_t;
+
+static SilVl53l0xDev_t device;
+static I2C_HandleTypeDef i2c;
+static VL53L0X_Dev_t Dev;
+
+// interrupt of the model
+static uint8_t gpio1;
+static uint64_t gpio1Time_ns;
+static double gpio1Distance_mm;
+
+// completion of VL53L0X_StartRangeRead()
+static uint8_t rangeDone;
+static VL53L0X_Error rangeStatus;
+static VL53L0X_Range_t rangeValue;
+
+static const char *const profileNames[VL53L0X_NUM_PROFILES] = { "default", "high speed", "high accuracy" };
+
+/****************************************************************************
+ * HAL of the bench
+ ****************************************************************************/
+
+DWT_Type SilHal_Dwt;
+CoreDebug_Type SilHal_CoreDebug;
+uint32_t SystemCoreClock = 64000000;
+
+uint8_t _svl53l0x_calibration_flash[FLASH_PAGE_SIZE];
+
+uint32_t HAL_GetTick(void) {
+	return (uint32_t) (device.time_ns / 1000000U);
+}
+
+void HAL_Delay(uint32_t Delay) {
+	SilVl53l0xDev_Advance(&device, (uint64_t) Delay * 1000000U);
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+		uint16_t Size) {
+	if (DevAddress != DEVICE_ADDRESS) {
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		HAL_I2C_ErrorCallback(hi2c);
+		return HAL_OK;
+	}
+	SilVl53l0xDev_Transmit(&device, pData, Size);
+	HAL_I2C_MasterTxCpltCallback(hi2c);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+		uint16_t Size, uint32_t XferOptions) {
+	return HAL_I2C_Master_Transmit_IT(hi2c, DevAddress, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+		uint16_t Size, uint32_t XferOptions) {
+	if (DevAddress != DEVICE_ADDRESS) {
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		HAL_I2C_ErrorCallback(hi2c);
+		return HAL_OK;
+	}
+	SilVl53l0xDev_Receive(&device, pData, Size);
+	HAL_I2C_MasterRxCpltCallback(hi2c);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError) {
+	memset(_svl53l0x_calibration_flash, 0xFF, sizeof(_svl53l0x_calibration_flash));
+	SilVl53l0xDev_Advance(&device, 40000000U);		// page erase, see vl53l0x_cal_store.h
+	return HAL_OK;
+}
+
+// addresses are truncated to 32 bit on the host, as in VL53L0X_CalStore_Save()
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data) {
+	uint32_t offset = Address - (uint32_t) (uintptr_t) _svl53l0x_calibration_flash;
+	if ((TypeProgram != FLASH_TYPEPROGRAM_WORD) || (offset > sizeof(_svl53l0x_calibration_flash) - 4)) {
+		return HAL_ERROR;
+	}
+	uint32_t word = (uint32_t) Data;
+	memcpy(&_svl53l0x_calibration_flash[offset], &word, sizeof(word));
+	return HAL_OK;
+}
+
+/****************************************************************************
+ * Measurement
+ ****************************************************************************/
+
+static double ramp(uint64_t time_us, void *user) {
+	// back and forth over RAMP_LENGTH_MM
+	double position = RAMP_SPEED_MM_S * (double) time_us / 1e6;
+	double cycle = position - 2.0 * RAMP_LENGTH_MM * (double) (uint64_t) (position / (2.0 * RAMP_LENGTH_MM));
+	return RAMP_START_MM + ((cycle <= RAMP_LENGTH_MM) ? cycle : 2.0 * RAMP_LENGTH_MM - cycle);
+}
+
+static void interrupt(void *user) {
+	gpio1 = 1;
+	gpio1Time_ns = device.time_ns;
+	gpio1Distance_mm = SilVl53l0xDev_GetDistanceMm(&device);
+}
+
+static void rangeRead(VL53L0X_Error status, const VL53L0X_Range_t *range) {
+	rangeDone = 1;
+	rangeStatus = status;
+	rangeValue = *range;
+}
+
+static void probeStart(Probe_t *probe) {
+	probe->stats = device.stats;
+	probe->time_ns = device.time_ns;
+	clock_gettime(CLOCK_MONOTONIC, &probe->host);
+}
+
+static Cost_t probeStop(const Probe_t *probe) {
+	struct timespec host;
+	Cost_t cost;
+
+	clock_gettime(CLOCK_MONOTONIC, &host);
+	cost.transfers = device.stats.transmits + device.stats.receives - probe->stats.transmits - probe->stats.receives;
+	cost.bytes = device.stats.bytes - probe->stats.bytes;
+	cost.bus_ns = device.stats.bus_ns - probe->stats.bus_ns;
+	cost.elapsed_ns = device.time_ns - probe->time_ns;
+	cost.host_ns = (uint64_t) ((host.tv_sec - probe->host.tv_sec) * 1000000000LL + (host.tv_nsec - probe->host.tv_nsec));
+	return cost;
+}
+
+static void addCost(Cost_t *sum, const Cost_t *cost) {
+	sum->transfers += cost->transfers;
+	sum->bytes += cost->bytes;
+	sum->bus_ns += cost->bus_ns;
+	sum->elapsed_ns += cost->elapsed_ns;
+	sum->host_ns += cost->host_ns;
+}
+
+static void report(const char *name, const Cost_t *cost) {
+	printf("  %-34s %6u %7u %10.1f %11.1f %9.1f\n", name, cost->transfers, cost->bytes, cost->bus_ns / 1e3,
+			cost->elapsed_ns / 1e3, cost->host_ns / 1e3);
+}
+
+static void reportHeader(void) {
+	printf("  %-34s %6s %7s %10s %11s %9s\n", "call", "xfers", "bytes", "bus us", "elapsed us", "host us");
+}
+
+// powers the sensor up and initializes it like initializeBallDistanceSensor(), reports the calls if name is set
+static Cost_t boot(const SilVl53l0xDev_Config_t *config, const char *name, VL53L0X_RangingProfile_t profile) {
+	VL53L0X_DeviceInfo_t info;
+	Probe_t probe;
+	Cost_t cost;
+	Cost_t total = { 0 };
+	uint16_t id = 0;
+
+	SilVl53l0xDev_Reset(&device, config);
+	memset(&Dev, 0, sizeof(Dev));
+	Dev.I2cHandle = &i2c;
+	Dev.I2cDevAddr = DEVICE_ADDRESS;
+	gpio1 = 0;
+
+	if (name != NULL) {
+		printf("%s\n", name);
+		reportHeader();
+	}
+#define MEASURE(label, call) \
+	do { \
+		probeStart(&probe); \
+		call; \
+		cost = probeStop(&probe); \
+		if (name != NULL) { \
+			report(label, &cost); \
+		} \
+		addCost(&total, &cost); \
+	} while (0)
+
+	MEASURE("VL53L0X_GetDeviceInfo", VL53L0X_GetDeviceInfo(&Dev, &info));
+	MEASURE("VL53L0X_RdWord(MODEL_ID)", VL53L0X_RdWord(&Dev, VL53L0X_REG_IDENTIFICATION_MODEL_ID, &id));
+	MEASURE("VL53L0X_DataInit", VL53L0X_DataInit(&Dev));
+	Dev.Present = (id == 0xEEAA);
+	MEASURE("SetupSingleShot", SetupSingleShot(&Dev, profile));
+	MEASURE("VL53L0X_SetDeviceMode", VL53L0X_SetDeviceMode(&Dev, VL53L0X_DEVICEMODE_CONTINUOUS_RANGING));
+	MEASURE("VL53L0X_SetGpioConfig", VL53L0X_SetGpioConfig(&Dev, 0, VL53L0X_DEVICEMODE_CONTINUOUS_RANGING,
+			VL53L0X_GPIOFUNCTIONALITY_NEW_MEASURE_READY, VL53L0X_INTERRUPTPOLARITY_LOW));
+	MEASURE("VL53L0X_ClearInterruptMask", VL53L0X_ClearInterruptMask(&Dev, 0));
+	gpio1 = 0;		// the EXTI interrupt is only of interest from here on
+	MEASURE("VL53L0X_StartMeasurement", VL53L0X_StartMeasurement(&Dev));
+#undef MEASURE
+	if (name != NULL) {
+		report("total", &total);
+		printf("  calibration %s, model %04X, %s profile\n",
+				(Dev.CalibrationSource == VL53L0X_CALIBRATION_RESTORED) ? "restored" :
+				(Dev.CalibrationSource == VL53L0X_CALIBRATION_PERFORMED) ? "performed" : "none", id,
+				profileNames[Dev.RangingProfile]);
+	}
+	return total;
+}
+
+// lets the sensor range until GPIO1 signals, as the EXTI interrupt would
+static int waitForRange(void) {
+	uint64_t deadline_ns = device.time_ns + 1000000000ULL;
+	while (!gpio1 && (device.time_ns < deadline_ns)) {
+		SilVl53l0xDev_Advance(&device, GPIO1_POLL_NS);
+	}
+	return gpio1 ? 0 : -1;
+}
+
+static void checkRange(RangingResult_t *result, uint16_t range_mm, uint8_t rangeStatus, uint8_t checkValues) {
+	uint16_t expected = (uint16_t) (gpio1Distance_mm + 0.5);
+	if ((rangeStatus != 0) || (checkValues && (range_mm != expected))) {
+		if (result->wrongRanges == 0) {
+			printf("  range %u mm, the model was at %u mm\n", range_mm, expected);
+		}
+		result->wrongRanges++;
+	}
+}
+
+static void checkPeriod(RangingResult_t *result, uint64_t *previous_ns) {
+	if (*previous_ns != 0) {
+		uint64_t period_ns = gpio1Time_ns - *previous_ns;
+		if ((result->periodMin_ns == 0) || (period_ns < result->periodMin_ns)) {
+			result->periodMin_ns = period_ns;
+		}
+		if (period_ns > result->periodMax_ns) {
+			result->periodMax_ns = period_ns;
+		}
+	}
+	*previous_ns = gpio1Time_ns;
+}
+
+static void finishRanging(const char *name, RangingResult_t *result, const Cost_t *sum) {
+	uint32_t n = (result->ranges > 0) ? result->ranges : 1;
+	result->perRange.transfers = sum->transfers / n;
+	result->perRange.bytes = sum->bytes / n;
+	result->perRange.bus_ns = sum->bus_ns / n;
+	result->perRange.elapsed_ns = sum->elapsed_ns / n;
+	result->perRange.host_ns = sum->host_ns / n;
+	report(name, &result->perRange);
+}
+
+// VL53L0X_StartRangeRead() on every interrupt, as ReadBallPosition()
+static RangingResult_t rangeAsync(uint32_t ranges, uint8_t checkValues) {
+	RangingResult_t result = { 0 };
+	Cost_t sum = { 0 };
+	uint64_t previous_ns = 0;
+	Probe_t probe;
+
+	for (uint32_t i = 0; i < ranges; i++) {
+		if (waitForRange() != 0) {
+			break;
+		}
+		checkPeriod(&result, &previous_ns);
+		rangeDone = 0;
+		probeStart(&probe);
+		VL53L0X_Error status = VL53L0X_StartRangeRead(&Dev, rangeRead);
+		while ((status == VL53L0X_ERROR_NONE) && !I2cAsync_IsIdle()) {
+			I2cAsync_Service();
+		}
+		Cost_t cost = probeStop(&probe);
+		addCost(&sum, &cost);
+		gpio1 = 0;
+		if ((status != VL53L0X_ERROR_NONE) || !rangeDone || (rangeStatus != VL53L0X_ERROR_NONE) || !rangeValue.Ready) {
+			break;
+		}
+		checkRange(&result, rangeValue.RangeMilliMeter, rangeValue.RangeStatus, checkValues);
+		result.ranges++;
+	}
+	finishRanging("VL53L0X_StartRangeRead, per range", &result, &sum);
+	return result;
+}
+
+// the blocking range-only read
+static RangingResult_t rangeOnly(uint32_t ranges, uint8_t checkValues) {
+	RangingResult_t result = { 0 };
+	Cost_t sum = { 0 };
+	uint64_t previous_ns = 0;
+	Probe_t probe;
+
+	for (uint32_t i = 0; i < ranges; i++) {
+		VL53L0X_Range_t range;
+
+		if (waitForRange() != 0) {
+			break;
+		}
+		checkPeriod(&result, &previous_ns);
+		probeStart(&probe);
+		VL53L0X_Error status = VL53L0X_GetRange(&Dev, &range);
+		Cost_t cost = probeStop(&probe);
+		addCost(&sum, &cost);
+		gpio1 = 0;
+		if ((status != VL53L0X_ERROR_NONE) || !range.Ready) {
+			break;
+		}
+		checkRange(&result, range.RangeMilliMeter, range.RangeStatus, checkValues);
+		result.ranges++;
+	}
+	finishRanging("VL53L0X_GetRange", &result, &sum);
+	return result;
+}
+
+// the blocking API calls for the same
+static RangingResult_t rangeSync(uint32_t ranges, uint8_t checkValues) {
+	RangingResult_t result = { 0 };
+	Cost_t sum = { 0 };
+	uint64_t previous_ns = 0;
+	Probe_t probe;
+
+	for (uint32_t i = 0; i < ranges; i++) {
+		VL53L0X_RangingMeasurementData_t data;
+
+		if (waitForRange() != 0) {
+			break;
+		}
+		checkPeriod(&result, &previous_ns);
+		probeStart(&probe);
+		VL53L0X_Error status = VL53L0X_GetRangingMeasurementData(&Dev, &data);
+		if (status == VL53L0X_ERROR_NONE) {
+			status = VL53L0X_ClearInterruptMask(&Dev, 0);
+		}
+		Cost_t cost = probeStop(&probe);
+		addCost(&sum, &cost);
+		gpio1 = 0;
+		if (status != VL53L0X_ERROR_NONE) {
+			break;
+		}
+		checkRange(&result, data.RangeMilliMeter, data.RangeStatus, checkValues);
+		result.ranges++;
+	}
+	finishRanging("GetRangingMeasurementData + Clear", &result, &sum);
+	return result;
+}
+
+static int assessRanging(const char *name, const RangingResult_t *result, uint32_t ranges, uint32_t budget_us) {
+	printf("  %s: %u ranges, %u wrong, period %.1f..%.1f us\n", name, result->ranges, result->wrongRanges,
+			result->periodMin_ns / 1e3, result->periodMax_ns / 1e3);
+	// GPIO1 is polled, so the period is only known to GPIO1_POLL_NS
+	uint64_t budget_ns = (uint64_t) budget_us * 1000U;
+	return (result->ranges != ranges) || (result->wrongRanges != 0)
+			|| (result->periodMin_ns + GPIO1_POLL_NS < budget_ns) || (result->periodMax_ns > budget_ns + GPIO1_POLL_NS);
+}
+
+// boots with every profile and ranges at its timing budget
+static int rangeProfiles(const SilVl53l0xDev_Config_t *config, uint32_t ranges, uint8_t checkValues) {
+	int failed = 0;
+
+	printf("\nranging profiles, range-only read\n");
+	reportHeader();
+	for (int profile = 0; profile < VL53L0X_NUM_PROFILES; profile++) {
+		boot(config, NULL, (VL53L0X_RangingProfile_t) profile);
+		uint32_t driverBudget_us = 0;
+		VL53L0X_GetMeasurementTimingBudgetMicroSeconds(&Dev, &driverBudget_us);
+		uint32_t budget_us = SilVl53l0xDev_GetTimingBudgetUs(&device);
+		RangingResult_t result = rangeOnly(ranges, checkValues);
+		printf("  %s: timing budget %u us (driver: %u us), %.2f ranges/s\n", profileNames[profile], budget_us,
+				driverBudget_us, 1e9 / (double) ((result.periodMax_ns > 0) ? result.periodMax_ns : 1));
+		failed |= assessRanging(profileNames[profile], &result, ranges, budget_us);
+		failed |= (budget_us != driverBudget_us) || (Dev.RangingProfile != profile);
+	}
+	return failed;
+}
+
+int main(int argc, char *argv[]) {
+	SilVl53l0xDev_Config_t config;
+	uint32_t ranges = 100;
+	double frequency_kHz = 400.0;
+	double noise_mm = 0.0;
+	int profile = VL53L0X_PROFILE_DEFAULT;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:n:s:p:c")) != -1) {
+		switch (opt) {
+		case 'f':
+			frequency_kHz = atof(optarg);
+			break;
+		case 'n':
+			ranges = (uint32_t) atoi(optarg);
+			break;
+		case 's':
+			noise_mm = atof(optarg);
+			break;
+		case 'p':
+			profile = atoi(optarg);
+			break;
+		case 'c':
+			ranges = 30;
+			noise_mm = 0.0;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f kHz] [-n ranges] [-s noise_mm] [-p profile] [-c]\n", argv[0]);
+			return 2;
+		}
+	}
+	if ((frequency_kHz < 10.0) || (frequency_kHz > 1000.0) || (ranges < 2) || (noise_mm < 0.0) || (profile < 0)
+			|| (profile >= VL53L0X_NUM_PROFILES)) {
+		fprintf(stderr, "the clock must be 10..1000 kHz, at least 2 ranges, profile 0..%d\n", VL53L0X_NUM_PROFILES - 1);
+		return 2;
+	}
+
+	SilVl53l0xDev_GetDefaultConfig(&config);
+	config.bitRate_Hz = (uint32_t) (frequency_kHz * 1000.0);
+	config.profile = ramp;
+	config.noise_mm = noise_mm;
+	device.interrupt = interrupt;
+	memset(_svl53l0x_calibration_flash, 0xFF, sizeof(_svl53l0x_calibration_flash));
+	printf("I2C at %.0f kHz, bus time includes start, address and stop\n\n", frequency_kHz);
+
+	Cost_t first = boot(&config, "boot with a blank calibration page", (VL53L0X_RangingProfile_t) profile);
+	uint8_t firstSource = Dev.CalibrationSource;
+	Cost_t second = boot(&config, "boot after a power cycle", (VL53L0X_RangingProfile_t) profile);
+	uint8_t secondSource = Dev.CalibrationSource;
+
+	uint32_t driverBudget_us = 0;
+	VL53L0X_GetMeasurementTimingBudgetMicroSeconds(&Dev, &driverBudget_us);
+	uint32_t budget_us = SilVl53l0xDev_GetTimingBudgetUs(&device);
+	printf("\ncontinuous ranging, timing budget %u us (driver: %u us)\n", budget_us, driverBudget_us);
+	reportHeader();
+	RangingResult_t async = rangeAsync(ranges, noise_mm == 0.0);
+	RangingResult_t single = rangeOnly(ranges, noise_mm == 0.0);
+	RangingResult_t sync = rangeSync(ranges, noise_mm == 0.0);
+	printf("  range-only read: %.0f%% of the bus time of the API calls\n",
+			100.0 * (double) single.perRange.bus_ns / (double) sync.perRange.bus_ns);
+
+	int failed = 0;
+	failed |= assessRanging("asynchronous", &async, ranges, budget_us);
+	failed |= assessRanging("range-only", &single, ranges, budget_us);
+	failed |= assessRanging("API calls", &sync, ranges, budget_us);
+	failed |= (single.perRange.bus_ns >= sync.perRange.bus_ns) || (async.perRange.bus_ns != single.perRange.bus_ns);
+	failed |= (firstSource != VL53L0X_CALIBRATION_PERFORMED) || (secondSource != VL53L0X_CALIBRATION_RESTORED);
+	failed |= (second.transfers >= first.transfers);
+	failed |= (budget_us != driverBudget_us);
+	failed |= rangeProfiles(&config, ranges, noise_mm == 0.0);
+	return failed ? 1 : 0;
+}
@@ -12,13 +12,32 @@
 #define PTR_model_MainClass_stm32f334r8 PTR_MODEL_MAINCLASS_STM32F334R8
 #define PTR_hardware_HandDistanceSensor_Automatic PTR_HARDWARE_HANDDISTANCESENSOR_AUTOMATIC
 
-#define DisableAllInterrupts()
-#define EnableAllInterrupts()
+/* OSEK API of the executive: critical sections, GetStopwatch() (OSENV_USER_UNSUPPORTED, see esdl_mutex.h) */
+#include "executive.h"
+/* the dT hooks of the generated tasks (platform_defs.h) may run with interrupts masked, so they must nest */
+#define DisableAllInterrupts() SuspendAllInterrupts()
+#define EnableAllInterrupts() ResumeAllInterrupts()
 
+/* dT of a task covers balanceTube_dTScale periods (see RunModel() in BalanceTube.c); the generated
+ * conversion is included first, so that it is replaced before platform_defs.h uses it */
+#include "esdl_deltaTimeDefs.h"
+extern float balanceTube_dTScale;
+#undef ASCET_SET_MODEL_DT
+#define ASCET_SET_MODEL_DT(rawDt) ASD_DT_SCALED = (ASCET_DELTA_T_SCALED_TYPE)(rawDt) * balanceTube_dTScale
+
+#ifdef BALANCETUBE_HOST_SIL
+/* host SIL build (see Host/): pointers are 64 bit wide, pages are handled by sil_mem.c */
+#include "sil_mem.h"
+
+#ifdef _ASD_SERAP_DEF
+#define USE_PARAM_GLOBAL(TYPE, VARIABLE) (TYPE *)((uintptr_t)(VARIABLE) + SilMem_GetActiveEcuPageOffset())
+#endif
+#else
 #include "xcp_mem.h"
 
 #ifdef _ASD_SERAP_DEF
 #define USE_PARAM_GLOBAL(TYPE, VARIABLE) (TYPE *)(*(unsigned int *)((unsigned int)&VARIABLE) + XcpMem_GetActiveEcuPageOffset())
 #endif
+#endif
 
 #endif /* ESDL_USERCFG_H */